@@ -0,0 +1,207 @@
+#include "Analysis.h"
+
+#include <errno.h>
+#include <math.h>
+#include <mpi.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+// Private
+
+// Pixel of the coordinate v on a grid of size pixels on [vMin, vMax], the nearest one outside
+static inline int pixel(double v, double vMin, double vMax, int size)
+{
+	double p = floor((v - vMin) / (vMax - vMin) * size);
+	return (p < 0) ? 0 : (p >= size) ? size - 1 : (int) p;
+}
+
+// Sum the count values of buf of all the nodes in the one of the node 0
+static void reduceToRoot(void *buf, int count, MPI_Datatype type, int rank)
+{
+	MPI_Reduce((rank == 0) ? MPI_IN_PLACE : buf, buf, count, type, MPI_SUM, 0, MPI_COMM_WORLD);
+}
+
+// Public
+
+// Initialize an analysis with zero summaries, of a density grid of gridSize x gridSize pixels on
+// the area of the quadtree qt, a radial profile of nbRadialBins rings up to rMax around (xCenter,
+// yCenter), and a force histogram of nbForceBins bins on [fMin, fMax]
+void initAnalysis(Analysis *a, Quadtree *qt, int gridSize, int nbRadialBins, double xCenter,
+				  double yCenter, double rMax, int nbForceBins, double fMin, double fMax)
+{
+	a->gridSize = gridSize;
+	a->xMin = qt->xMin;
+	a->xMax = qt->xMax;
+	a->yMin = qt->yMin;
+	a->yMax = qt->yMax;
+	a->nbRadialBins = nbRadialBins;
+	a->xCenter = xCenter;
+	a->yCenter = yCenter;
+	a->rMax = rMax;
+	a->nbForceBins = nbForceBins;
+	a->fMin = fMin;
+	a->fMax = fMax;
+
+	a->density = (double *) malloc(gridSize * gridSize * sizeof(double));
+	a->radialMass = (double *) malloc(nbRadialBins * sizeof(double));
+	a->radialCounts = (long *) malloc(nbRadialBins * sizeof(long));
+	a->forceCounts = (long *) malloc(nbForceBins * sizeof(long));
+	resetAnalysis(a);
+}
+
+// Release the ressources associated with the analysis
+void freeAnalysis(Analysis *a)
+{
+	free(a->density);
+	free(a->radialMass);
+	free(a->radialCounts);
+	free(a->forceCounts);
+}
+
+// Reset the summaries of the analysis
+void resetAnalysis(Analysis *a)
+{
+	a->nbParticles = 0;
+	a->mass = 0;
+	memset(a->density, 0, a->gridSize * a->gridSize * sizeof(double));
+	memset(a->radialMass, 0, a->nbRadialBins * sizeof(double));
+	memset(a->radialCounts, 0, a->nbRadialBins * sizeof(long));
+	memset(a->forceCounts, 0, a->nbForceBins * sizeof(long));
+}
+
+// Add the particles of the cells firstCell to lastCell-1 of the quadtree to the summaries
+void analyzeCells(Analysis *a, Quadtree *qt, int firstCell, int lastCell)
+{
+	int gridSize = a->gridSize, nbPixels = gridSize * gridSize;
+	int nbRadialBins = a->nbRadialBins, nbForceBins = a->nbForceBins;
+	double *density = a->density, *radialMass = a->radialMass;
+	long *radialCounts = a->radialCounts, *forceCounts = a->forceCounts;
+	double radialScale = nbRadialBins / a->rMax;
+	double logFMin = log(a->fMin), forceScale = nbForceBins / (log(a->fMax) - logFMin);
+	long nbParticles = 0;
+	double mass = 0;
+
+	#pragma omp parallel for schedule(dynamic, 16) reduction(+:nbParticles, mass) \
+		reduction(+:density[:nbPixels], radialMass[:nbRadialBins], radialCounts[:nbRadialBins], \
+				  forceCounts[:nbForceBins])
+	for (int cellNo = firstCell; cellNo < lastCell; cellNo++)
+	{
+		Cell *c = qt->cells + cellNo;
+		int n = c->nbParticles;
+		if (n == 0)
+			continue;
+
+		// the whole cell goes to one pixel when its particles are within it
+		double m = 0, xMin = c->x[0], xMax = c->x[0], yMin = c->y[0], yMax = c->y[0];
+		for (int i = 0; i < n; i++)
+		{
+			m += c->m[i];
+			xMin = fmin(xMin, c->x[i]);
+			xMax = fmax(xMax, c->x[i]);
+			yMin = fmin(yMin, c->y[i]);
+			yMax = fmax(yMax, c->y[i]);
+		}
+		int px = pixel(xMin, a->xMin, a->xMax, gridSize), py = pixel(yMin, a->yMin, a->yMax, gridSize);
+		if (px == pixel(xMax, a->xMin, a->xMax, gridSize) && py == pixel(yMax, a->yMin, a->yMax, gridSize))
+			density[py * gridSize + px] += m;
+		else
+			for (int i = 0; i < n; i++)
+				density[pixel(c->y[i], a->yMin, a->yMax, gridSize) * gridSize
+						+ pixel(c->x[i], a->xMin, a->xMax, gridSize)] += c->m[i];
+		nbParticles += n;
+		mass += m;
+
+		for (int i = 0; i < n; i++)
+		{
+			// compared before the conversion, which overflows for the particles far away
+			double rr = hypot(c->x[i] - a->xCenter, c->y[i] - a->yCenter) * radialScale;
+			if (rr < nbRadialBins)
+			{
+				int r = (int) rr;
+				radialMass[r] += c->m[i];
+				radialCounts[r]++;
+			}
+
+			double f = hypot(c->fx[i], c->fy[i]);
+			double b = (f > 0) ? floor((log(f) - logFMin) * forceScale) : 0;
+			forceCounts[(b < 0) ? 0 : (b >= nbForceBins) ? nbForceBins - 1 : (int)b]++;
+		}
+	}
+
+	a->nbParticles += nbParticles;
+	a->mass += mass;
+}
+
+// Add the particles of the quadtree to the summaries
+void analyzeQuadtree(Analysis *a, Quadtree *qt)
+{
+	analyzeCells(a, qt, 0, qt->nbCells);
+}
+
+// Add the particles of the cells of the node in computeForcesDistributed to the summaries,
+// then sum the summaries of all the nodes on the node 0. The summaries of the other nodes are reset
+void analyzeDistributed(Analysis *a, Quadtree *qt)
+{
+	int rank, size;
+	MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+	MPI_Comm_size(MPI_COMM_WORLD, &size);
+
+	int firstCell, lastCell;
+	distributedCells(qt, rank, size, &firstCell, &lastCell);
+	analyzeCells(a, qt, firstCell, lastCell);
+
+	reduceToRoot(&a->nbParticles, 1, MPI_LONG, rank);
+	reduceToRoot(&a->mass, 1, MPI_DOUBLE, rank);
+	reduceToRoot(a->density, a->gridSize * a->gridSize, MPI_DOUBLE, rank);
+	reduceToRoot(a->radialMass, a->nbRadialBins, MPI_DOUBLE, rank);
+	reduceToRoot(a->radialCounts, a->nbRadialBins, MPI_LONG, rank);
+	reduceToRoot(a->forceCounts, a->nbForceBins, MPI_LONG, rank);
+
+	if (rank != 0)
+		resetAnalysis(a);
+}
+
+// Write the summaries in the text file path. Returns 0, or -1 with errno set
+int writeAnalysis(Analysis *a, const char *path)
+{
+	FILE *f = fopen(path, "w");
+	if (f == NULL)
+		return -1;
+
+	fprintf(f, "# Particles, mass\n%ld %e\n", a->nbParticles, a->mass);
+
+	fprintf(f, "\n# Density: mass per pixel of a %dx%d grid on [%e, %e]*[%e, %e], one row per y\n",
+			a->gridSize, a->gridSize, a->xMin, a->xMax, a->yMin, a->yMax);
+	for (int y = 0; y < a->gridSize; y++)
+		for (int x = 0; x < a->gridSize; x++)
+			fprintf(f, "%e%c", a->density[y * a->gridSize + x], (x == a->gridSize - 1) ? '\n' : ' ');
+
+	fprintf(f, "\n# Radial profile around (%e, %e): inner radius, outer radius, mass, particles, "
+			"surface density\n", a->xCenter, a->yCenter);
+	for (int r = 0; r < a->nbRadialBins; r++)
+	{
+		double r0 = r * a->rMax / a->nbRadialBins, r1 = (r+1) * a->rMax / a->nbRadialBins;
+		fprintf(f, "%e %e %e %ld %e\n", r0, r1, a->radialMass[r], a->radialCounts[r],
+				a->radialMass[r] / (M_PI * (r1*r1 - r0*r0)));
+	}
+
+	fprintf(f, "\n# Force histogram: lower |f|, upper |f|, particles (the first and last bins "
+			"include the ones below and above)\n");
+	double ratio = pow(a->fMax / a->fMin, 1.0 / a->nbForceBins);
+	for (int b = 0; b < a->nbForceBins; b++)
+		fprintf(f, "%e %e %ld\n", a->fMin * pow(ratio, b), a->fMin * pow(ratio, b+1), a->forceCounts[b]);
+
+	if (ferror(f))
+	{
+		int e = errno;
+		fclose(f);
+		errno = e;
+		return -1;
+	}
+	return fclose(f);
+}
@@ -0,0 +1,66 @@
+#ifndef ANALYSIS_H
+#define ANALYSIS_H
+
+#include "Quadtree.h"
+
+// In-situ analysis of the particles and forces of a quadtree, after computeForces, in place of
+// full dumps: small summaries accumulated in parallel over the cells, then reduced across the nodes
+// - density grid: mass per pixel of a gridSize x gridSize grid on the area of the quadtree,
+//   the particles outside the area going to the nearest pixel. A cell within one pixel is added
+//   at once
+// - radial profile: mass and number of particles per ring of width rMax / nbRadialBins around
+//   (xCenter, yCenter)
+// - force histogram: number of particles per bin of |f| = sqrt(fx² + fy²), the bins being
+//   logarithmic on [fMin, fMax], with the particles below and above in the first and last bins
+
+typedef struct Analysis
+{
+	// parameters
+	int gridSize;
+	double xMin;
+	double xMax;
+	double yMin;
+	double yMax;
+	int nbRadialBins;
+	double xCenter;
+	double yCenter;
+	double rMax;
+	int nbForceBins;
+	double fMin;
+	double fMax;
+
+	// summaries
+	long nbParticles;
+	double mass;
+	double *density;           // gridSize*gridSize, row y, column x
+	double *radialMass;
+	long *radialCounts;
+	long *forceCounts;
+} Analysis;
+
+// Initialize an analysis with zero summaries, of a density grid of gridSize x gridSize pixels on
+// the area of the quadtree qt, a radial profile of nbRadialBins rings up to rMax around (xCenter,
+// yCenter), and a force histogram of nbForceBins bins on [fMin, fMax]
+extern void initAnalysis(Analysis *a, Quadtree *qt, int gridSize, int nbRadialBins, double xCenter,
+						 double yCenter, double rMax, int nbForceBins, double fMin, double fMax);
+
+// Release the ressources associated with the analysis
+extern void freeAnalysis(Analysis *a);
+
+// Reset the summaries of the analysis
+extern void resetAnalysis(Analysis *a);
+
+// Add the particles of the cells firstCell to lastCell-1 of the quadtree to the summaries
+extern void analyzeCells(Analysis *a, Quadtree *qt, int firstCell, int lastCell);
+
+// Add the particles of the quadtree to the summaries
+extern void analyzeQuadtree(Analysis *a, Quadtree *qt);
+
+// Add the particles of the cells of the node in computeForcesDistributed to the summaries,
+// then sum the summaries of all the nodes on the node 0. The summaries of the other nodes are reset
+extern void analyzeDistributed(Analysis *a, Quadtree *qt);
+
+// Write the summaries in the text file path. Returns 0, or -1 with errno set
+extern int writeAnalysis(Analysis *a, const char *path);
+
+#endif
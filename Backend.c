@@ -0,0 +1,107 @@
+#include "Backend.h"
+
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Private
+
+// Backends by order of preference
+static const Backend *backends[] =
+{
+	&backendAVX512,
+	&backendAVX2,
+#ifdef USE_MKL
+	&backendMKL,
+#endif
+	&backendPCLMUL,
+	&backendScalar
+};
+
+#define NB_BACKENDS ((int)(sizeof(backends) / sizeof(backends[0])))
+
+// Read by every operator: acquire / release, so that a thread seeing it set sees the backend
+static _Atomic(const Backend *) current = NULL;
+
+static const Backend *bestBackend(void)
+{
+	for (int i = 0; i < NB_BACKENDS; i++)
+		if (backends[i]->supported())
+			return backends[i];
+	return &backendScalar;
+}
+
+// Pick the backend requested in BH_BACKEND, or the best one supported
+static const Backend *selectBackend(void)
+{
+	const char *name = getenv("BH_BACKEND");
+	if (name == NULL || strcmp(name, "auto") == 0)
+		return bestBackend();
+
+	for (int i = 0; i < NB_BACKENDS; i++)
+		if (strcmp(backends[i]->name, name) == 0)
+		{
+			if (backends[i]->supported())
+				return backends[i];
+			fprintf(stderr, "# BH_BACKEND=%s is not supported by this CPU, falling back to %s\n",
+					name, bestBackend()->name);
+			return bestBackend();
+		}
+
+	fprintf(stderr, "# Unknown BH_BACKEND=%s, falling back to %s\n", name, bestBackend()->name);
+	return bestBackend();
+}
+
+// Public
+
+// Returns the backend used by the operators, selecting it on the first call
+const Backend *getBackend(void)
+{
+	const Backend *backend = atomic_load_explicit(&current, memory_order_acquire);
+	if (backend == NULL)
+	{
+		#pragma omp critical(backendSelection)
+		{
+			backend = atomic_load_explicit(&current, memory_order_relaxed);
+			if (backend == NULL)
+			{
+				backend = selectBackend();
+				atomic_store_explicit(&current, backend, memory_order_release);
+			}
+		}
+	}
+	return backend;
+}
+
+// Select the backend called name, or the best one supported by the CPU if name
+// is NULL or "auto". Returns 0 on success, -1 if the backend is unknown or unsupported
+int setBackend(const char *name)
+{
+	if (name == NULL || strcmp(name, "auto") == 0)
+	{
+		atomic_store_explicit(&current, bestBackend(), memory_order_release);
+		return 0;
+	}
+
+	for (int i = 0; i < NB_BACKENDS; i++)
+		if (strcmp(backends[i]->name, name) == 0 && backends[i]->supported())
+		{
+			atomic_store_explicit(&current, backends[i], memory_order_release);
+			return 0;
+		}
+
+	return -1;
+}
+
+// Returns the number of backends compiled in this binary
+int getNbBackends(void)
+{
+	return NB_BACKENDS;
+}
+
+// Returns the i-th backend compiled in this binary, supported or not
+const Backend *getBackendNo(int i)
+{
+	return backends[i];
+}
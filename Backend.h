@@ -0,0 +1,56 @@
+#ifndef BACKEND_H
+#define BACKEND_H
+
+#include "Cell.h"
+#include "Multipole.h"
+#include "WorkingVecs.h"
+
+#include <stdint.h>
+
+// Table of the operators of one kernel backend (scalar, AVX2, AVX-512, MKL).
+// The backend is selected once at startup from the CPU features, and can be
+// forced with the environment variable BH_BACKEND=scalar|pclmul|avx2|avx512|mkl
+typedef struct Backend
+{
+	const char *name;
+
+	// Returns 1 if the running CPU can execute this backend
+	int (*supported)(void);
+
+	// Operators, same semantic as the functions of the same name in Cell.h and Morton.h
+	void (*ponP)(double mC, double xC, double yC, double nbParticles, double *m, double *x,
+				 double *y, double *fx, double *fy, WorkingVecs *wv);
+	void (*ponPpot)(double mC, double xC, double yC, double nbParticles, double *m, double *x,
+					double *y, double *fx, double *fy, double *pot, double *vir, WorkingVecs *wv);
+	void (*P2P_in)(Cell *c, WorkingVecs *wv);
+	void (*P2P_ext)(Cell *c1, Cell *c2, WorkingVecs *wv);
+	void (*M2P)(Multipole *m, Cell *c, WorkingVecs *wv);
+	uint64_t (*xy_to_morton)(uint32_t x, uint32_t y);
+	void (*morton_to_xy)(uint64_t key, uint32_t *x, uint32_t *y);
+	void (*xy_to_morton_batch)(int n, const uint32_t *x, const uint32_t *y, uint64_t *keys);
+	void (*morton_to_xy_batch)(int n, const uint64_t *keys, uint32_t *x, uint32_t *y);
+} Backend;
+
+// Backends compiled in this binary
+extern const Backend backendScalar;
+extern const Backend backendAVX2;
+extern const Backend backendAVX512;
+extern const Backend backendPCLMUL;
+#ifdef USE_MKL
+extern const Backend backendMKL;
+#endif
+
+// Returns the backend used by the operators, selecting it on the first call
+extern const Backend *getBackend(void);
+
+// Select the backend called name, or the best one supported by the CPU if name
+// is NULL or "auto". Returns 0 on success, -1 if the backend is unknown or unsupported
+extern int setBackend(const char *name);
+
+// Returns the number of backends compiled in this binary
+extern int getNbBackends(void);
+
+// Returns the i-th backend compiled in this binary, supported or not
+extern const Backend *getBackendNo(int i);
+
+#endif
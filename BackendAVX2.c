@@ -0,0 +1,144 @@
+#include "Backend.h"
+#include "Morton.h"
+
+#include <immintrin.h>
+#include <math.h>
+
+// Kernels for Haswell or better, 4 particles per AVX2 register
+
+static int supportedAVX2(void)
+{
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma") && __builtin_cpu_supports("bmi2");
+}
+
+__attribute__((target("avx2,fma")))
+static inline double hsum(__m256d v)
+{
+	double t[4];
+	_mm256_storeu_pd(t, v);
+	return t[0] + t[1] + t[2] + t[3];
+}
+
+// Forces, and potential and virial if withPot (constant, the branches are optimized out)
+__attribute__((target("avx2,fma"), always_inline))
+static inline void kernel(double mC, double xC, double yC, int n, double *m, double *x, double *y, 
+						  double *fx, double *fy, double *pot, double *vir, const int withPot)
+{
+	int i = 0;
+	__m256d vxC = _mm256_set1_pd(xC);
+	__m256d vyC = _mm256_set1_pd(yC);
+	__m256d vgmC = _mm256_set1_pd(G * mC);
+	__m256d vxx = _mm256_setzero_pd(), vxy = _mm256_setzero_pd(), vyy = _mm256_setzero_pd();
+
+	for (; i + 4 <= n; i += 4)
+	{
+		__m256d dx = _mm256_sub_pd(vxC, _mm256_loadu_pd(x + i));
+		__m256d dy = _mm256_sub_pd(vyC, _mm256_loadu_pd(y + i));
+		__m256d d2 = _mm256_fmadd_pd(dx, dx, _mm256_mul_pd(dy, dy));
+		__m256d d3 = _mm256_mul_pd(d2, _mm256_sqrt_pd(d2));
+		__m256d r = _mm256_div_pd(_mm256_mul_pd(vgmC, _mm256_loadu_pd(m + i)), d3);
+		__m256d rdx = _mm256_mul_pd(r, dx);
+		__m256d rdy = _mm256_mul_pd(r, dy);
+		_mm256_storeu_pd(fx + i, _mm256_add_pd(_mm256_loadu_pd(fx + i), rdx));
+		_mm256_storeu_pd(fy + i, _mm256_add_pd(_mm256_loadu_pd(fy + i), rdy));
+		if (withPot)
+		{
+			_mm256_storeu_pd(pot + i, _mm256_fnmadd_pd(r, d2, _mm256_loadu_pd(pot + i)));
+			vxx = _mm256_fnmadd_pd(rdx, dx, vxx);
+			vxy = _mm256_fnmadd_pd(rdx, dy, vxy);
+			vyy = _mm256_fnmadd_pd(rdy, dy, vyy);
+		}
+	}
+
+	double sxx = 0, sxy = 0, syy = 0;
+	for (; i < n; i++)
+	{
+		double dx = xC - x[i];
+		double dy = yC - y[i];
+		double d2 = dx*dx + dy*dy;
+		double r = G * mC * m[i] / (d2 * sqrt(d2));
+		fx[i] += r * dx;
+		fy[i] += r * dy;
+		if (withPot)
+		{
+			pot[i] -= r * d2;
+			sxx -= r * dx * dx;
+			sxy -= r * dx * dy;
+			syy -= r * dy * dy;
+		}
+	}
+
+	if (withPot)
+	{
+		vir[0] += hsum(vxx) + sxx;
+		vir[1] += hsum(vxy) + sxy;
+		vir[2] += hsum(vyy) + syy;
+	}
+}
+
+__attribute__((target("avx2,fma")))
+static void ponP_avx2(double mC, double xC, double yC,
+					  double nbParticles, double *m, double *x, double *y, double *fx, double *fy,
+					  WorkingVecs *wv)
+{
+	kernel(mC, xC, yC, nbParticles, m, x, y, fx, fy, NULL, NULL, 0);
+}
+
+__attribute__((target("avx2,fma")))
+static void ponPpot_avx2(double mC, double xC, double yC,
+						 double nbParticles, double *m, double *x, double *y, double *fx, double *fy,
+						 double *pot, double *vir, WorkingVecs *wv)
+{
+	kernel(mC, xC, yC, nbParticles, m, x, y, fx, fy, pot, vir, 1);
+}
+
+__attribute__((target("avx2,fma")))
+static void P2P_in_avx2(Cell *c, WorkingVecs *wv)
+{
+	if (c->pot != NULL)
+	{
+		for (int i = 0; i < c->nbParticles; i++)
+		{
+			kernel(c->m[i], c->x[i], c->y[i], i, c->m, c->x, c->y, c->fx, c->fy, c->pot, c->vir, 1);
+			kernel(c->m[i], c->x[i], c->y[i], c->nbParticles - (i+1), c->m + (i+1), c->x + (i+1), 
+				   c->y + (i+1), c->fx + (i+1), c->fy + (i+1), c->pot + (i+1), c->vir, 1);
+		}
+		return;
+	}
+
+	for (int i = 0; i < c->nbParticles; i++)
+	{
+		kernel(c->m[i], c->x[i], c->y[i], i, c->m, c->x, c->y, c->fx, c->fy, NULL, NULL, 0);
+		kernel(c->m[i], c->x[i], c->y[i], c->nbParticles - (i+1), c->m + (i+1), c->x + (i+1), 
+			   c->y + (i+1), c->fx + (i+1), c->fy + (i+1), NULL, NULL, 0);
+	}
+}
+
+__attribute__((target("avx2,fma")))
+static void P2P_ext_avx2(Cell *c1, Cell *c2, WorkingVecs *wv)
+{
+	if (c2->pot != NULL)
+		for (int i = 0; i < c1->nbParticles; i++)
+			kernel(c1->m[i], c1->x[i], c1->y[i], c2->nbParticles, c2->m, c2->x, c2->y, 
+				   c2->fx, c2->fy, c2->pot, c2->vir, 1);
+	else
+		for (int i = 0; i < c1->nbParticles; i++)
+			kernel(c1->m[i], c1->x[i], c1->y[i], c2->nbParticles, c2->m, c2->x, c2->y, 
+				   c2->fx, c2->fy, NULL, NULL, 0);
+}
+
+__attribute__((target("avx2,fma")))
+static void M2P_avx2(Multipole *m, Cell *c, WorkingVecs *wv)
+{
+	if (c->pot != NULL)
+		kernel(m->m, m->x, m->y, c->nbParticles, c->m, c->x, c->y, c->fx, c->fy, c->pot, c->vir, 1);
+	else
+		kernel(m->m, m->x, m->y, c->nbParticles, c->m, c->x, c->y, c->fx, c->fy, NULL, NULL, 0);
+}
+
+const Backend backendAVX2 =
+{
+	"avx2", supportedAVX2, ponP_avx2, ponPpot_avx2, P2P_in_avx2, P2P_ext_avx2, M2P_avx2, 
+	xy_to_morton_bmi2, morton_to_xy_bmi2, xy_to_morton_batch_avx2, morton_to_xy_batch_avx2
+};
@@ -0,0 +1,142 @@
+#include "Backend.h"
+#include "Morton.h"
+
+#include <immintrin.h>
+#include <math.h>
+
+// Kernels for Skylake-SP or better, 8 particles per AVX-512 register
+
+static int supportedAVX512(void)
+{
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("bmi2");
+}
+
+__attribute__((target("avx512f")))
+static inline double hsum(__m512d v)
+{
+	return _mm512_reduce_add_pd(v);
+}
+
+// Forces, and potential and virial if withPot (constant, the branches are optimized out)
+__attribute__((target("avx512f"), always_inline))
+static inline void kernel(double mC, double xC, double yC, int n, double *m, double *x, double *y, 
+						  double *fx, double *fy, double *pot, double *vir, const int withPot)
+{
+	int i = 0;
+	__m512d vxC = _mm512_set1_pd(xC);
+	__m512d vyC = _mm512_set1_pd(yC);
+	__m512d vgmC = _mm512_set1_pd(G * mC);
+	__m512d vxx = _mm512_setzero_pd(), vxy = _mm512_setzero_pd(), vyy = _mm512_setzero_pd();
+
+	for (; i + 8 <= n; i += 8)
+	{
+		__m512d dx = _mm512_sub_pd(vxC, _mm512_loadu_pd(x + i));
+		__m512d dy = _mm512_sub_pd(vyC, _mm512_loadu_pd(y + i));
+		__m512d d2 = _mm512_fmadd_pd(dx, dx, _mm512_mul_pd(dy, dy));
+		__m512d d3 = _mm512_mul_pd(d2, _mm512_sqrt_pd(d2));
+		__m512d r = _mm512_div_pd(_mm512_mul_pd(vgmC, _mm512_loadu_pd(m + i)), d3);
+		__m512d rdx = _mm512_mul_pd(r, dx);
+		__m512d rdy = _mm512_mul_pd(r, dy);
+		_mm512_storeu_pd(fx + i, _mm512_add_pd(_mm512_loadu_pd(fx + i), rdx));
+		_mm512_storeu_pd(fy + i, _mm512_add_pd(_mm512_loadu_pd(fy + i), rdy));
+		if (withPot)
+		{
+			_mm512_storeu_pd(pot + i, _mm512_fnmadd_pd(r, d2, _mm512_loadu_pd(pot + i)));
+			vxx = _mm512_fnmadd_pd(rdx, dx, vxx);
+			vxy = _mm512_fnmadd_pd(rdx, dy, vxy);
+			vyy = _mm512_fnmadd_pd(rdy, dy, vyy);
+		}
+	}
+
+	double sxx = 0, sxy = 0, syy = 0;
+	for (; i < n; i++)
+	{
+		double dx = xC - x[i];
+		double dy = yC - y[i];
+		double d2 = dx*dx + dy*dy;
+		double r = G * mC * m[i] / (d2 * sqrt(d2));
+		fx[i] += r * dx;
+		fy[i] += r * dy;
+		if (withPot)
+		{
+			pot[i] -= r * d2;
+			sxx -= r * dx * dx;
+			sxy -= r * dx * dy;
+			syy -= r * dy * dy;
+		}
+	}
+
+	if (withPot)
+	{
+		vir[0] += hsum(vxx) + sxx;
+		vir[1] += hsum(vxy) + sxy;
+		vir[2] += hsum(vyy) + syy;
+	}
+}
+
+__attribute__((target("avx512f")))
+static void ponP_avx512(double mC, double xC, double yC,
+						double nbParticles, double *m, double *x, double *y, double *fx, double *fy,
+						WorkingVecs *wv)
+{
+	kernel(mC, xC, yC, nbParticles, m, x, y, fx, fy, NULL, NULL, 0);
+}
+
+__attribute__((target("avx512f")))
+static void ponPpot_avx512(double mC, double xC, double yC,
+						   double nbParticles, double *m, double *x, double *y, double *fx, double *fy,
+						   double *pot, double *vir, WorkingVecs *wv)
+{
+	kernel(mC, xC, yC, nbParticles, m, x, y, fx, fy, pot, vir, 1);
+}
+
+__attribute__((target("avx512f")))
+static void P2P_in_avx512(Cell *c, WorkingVecs *wv)
+{
+	if (c->pot != NULL)
+	{
+		for (int i = 0; i < c->nbParticles; i++)
+		{
+			kernel(c->m[i], c->x[i], c->y[i], i, c->m, c->x, c->y, c->fx, c->fy, c->pot, c->vir, 1);
+			kernel(c->m[i], c->x[i], c->y[i], c->nbParticles - (i+1), c->m + (i+1), c->x + (i+1), 
+				   c->y + (i+1), c->fx + (i+1), c->fy + (i+1), c->pot + (i+1), c->vir, 1);
+		}
+		return;
+	}
+
+	for (int i = 0; i < c->nbParticles; i++)
+	{
+		kernel(c->m[i], c->x[i], c->y[i], i, c->m, c->x, c->y, c->fx, c->fy, NULL, NULL, 0);
+		kernel(c->m[i], c->x[i], c->y[i], c->nbParticles - (i+1), c->m + (i+1), c->x + (i+1), 
+			   c->y + (i+1), c->fx + (i+1), c->fy + (i+1), NULL, NULL, 0);
+	}
+}
+
+__attribute__((target("avx512f")))
+static void P2P_ext_avx512(Cell *c1, Cell *c2, WorkingVecs *wv)
+{
+	if (c2->pot != NULL)
+		for (int i = 0; i < c1->nbParticles; i++)
+			kernel(c1->m[i], c1->x[i], c1->y[i], c2->nbParticles, c2->m, c2->x, c2->y, 
+				   c2->fx, c2->fy, c2->pot, c2->vir, 1);
+	else
+		for (int i = 0; i < c1->nbParticles; i++)
+			kernel(c1->m[i], c1->x[i], c1->y[i], c2->nbParticles, c2->m, c2->x, c2->y, 
+				   c2->fx, c2->fy, NULL, NULL, 0);
+}
+
+__attribute__((target("avx512f")))
+static void M2P_avx512(Multipole *m, Cell *c, WorkingVecs *wv)
+{
+	if (c->pot != NULL)
+		kernel(m->m, m->x, m->y, c->nbParticles, c->m, c->x, c->y, c->fx, c->fy, c->pot, c->vir, 1);
+	else
+		kernel(m->m, m->x, m->y, c->nbParticles, c->m, c->x, c->y, c->fx, c->fy, NULL, NULL, 0);
+}
+
+const Backend backendAVX512 =
+{
+	"avx512", supportedAVX512, ponP_avx512, ponPpot_avx512, P2P_in_avx512, P2P_ext_avx512, M2P_avx512, 
+	xy_to_morton_bmi2, morton_to_xy_bmi2, xy_to_morton_batch_avx512, morton_to_xy_batch_avx512
+};
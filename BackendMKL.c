@@ -0,0 +1,148 @@
+#ifdef USE_MKL
+
+#include "Backend.h"
+#include "Morton.h"
+
+#include <mkl.h>
+#include <string.h>
+
+// Kernels built on MKL BLAS and VML, MKL dispatches internally on the instruction set
+
+static int supportedMKL(void)
+{
+	return 1;
+}
+
+static void ponP_mkl(double mC, double xC, double yC,
+					 double nbParticles, double *m, double *x, double *y, double *fx, double *fy,
+					 WorkingVecs *wv)
+{
+	if (nbParticles > 0)
+	{
+		if (nbParticles > wv->size)
+			resizeWorkingVecs(wv, nbParticles);
+
+		// v1 = xI - xC
+		// v2 = (xI - xC)²
+		memcpy(wv->v1, x, nbParticles * sizeof(double));
+		cblas_daxpy(nbParticles, -xC, wv->unitVec, 1, wv->v1, 1);
+		vdMul(nbParticles, wv->v1, wv->v1, wv->v2);
+		
+		// v3 = yI - yC
+		// v4 = (yI - yC)²
+		memcpy(wv->v3, y, nbParticles  * sizeof(double));
+		cblas_daxpy(nbParticles, -yC, wv->unitVec, 1, wv->v3, 1);
+		vdMul(nbParticles, wv->v3, wv->v3, wv->v4);
+
+		// v5 = dI = (xI - xC)² + (yI - yC)²
+		// v4 = dI^(3/2)
+		// v2 = mI / dI^(3/2)
+		vdAdd(nbParticles, wv->v2, wv->v4, wv->v5);
+		vdPow3o2(nbParticles, wv->v5, wv->v4);
+		vdDiv(nbParticles, m, wv->v4, wv->v2);
+
+		// v4 = (xI-xC) * mi / dI^(3/2)
+		// v5 = (yI-yC) * mi / dI^(3/2)
+		vdMul(nbParticles, wv->v1, wv->v2, wv->v4);
+		vdMul(nbParticles, wv->v3, wv->v2, wv->v5);
+
+		// fx = fx - G * mC * (xI-xC) * mi / dI^(3/2)
+		// fy = fy - G * mC * (yI-yC) * mi / dI^(3/2)
+		cblas_daxpy(nbParticles, -G * mC, wv->v4, 1, fx, 1);
+		cblas_daxpy(nbParticles, -G * mC, wv->v5, 1, fy, 1);
+	}
+}
+
+static void ponPpot_mkl(double mC, double xC, double yC,
+						double nbParticles, double *m, double *x, double *y, double *fx, double *fy,
+						double *pot, double *vir, WorkingVecs *wv)
+{
+	if (nbParticles > 0)
+	{
+		if (nbParticles > wv->size)
+			resizeWorkingVecs(wv, nbParticles);
+
+		// v1 = xI - xC, v2 = (xI - xC)²
+		// v3 = yI - yC, v4 = (yI - yC)²
+		memcpy(wv->v1, x, nbParticles * sizeof(double));
+		cblas_daxpy(nbParticles, -xC, wv->unitVec, 1, wv->v1, 1);
+		vdMul(nbParticles, wv->v1, wv->v1, wv->v2);
+		memcpy(wv->v3, y, nbParticles  * sizeof(double));
+		cblas_daxpy(nbParticles, -yC, wv->unitVec, 1, wv->v3, 1);
+		vdMul(nbParticles, wv->v3, wv->v3, wv->v4);
+
+		// v5 = dI, v4 = dI^(3/2), v2 = mI / dI^(3/2)
+		vdAdd(nbParticles, wv->v2, wv->v4, wv->v5);
+		vdPow3o2(nbParticles, wv->v5, wv->v4);
+		vdDiv(nbParticles, m, wv->v4, wv->v2);
+
+		// v5 = mI / sqrt(dI)
+		// pot = pot - G * mC * mI / sqrt(dI)
+		vdMul(nbParticles, wv->v2, wv->v5, wv->v5);
+		cblas_daxpy(nbParticles, -G * mC, wv->v5, 1, pot, 1);
+
+		// v4 = (xI-xC) * mi / dI^(3/2)
+		// v5 = (yI-yC) * mi / dI^(3/2)
+		vdMul(nbParticles, wv->v1, wv->v2, wv->v4);
+		vdMul(nbParticles, wv->v3, wv->v2, wv->v5);
+
+		cblas_daxpy(nbParticles, -G * mC, wv->v4, 1, fx, 1);
+		cblas_daxpy(nbParticles, -G * mC, wv->v5, 1, fy, 1);
+
+		// virial: sums of (xI-xC)*fx, (xI-xC)*fy, (yI-yC)*fy
+		vir[0] -= G * mC * cblas_ddot(nbParticles, wv->v1, 1, wv->v4, 1);
+		vir[1] -= G * mC * cblas_ddot(nbParticles, wv->v1, 1, wv->v5, 1);
+		vir[2] -= G * mC * cblas_ddot(nbParticles, wv->v3, 1, wv->v5, 1);
+	}
+}
+
+static void P2P_in_mkl(Cell *c, WorkingVecs *wv)
+{
+	if (c->pot != NULL)
+	{
+		for (int i = 0; i < c->nbParticles; i++)
+		{
+			ponPpot_mkl(c->m[i], c->x[i], c->y[i], i, c->m, c->x, c->y, c->fx, c->fy, c->pot, c->vir, wv);
+			ponPpot_mkl(c->m[i], c->x[i], c->y[i], c->nbParticles - (i+1), c->m + (i+1), c->x + (i+1), 
+						c->y + (i+1), c->fx + (i+1), c->fy + (i+1), c->pot + (i+1), c->vir, wv);
+		}
+		return;
+	}
+
+	for (int i = 0; i < c->nbParticles; i++)
+	{
+		ponP_mkl(c->m[i], c->x[i], c->y[i], i, c->m, c->x, c->y, c->fx, c->fy, wv);
+		ponP_mkl(c->m[i], c->x[i], c->y[i], c->nbParticles - (i+1), 
+				 c->m + (i+1), c->x + (i+1), c->y + (i+1), c->fx + (i+1), c->fy + (i+1), wv);
+	}
+}
+
+static void P2P_ext_mkl(Cell *c1, Cell *c2, WorkingVecs *wv)
+{
+	if (c2->pot != NULL)
+	{
+		for (int i = 0; i < c1->nbParticles; i++)
+			ponPpot_mkl(c1->m[i], c1->x[i], c1->y[i], c2->nbParticles, c2->m, c2->x, c2->y, 
+						c2->fx, c2->fy, c2->pot, c2->vir, wv);
+		return;
+	}
+
+	for (int i = 0; i < c1->nbParticles; i++)
+		ponP_mkl(c1->m[i], c1->x[i], c1->y[i], c2->nbParticles, c2->m, c2->x, c2->y, c2->fx, c2->fy, wv);
+}
+
+static void M2P_mkl(Multipole *m, Cell *c, WorkingVecs *wv)
+{
+	if (c->pot != NULL)
+		ponPpot_mkl(m->m, m->x, m->y, c->nbParticles, c->m, c->x, c->y, c->fx, c->fy, c->pot, c->vir, wv);
+	else
+		ponP_mkl(m->m, m->x, m->y, c->nbParticles, c->m, c->x, c->y, c->fx, c->fy, wv);
+}
+
+const Backend backendMKL =
+{
+	"mkl", supportedMKL, ponP_mkl, ponPpot_mkl, P2P_in_mkl, P2P_ext_mkl, M2P_mkl, xy_to_morton_generic,
+	morton_to_xy_generic, xy_to_morton_batch_generic, morton_to_xy_batch_generic
+};
+
+#endif
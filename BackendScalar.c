@@ -0,0 +1,114 @@
+#include "Backend.h"
+#include "Morton.h"
+
+#include <math.h>
+
+// Portable kernels, vectorized by the compiler for the baseline instruction set
+
+static int supportedScalar(void)
+{
+	return 1;
+}
+
+// Forces, and potential and virial if withPot (constant, the branches are optimized out)
+static inline __attribute__((always_inline)) 
+void kernel(double mC, double xC, double yC, int n, double *m, double *x, double *y, 
+			double *fx, double *fy, double *pot, double *vir, const int withPot)
+{
+	double gmC = G * mC;
+	double vxx = 0, vxy = 0, vyy = 0;
+
+	#pragma omp simd reduction(+:vxx, vxy, vyy)
+	for (int i = 0; i < n; i++)
+	{
+		double dx = xC - x[i];
+		double dy = yC - y[i];
+		double d2 = dx*dx + dy*dy;
+		double r = gmC * m[i] / (d2 * sqrt(d2));
+		fx[i] += r * dx;
+		fy[i] += r * dy;
+		if (withPot)
+		{
+			pot[i] -= r * d2;
+			vxx -= r * dx * dx;
+			vxy -= r * dx * dy;
+			vyy -= r * dy * dy;
+		}
+	}
+
+	if (withPot)
+	{
+		vir[0] += vxx;
+		vir[1] += vxy;
+		vir[2] += vyy;
+	}
+}
+
+static void ponP_scalar(double mC, double xC, double yC,
+						double nbParticles, double *m, double *x, double *y, double *fx, double *fy,
+						WorkingVecs *wv)
+{
+	kernel(mC, xC, yC, nbParticles, m, x, y, fx, fy, NULL, NULL, 0);
+}
+
+static void ponPpot_scalar(double mC, double xC, double yC,
+						   double nbParticles, double *m, double *x, double *y, double *fx, double *fy,
+						   double *pot, double *vir, WorkingVecs *wv)
+{
+	kernel(mC, xC, yC, nbParticles, m, x, y, fx, fy, pot, vir, 1);
+}
+
+static void P2P_in_scalar(Cell *c, WorkingVecs *wv)
+{
+	if (c->pot != NULL)
+	{
+		for (int i = 0; i < c->nbParticles; i++)
+		{
+			kernel(c->m[i], c->x[i], c->y[i], i, c->m, c->x, c->y, c->fx, c->fy, c->pot, c->vir, 1);
+			kernel(c->m[i], c->x[i], c->y[i], c->nbParticles - (i+1), c->m + (i+1), c->x + (i+1), 
+				   c->y + (i+1), c->fx + (i+1), c->fy + (i+1), c->pot + (i+1), c->vir, 1);
+		}
+		return;
+	}
+
+	for (int i = 0; i < c->nbParticles; i++)
+	{
+		kernel(c->m[i], c->x[i], c->y[i], i, c->m, c->x, c->y, c->fx, c->fy, NULL, NULL, 0);
+		kernel(c->m[i], c->x[i], c->y[i], c->nbParticles - (i+1), c->m + (i+1), c->x + (i+1), 
+			   c->y + (i+1), c->fx + (i+1), c->fy + (i+1), NULL, NULL, 0);
+	}
+}
+
+static void P2P_ext_scalar(Cell *c1, Cell *c2, WorkingVecs *wv)
+{
+	if (c2->pot != NULL)
+		for (int i = 0; i < c1->nbParticles; i++)
+			kernel(c1->m[i], c1->x[i], c1->y[i], c2->nbParticles, c2->m, c2->x, c2->y, 
+				   c2->fx, c2->fy, c2->pot, c2->vir, 1);
+	else
+		for (int i = 0; i < c1->nbParticles; i++)
+			kernel(c1->m[i], c1->x[i], c1->y[i], c2->nbParticles, c2->m, c2->x, c2->y, 
+				   c2->fx, c2->fy, NULL, NULL, 0);
+}
+
+static void M2P_scalar(Multipole *m, Cell *c, WorkingVecs *wv)
+{
+	if (c->pot != NULL)
+		kernel(m->m, m->x, m->y, c->nbParticles, c->m, c->x, c->y, c->fx, c->fy, c->pot, c->vir, 1);
+	else
+		kernel(m->m, m->x, m->y, c->nbParticles, c->m, c->x, c->y, c->fx, c->fy, NULL, NULL, 0);
+}
+
+const Backend backendScalar =
+{
+	"scalar", supportedScalar, ponP_scalar, ponPpot_scalar, P2P_in_scalar, P2P_ext_scalar, M2P_scalar, 
+	xy_to_morton_generic, morton_to_xy_generic, xy_to_morton_batch_generic, morton_to_xy_batch_generic
+};
+
+// Same kernels, with the Morton indices by carry-less multiplication, for the CPUs with 
+// PCLMUL but without BMI2 (Westmere to Ivy Bridge)
+const Backend backendPCLMUL =
+{
+	"pclmul", hasPCLMUL, ponP_scalar, ponPpot_scalar, P2P_in_scalar, P2P_ext_scalar, M2P_scalar, 
+	xy_to_morton_pclmul, morton_to_xy_generic, xy_to_morton_batch_generic, morton_to_xy_batch_generic
+};
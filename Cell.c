@@ -1,17 +1,14 @@
+#include "Backend.h"
 #include "Cell.h"
 #include "utils.h"
 
 #include <float.h>
 #include <malloc.h>
 #include <math.h>
-#include <mkl.h>
 #include <stdlib.h>
 #include <string.h>
 
 
-#define G 6.67e-11 // m^3.kg^-1.s^-2
-
-
 // Initialize a cell with a random number of particles between
 // nbParticlesMin and nbParticlesMax, of random mass between mMin and mMax, and random 
 // positions (x,y) with x between xMin and xMax and y between yMin and yMax
@@ -33,6 +30,9 @@ void initCell(Cell *c, int nbParticlesMin, int nbParticlesMax, double mMin, doub
 		c->fx[i] = 0;
 		c->fy[i] = 0;
 	}
+
+	c->pot = NULL;
+	c->vir[0] = c->vir[1] = c->vir[2] = 0;
 }
 
 // Merge cells in cMerged
@@ -56,6 +56,8 @@ void mergeCell(Cell *cMerged, int nbCells, Cell *cells)
 	cMerged->y = cMerged->x + cMerged->nbParticles;
 	cMerged->fx = cMerged->y + cMerged->nbParticles;
 	cMerged->fy = cMerged->fx + cMerged->nbParticles;
+	cMerged->pot = NULL;
+	cMerged->vir[0] = cMerged->vir[1] = cMerged->vir[2] = 0;
 
 	int p = 0;
 	for (int i = 0; i < nbCells; i++)
@@ -73,6 +75,17 @@ void mergeCell(Cell *cMerged, int nbCells, Cell *cells)
 void freeCell(Cell *c)
 {
 	free(c->m);
+	free(c->pot);
+}
+
+// Enable the computation of the potential energy and virial of the particles of c, 
+// and reset them
+void initPotential(Cell *c)
+{
+	if (c->pot == NULL)
+		c->pot = (double *) malloc(c->nbParticles * sizeof(double));
+	memset(c->pot, 0, c->nbParticles * sizeof(double));
+	c->vir[0] = c->vir[1] = c->vir[2] = 0;
 }
 
 // Returns the distance between the bounding box of a multipole and a cell
@@ -109,6 +122,15 @@ double distance(Multipole *m, Cell *c)
   return d;
 }
 
+// Returns the distance between the boundaries of the area approximated by a multipole
+// and the boundaries of a cell
+double boxDistance(Multipole *m, Cell *c)
+{
+	double dx = max(0, max(m->xMin - c->xMax, c->xMin - m->xMax));
+	double dy = max(0, max(m->yMin - c->yMax, c->yMin - m->yMax));
+	return sqrt(dx*dx + dy*dy);
+}
+
 
 
 
@@ -127,40 +149,7 @@ void ponP(double mC, double xC, double yC,
 		 double nbParticles, double *m, double *x, double *y, double *fx, double *fy,
 		 WorkingVecs *wv)
 {
-	if (nbParticles > 0)
-	{
-		if (nbParticles > wv->size)
-			resizeWorkingVecs(wv, nbParticles);
-
-		// v1 = xI - xC
-		// v2 = (xI - xC)²
-		memcpy(wv->v1, x, nbParticles * sizeof(double));
-		cblas_daxpy(nbParticles, -xC, wv->unitVec, 1, wv->v1, 1);
-		vdMul(nbParticles, wv->v1, wv->v1, wv->v2);
-		
-		// v3 = yI - yC
-		// v4 = (yI - yC)²
-		memcpy(wv->v3, y, nbParticles  * sizeof(double));
-		cblas_daxpy(nbParticles, -yC, wv->unitVec, 1, wv->v3, 1);
-		vdMul(nbParticles, wv->v3, wv->v3, wv->v4);
-
-		// v5 = dI = (xI - xC)² + (yI - yC)²
-		// v4 = dI^(3/2)
-		// v2 = mI / dI^(3/2)
-		vdAdd(nbParticles, wv->v2, wv->v4, wv->v5);
-		vdPow3o2(nbParticles, wv->v5, wv->v4);
-		vdDiv(nbParticles, m, wv->v4, wv->v2);
-
-		// v4 = (xI-xC) * mi / dI^(3/2)
-		// v5 = (yI-yC) * mi / dI^(3/2)
-		vdMul(nbParticles, wv->v1, wv->v2, wv->v4);
-		vdMul(nbParticles, wv->v3, wv->v2, wv->v5);
-
-		// fx = fx - G * mC * (xI-xC) * mi / dI^(3/2)
-		// fy = fy - G * mC * (yI-yC) * mi / dI^(3/2)
-		cblas_daxpy(nbParticles, -G * mC, wv->v4, 1, fx, 1);
-		cblas_daxpy(nbParticles, -G * mC, wv->v5, 1, fy, 1);
-	}
+	getBackend()->ponP(mC, xC, yC, nbParticles, m, x, y, fx, fy, wv);
 }
 
 // Same as pOnP, but naive version for regression tests 
@@ -177,23 +166,56 @@ void ponP_ref(double mC, double xC, double yC, double nbParticles, double *m, do
 	}
 }
 
+// Same as ponP, and in the same pass, adds to pot[i] the potential energy 
+// - G * mC * mi / sqrt(dI) of each particle, and to vir the virial (xx, xy, yy) 
+// of the forces: sum of (xI-xC)*fx, (xI-xC)*fy and (yI-yC)*fy
+void ponPpot(double mC, double xC, double yC, double nbParticles, double *m, double *x, 
+			 double *y, double *fx, double *fy, double *pot, double *vir, WorkingVecs *wv)
+{
+	getBackend()->ponPpot(mC, xC, yC, nbParticles, m, x, y, fx, fy, pot, vir, wv);
+}
 
-// Apply the forces of the particles in c on each other
-void P2P_in(Cell *c, WorkingVecs *wv)
+// Same as ponPpot, but naive version for regression tests 
+void ponPpot_ref(double mC, double xC, double yC, double nbParticles, double *m, double *x, 
+				 double *y, double *fx, double *fy, double *pot, double *vir)
 {
-	for (int i = 0; i < c->nbParticles; i++)
+	for (int i = 0; i < nbParticles; i++)
 	{
-		ponP(c->m[i], c->x[i], c->y[i], i, c->m, c->x, c->y, c->fx, c->fy, wv);
-		ponP(c->m[i], c->x[i], c->y[i], c->nbParticles - (i+1), 
-			c->m + (i+1), c->x + (i+1), c->y + (i+1), c->fx + (i+1), c->fy + (i+1),
-			wv);
+		double dx = xC - x[i];
+		double dy = yC - y[i];
+		double d = sqrt(dx*dx + dy*dy);
+		double r = G * mC * m[i] / pow(dx*dx + dy*dy, 1.5);
+		fx[i] += r * dx;
+		fy[i] += r * dy;
+		pot[i] -= G * mC * m[i] / d;
+		vir[0] -= r * dx * dx;
+		vir[1] -= r * dx * dy;
+		vir[2] -= r * dy * dy;
 	}
 }
 
+
+// Apply the forces of the particles in c on each other
+void P2P_in(Cell *c, WorkingVecs *wv)
+{
+	getBackend()->P2P_in(c, wv);
+}
+
 // Apply the forces of the particles in c on each other naively
 // (for regression test);
 void P2P_inRef(Cell *c)
 {
+	if (c->pot != NULL)
+	{
+		for (int i = 0; i < c->nbParticles; i++)
+		{
+			ponPpot_ref(c->m[i], c->x[i], c->y[i], i, c->m, c->x, c->y, c->fx, c->fy, c->pot, c->vir);
+			ponPpot_ref(c->m[i], c->x[i], c->y[i], c->nbParticles - (i+1), c->m + (i+1), c->x + (i+1), 
+						c->y + (i+1), c->fx + (i+1), c->fy + (i+1), c->pot + (i+1), c->vir);
+		}
+		return;
+	}
+
 	for (int i = 0; i < c->nbParticles; i++)
 	{
 		ponP_ref(c->m[i], c->x[i], c->y[i], i, c->m, c->x, c->y, c->fx, c->fy);
@@ -205,14 +227,21 @@ void P2P_inRef(Cell *c)
 // Apply the forces of the particles in c1 on the particles in c2
 void P2P_ext(Cell *c1, Cell *c2, WorkingVecs *wv)
 {
-	for (int i = 0; i < c1->nbParticles; i++)
-		ponP(c1->m[i], c1->x[i], c1->y[i], c2->nbParticles, c2->m, c2->x, c2->y, c2->fx, c2->fy, wv);	
+	getBackend()->P2P_ext(c1, c2, wv);
 }
 
 // Apply the forces of the particles in c1 on the particles in c2
 // naively (for regression test)
 void P2P_extRef(Cell *c1, Cell *c2)
 {
+	if (c2->pot != NULL)
+	{
+		for (int i = 0; i < c1->nbParticles; i++)
+			ponPpot_ref(c1->m[i], c1->x[i], c1->y[i], c2->nbParticles, c2->m, c2->x, c2->y, 
+						c2->fx, c2->fy, c2->pot, c2->vir);
+		return;
+	}
+
 	for (int i = 0; i < c1->nbParticles; i++)
 		ponP_ref(c1->m[i], c1->x[i], c1->y[i], c2->nbParticles, c2->m, c2->x, c2->y, c2->fx, c2->fy);	
 }
@@ -234,14 +263,15 @@ void P2M(Multipole *m, Cell *c)
 		m->y += c->m[i] * c->y[i];
 	}
 
-	m->x /= m->m;
-	m->y /= m->m;
+	// an empty cell is at its center, its mass is 0 anyway
+	m->x = (m->m > 0) ? m->x / m->m : 0.5 * (c->xMin + c->xMax);
+	m->y = (m->m > 0) ? m->y / m->m : 0.5 * (c->yMin + c->yMax);
 }
 
 // Apply the forces of a multipole m on particles in cell c
 void M2P(Multipole *m, Cell *c, WorkingVecs *wv)
 {
-	ponP(m->m, m->x, m->y, c->nbParticles, c->m, c->x, c->y, c->fx, c->fy, wv);
+	getBackend()->M2P(m, c, wv);
 }
 
 // Approximate sub-multipoles sm by a multipole m
@@ -262,8 +292,8 @@ void M2M(Multipole *m, int nbSms, Multipole *sms)
 		m->yMax = max(m->yMax, sms[i].yMax);
 	}
 
-	m->x /= m->m;
-	m->y /= m->m;	
+	m->x = (m->m > 0) ? m->x / m->m : 0.5 * (m->xMin + m->xMax);
+	m->y = (m->m > 0) ? m->y / m->m : 0.5 * (m->yMin + m->yMax);
 }
 
 
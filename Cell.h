@@ -4,6 +4,8 @@
 #include "Multipole.h"
 #include "WorkingVecs.h"
 
+#define G 6.67e-11 // m^3.kg^-1.s^-2
+
 typedef struct Cell
 {
 	// Boundaries of the cell
@@ -19,6 +21,12 @@ typedef struct Cell
 	double *y;
 	double *fx;
 	double *fy;
+
+	// Optional potential energy of each particle, NULL unless initPotential was called.
+	// When set, the operators below also accumulate it, and the virial of the forces 
+	// exerted on the particles of the cell (xx, xy, yy), in the same pass as the forces
+	double *pot;
+	double vir[3];
 } Cell;
 
 
@@ -34,9 +42,17 @@ extern void mergeCell(Cell *cMerged, int nbCells, Cell *cells);
 // Release ressources associated with the cell c
 extern void freeCell(Cell *c);
 
+// Enable the computation of the potential energy and virial of the particles of c, 
+// and reset them
+extern void initPotential(Cell *c);
+
 // Returns the distance between the bounding box of a multipole and a cell
 extern double distance(Multipole *m, Cell *c);
 
+// Returns the distance between the boundaries of the area approximated by a multipole
+// and the boundaries of a cell
+extern double boxDistance(Multipole *m, Cell *c);
+
 
 // Compute the respective forces (fx[i], fy[i]) exerted by a particle of mass mC in (xC, yC) 
 // over nbParticles of respective masses m[i] in (x[i], y[i]) 
@@ -49,6 +65,7 @@ extern double distance(Multipole *m, Cell *c);
 // i.e projected on x axis : - ((xI-xC) / sqrt(dI)) * F = - G * mC * (xI-xC) * mi / dI^(3/2)
 // and projected on y axis : - ((yI-yC) / sqrt(dI)) * F = - G * mC * (yI-yC) * mi / dI^(3/2)
 // 
+// The computation is done by the kernel backend selected at startup (see Backend.h)
 extern void ponP(double mC, double xC, double yC, double nbParticles, double *m, double *x, 
 				 double *y, double *fx, double *fy, WorkingVecs *wv);
 
@@ -56,6 +73,19 @@ extern void ponP(double mC, double xC, double yC, double nbParticles, double *m,
 extern void ponP_ref(double mC, double xC, double yC, double nbParticles, double *m, 
 					 double *x, double *y, double *fx, double *fy);
 
+// Same as ponP, and in the same pass, adds to pot[i] the potential energy 
+// - G * mC * mi / sqrt(dI) of each particle, and to vir the virial (xx, xy, yy) 
+// of the forces: sum of (xI-xC)*fx, (xI-xC)*fy and (yI-yC)*fy
+//
+// Note: each pair of particles contributes to both of them, the total potential energy 
+// and virial of a system are half the sums of pot and vir over all its particles
+extern void ponPpot(double mC, double xC, double yC, double nbParticles, double *m, double *x, 
+					double *y, double *fx, double *fy, double *pot, double *vir, WorkingVecs *wv);
+
+// Same as ponPpot, but naive version for regression tests 
+extern void ponPpot_ref(double mC, double xC, double yC, double nbParticles, double *m, double *x, 
+						double *y, double *fx, double *fy, double *pot, double *vir);
+
 // Apply the forces of the particles in c on each other
 extern void P2P_in(Cell *c, WorkingVecs *wv);
 
@@ -0,0 +1,244 @@
+#include "Direct.h"
+
+#include <math.h>
+#include <mpi.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#define TARGET_TILE 64
+#define SOURCE_TILE 1024
+#define Z_95 1.959964 // quantile of the normal distribution for 95% confidence intervals
+
+// Private
+
+// Add to the Kahan accumulators (sx, sy, sp) of the targets [tFirst, tLast) the accelerations 
+// and potentials (without G) of the sources [sFirst, sLast). Compiled for each instruction set
+__attribute__((target_clones("avx512f", "avx2", "default")))
+static void tileSum(Cell *c, int tFirst, int tLast, int sFirst, int sLast, 
+					double *sx, double *sy, double *sp, double *cx, double *cy, double *cp)
+{
+	for (int i = tFirst; i < tLast; i++)
+	{
+		double xi = c->x[i], yi = c->y[i];
+		double ax = 0, ay = 0, p = 0;
+
+		#pragma omp simd reduction(+:ax, ay, p)
+		for (int j = sFirst; j < sLast; j++)
+		{
+			double dx = c->x[j] - xi;
+			double dy = c->y[j] - yi;
+			double d2 = dx*dx + dy*dy;
+			// the particle itself (d2 == 0) does not contribute
+			double r = (d2 > 0) ? c->m[j] / (d2 * sqrt(d2)) : 0;
+			ax += r * dx;
+			ay += r * dy;
+			p -= r * d2;
+		}
+
+		int k = i - tFirst;
+		double y, s;
+		y = ax - cx[k]; s = sx[k] + y; cx[k] = (s - sx[k]) - y; sx[k] = s;
+		y = ay - cy[k]; s = sy[k] + y; cy[k] = (s - sy[k]) - y; sy[k] = s;
+		y = p - cp[k]; s = sp[k] + y; cp[k] = (s - sp[k]) - y; sp[k] = s;
+	}
+}
+
+// Add to fx[i], fy[i] the forces exerted by all the particles of c on the targets 
+// i in [first, last) of c
+static void directSumRange(Cell *c, int first, int last)
+{
+	int nbTiles = (last - first + TARGET_TILE - 1) / TARGET_TILE;
+
+	#pragma omp parallel for schedule(dynamic, 1)
+	for (int t = 0; t < nbTiles; t++)
+	{
+		int tFirst = first + t * TARGET_TILE;
+		int tLast = (tFirst + TARGET_TILE < last) ? tFirst + TARGET_TILE : last;
+
+		// Kahan accumulators and compensations of the targets of the tile
+		double sx[TARGET_TILE] = {0}, sy[TARGET_TILE] = {0}, sp[TARGET_TILE] = {0};
+		double cx[TARGET_TILE] = {0}, cy[TARGET_TILE] = {0}, cp[TARGET_TILE] = {0};
+
+		for (int sFirst = 0; sFirst < c->nbParticles; sFirst += SOURCE_TILE)
+		{
+			int sLast = (sFirst + SOURCE_TILE < c->nbParticles) ? sFirst + SOURCE_TILE : c->nbParticles;
+			tileSum(c, tFirst, tLast, sFirst, sLast, sx, sy, sp, cx, cy, cp);
+		}
+
+		for (int i = tFirst; i < tLast; i++)
+		{
+			c->fx[i] += G * c->m[i] * sx[i - tFirst];
+			c->fy[i] += G * c->m[i] * sy[i - tFirst];
+			if (c->pot != NULL)
+				c->pot[i] += G * c->m[i] * sp[i - tFirst];
+		}
+	}
+}
+
+static uint64_t splitmix64(uint64_t *state)
+{
+	uint64_t z = (*state += 0x9E3779B97F4A7C15);
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EB;
+	return z ^ (z >> 31);
+}
+
+static int cmpDbl(const void *p1, const void *p2)
+{
+	if (*(double*)p1 > *(double*)p2) 
+		return 1;
+	else if (*(double*)p1 < *(double*)p2) 
+		return -1;
+	else 
+		return 0;
+}
+
+// Public
+
+// Compute the forces exerted by the particles of c on each other by direct summation 
+// (exact, O(N²)), blocked in tiles of targets x sources that stay in cache, in parallel 
+// over the OpenMP threads, with SIMD over the sources of a tile. 
+// The partial sums of each tile are accumulated in double with Kahan compensated summation. 
+// The forces are added to c->fx and c->fy, as P2P_inRef does, so the result can be fed 
+// to computeRelativeErrors as the reference. The potentials are added to c->pot if it is set
+void directSum(Cell *c)
+{
+	directSumRange(c, 0, c->nbParticles);
+}
+
+// Same as directSum, but the targets are also distributed over the MPI processes.
+// Every process must hold all the particles of c, and gets all the forces
+void directSumDistributed(Cell *c)
+{
+	int rank, size;
+	MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+	MPI_Comm_size(MPI_COMM_WORLD, &size);
+
+	int *counts = (int *) malloc(2 * size * sizeof(int));
+	int *displs = counts + size;
+	for (int r = 0; r < size; r++)
+	{
+		displs[r] = (long)c->nbParticles * r / size;
+		counts[r] = (long)c->nbParticles * (r+1) / size - displs[r];
+	}
+
+	directSumRange(c, displs[rank], displs[rank] + counts[rank]);
+
+	MPI_Allgatherv(MPI_IN_PLACE, 0, MPI_DATATYPE_NULL, c->fx, counts, displs, MPI_DOUBLE, MPI_COMM_WORLD);
+	MPI_Allgatherv(MPI_IN_PLACE, 0, MPI_DATATYPE_NULL, c->fy, counts, displs, MPI_DOUBLE, MPI_COMM_WORLD);
+	if (c->pot != NULL)
+		MPI_Allgatherv(MPI_IN_PLACE, 0, MPI_DATATYPE_NULL, c->pot, counts, displs, MPI_DOUBLE, MPI_COMM_WORLD);
+
+	free(counts);
+}
+
+// Estimate the relative errors d(fx)/fx and d(fy)/fy of the forces of the particles in cells
+// without a full reference: the particles (in curve order) are split into nbSamples strata 
+// of equal size, one particle is picked randomly in each (seeded by seed), and its exact force 
+// is computed by direct summation over all the particles, in parallel over the samples.
+// Costs O(nbSamples * N), cheap enough to monitor the accuracy every few steps
+void sampleRelativeErrors(int nbCells, Cell *cells, int nbSamples, unsigned long seed, 
+						  ErrorEstimate *estimate)
+{
+	long nbParticles = 0;
+	long *firsts = (long *) malloc((nbCells + 1) * sizeof(long));
+	for (int cNo = 0; cNo < nbCells; cNo++)
+	{
+		firsts[cNo] = nbParticles;
+		nbParticles += cells[cNo].nbParticles;
+	}
+	firsts[nbCells] = nbParticles;
+
+	if (nbSamples > nbParticles)
+		nbSamples = nbParticles;
+	if (nbSamples <= 0)
+	{
+		// no particle or no sample: no estimate
+		estimate->nbSamples = 0;
+		for (int q = 0; q < 5; q++)
+			estimate->quantiles[q] = estimate->lower[q] = estimate->upper[q] = NAN;
+		free(firsts);
+		return;
+	}
+	double *errors = (double *) malloc(2 * nbSamples * sizeof(double));
+
+	// Pick the samples serially so that they only depend on seed
+	long *picks = (long *) malloc(nbSamples * sizeof(long));
+	uint64_t state = seed;
+	for (int s = 0; s < nbSamples; s++)
+	{
+		long first = nbParticles * s / nbSamples;
+		long last = nbParticles * (s+1) / nbSamples;
+		picks[s] = first + splitmix64(&state) % (last - first);
+	}
+
+	#pragma omp parallel for schedule(dynamic, 1)
+	for (int s = 0; s < nbSamples; s++)
+	{
+		// find the cell of the sample
+		int lo = 0, hi = nbCells;
+		while (hi - lo > 1)
+		{
+			int mid = (lo + hi) / 2;
+			if (firsts[mid] <= picks[s])
+				lo = mid;
+			else
+				hi = mid;
+		}
+		Cell *t = cells + lo;
+		int i = picks[s] - firsts[lo];
+		double xi = t->x[i], yi = t->y[i];
+
+		double sx = 0, sy = 0, cx = 0, cy = 0;
+		for (int cNo = 0; cNo < nbCells; cNo++)
+		{
+			Cell *c = cells + cNo;
+			double ax = 0, ay = 0;
+
+			#pragma omp simd reduction(+:ax, ay)
+			for (int j = 0; j < c->nbParticles; j++)
+			{
+				double dx = c->x[j] - xi;
+				double dy = c->y[j] - yi;
+				double d2 = dx*dx + dy*dy;
+				double r = (d2 > 0) ? c->m[j] / (d2 * sqrt(d2)) : 0;
+				ax += r * dx;
+				ay += r * dy;
+			}
+
+			double y, sum;
+			y = ax - cx; sum = sx + y; cx = (sum - sx) - y; sx = sum;
+			y = ay - cy; sum = sy + y; cy = (sum - sy) - y; sy = sum;
+		}
+
+		double fx = G * t->m[i] * sx, fy = G * t->m[i] * sy;
+		errors[2*s] = fabs(t->fx[i] - fx) / fabs(fx);
+		errors[2*s + 1] = fabs(t->fy[i] - fy) / fabs(fy);
+	}
+
+	int n = 2 * nbSamples;
+	qsort(errors, n, sizeof(double), cmpDbl);
+
+	const double probs[5] = {0, 0.25, 0.5, 0.75, 1};
+	estimate->nbSamples = nbSamples;
+	for (int q = 0; q < 5; q++)
+	{
+		// the rank of the p-quantile in the sample is binomial(nbSamples, p), 
+		// the errors in x and y of a particle are not independent and count as one sample
+		double p = probs[q];
+		double halfWidth = 2 * Z_95 * sqrt(nbSamples * p * (1 - p));
+		int rank = (int)(p * (n - 1));
+		int lower = (int)floor(p * n - halfWidth);
+		int upper = (int)ceil(p * n + halfWidth);
+		lower = (lower < 0) ? 0 : lower;
+		upper = (upper > n - 1) ? n - 1 : upper;
+
+		estimate->quantiles[q] = errors[rank];
+		estimate->lower[q] = errors[lower];
+		estimate->upper[q] = errors[upper];
+	}
+
+	free(firsts);
+	free(picks);
+	free(errors);
+}
@@ -0,0 +1,43 @@
+#ifndef DIRECT_H
+#define DIRECT_H
+
+#include "Cell.h"
+
+// Reference solver for the validation of the tree code at production scale.
+//
+// Compute the forces exerted by the particles of c on each other by direct summation 
+// (exact, O(N²)), blocked in tiles of targets x sources that stay in cache, in parallel 
+// over the OpenMP threads, with SIMD over the sources of a tile. 
+// The partial sums of each tile are accumulated in double with Kahan compensated summation. 
+// The forces are added to c->fx and c->fy, as P2P_inRef does, so the result can be fed 
+// to computeRelativeErrors as the reference. The potentials are added to c->pot if it is set
+extern void directSum(Cell *c);
+
+// Same as directSum, but the targets are also distributed over the MPI processes.
+// Every process must hold all the particles of c, and gets all the forces
+extern void directSumDistributed(Cell *c);
+
+// Error quantiles of a force computation estimated from a sample of particles
+typedef struct ErrorEstimate
+{
+	int nbSamples;
+
+	// min, 1st quartile, median, 3rd quartile and max of the sampled relative errors
+	double quantiles[5];
+
+	// bounds of the 95% confidence intervals of the quantiles (distribution-free, 
+	// from the order statistics). Those of the min and max are the sampled values
+	double lower[5];
+	double upper[5];
+} ErrorEstimate;
+
+// Estimate the relative errors d(fx)/fx and d(fy)/fy of the forces of the particles in cells
+// without a full reference: the particles (in curve order) are split into nbSamples strata 
+// of equal size, one particle is picked randomly in each (seeded by seed), and its exact force 
+// is computed by direct summation over all the particles, in parallel over the samples.
+// Costs O(nbSamples * N), cheap enough to monitor the accuracy every few steps.
+// Without particles, or with nbSamples <= 0, estimate->nbSamples is 0 and the quantiles are NaN
+extern void sampleRelativeErrors(int nbCells, Cell *cells, int nbSamples, unsigned long seed, 
+								 ErrorEstimate *estimate);
+
+#endif
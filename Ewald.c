@@ -0,0 +1,210 @@
+#include "Ewald.h"
+
+#include <malloc.h>
+#include <math.h>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+#define ALPHA_PERIODS 2.0      // splitting parameter, in inverse smallest period
+#define REAL_CUTOFF 3.5        // real space sum cutoff, in smallest period
+
+// Private
+
+// Bring the offset d back in [-L/2, L/2]
+static inline double minimumImage(double d, double L)
+{
+	return d - L * rint(d / L);
+}
+
+// Bilinear interpolation of the Ewald correction at the minimum image offset (dx, dy)
+static inline void ewaldCorrection(Ewald *ew, double dx, double dy, double *cx, double *cy)
+{
+	int n = ew->tableSize;
+	double u = fabs(dx) / ew->hX;
+	double v = fabs(dy) / ew->hY;
+	int iu = (int)u, iv = (int)v;
+	iu = (iu < n) ? iu : n - 1;
+	iv = (iv < n) ? iv : n - 1;
+	double fu = u - iu, fv = v - iv;
+
+	int k = iv * (n + 1) + iu;
+	double w00 = (1 - fu) * (1 - fv), w10 = fu * (1 - fv), w01 = (1 - fu) * fv, w11 = fu * fv;
+	double tx = w00 * ew->corrX[k] + w10 * ew->corrX[k+1] + w01 * ew->corrX[k+n+1] + w11 * ew->corrX[k+n+2];
+	double ty = w00 * ew->corrY[k] + w10 * ew->corrY[k+1] + w01 * ew->corrY[k+n+1] + w11 * ew->corrY[k+n+2];
+
+	// x component odd in dx and even in dy, and conversely
+	*cx = (dx < 0) ? -tx : tx;
+	*cy = (dy < 0) ? -ty : ty;
+}
+
+// Public
+
+// Initialize the periodic boundary conditions of the area of the quadtree qt,
+// with a correction table of tableSize intervals over half a period
+void initEwald(Ewald *ew, Quadtree *qt, int tableSize)
+{
+	ew->Lx = qt->xMax - qt->xMin;
+	ew->Ly = qt->yMax - qt->yMin;
+	double L = fmin(ew->Lx, ew->Ly);
+	ew->alpha = ALPHA_PERIODS / L;
+
+	// the first image left out is beyond 3.5 L, where erfc(alpha r) < erfc(7),
+	// the first wave vector left out is beyond 2*pi*4/L, where erfc(k/2alpha) < erfc(2*pi)
+	ew->nbImagesX = (int)ceil(REAL_CUTOFF * L / ew->Lx - 0.5);
+	ew->nbImagesY = (int)ceil(REAL_CUTOFF * L / ew->Ly - 0.5);
+	ew->nbWavesX = (int)ceil(2 * ALPHA_PERIODS * ew->Lx / L);
+	ew->nbWavesY = (int)ceil(2 * ALPHA_PERIODS * ew->Ly / L);
+
+	int n = tableSize;
+	ew->tableSize = n;
+	ew->hX = 0.5 * ew->Lx / n;
+	ew->hY = 0.5 * ew->Ly / n;
+	ew->corrX = (double *) malloc(2 * (n+1) * (n+1) * sizeof(double));
+	ew->corrY = ew->corrX + (n+1) * (n+1);
+
+	// the correction vanishes at the origin, by symmetry of the lattice
+	#pragma omp parallel for schedule(dynamic, 1)
+	for (int iv = 0; iv <= n; iv++)
+		for (int iu = 0; iu <= n; iu++)
+		{
+			int k = iv * (n + 1) + iu;
+			ew->corrX[k] = ew->corrY[k] = 0;
+			if (iu == 0 && iv == 0)
+				continue;
+
+			double dx = iu * ew->hX, dy = iv * ew->hY;
+			double fx, fy;
+			ewaldForce(ew, dx, dy, &fx, &fy);
+			double d = sqrt(dx*dx + dy*dy);
+			ew->corrX[k] = fx - dx / (d*d*d);
+			ew->corrY[k] = fy - dy / (d*d*d);
+		}
+}
+
+// Release the ressources associated with the Ewald tables
+void freeEwald(Ewald *ew)
+{
+	free(ew->corrX);
+}
+
+// Compute the gravitationnal force exerted on each particule of the quadtree and all
+// their periodic images. The multipoles must have been computed.
+// The potential energy and the virial are not computed in this mode
+void computeForcesPeriodic(Quadtree *qt, Ewald *ew, double farFieldLimit)
+{
+	qt->ewald = ew;
+	computeForces(qt, farFieldLimit);
+	qt->ewald = NULL;
+}
+
+// Force (fx, fy) exerted on a unit mass by a unit mass at offset (dx, dy) and all its
+// images, by the Ewald summation, without G (for tests and tables)
+//
+// Note: with the splitting 1/r = erfc(alpha r)/r + erf(alpha r)/r, the first part is summed
+// over the images, and the second one over the reciprocal lattice, the 2D Fourier transform
+// of erf(alpha r)/r being 2 pi/k erfc(k/2alpha). The k = 0 term is the uniform background
+void ewaldForce(Ewald *ew, double dx, double dy, double *fx, double *fy)
+{
+	double a = ew->alpha;
+	double sx = 0, sy = 0;
+
+	for (int j = -ew->nbImagesY; j <= ew->nbImagesY; j++)
+		for (int i = -ew->nbImagesX; i <= ew->nbImagesX; i++)
+		{
+			double rx = dx + i * ew->Lx, ry = dy + j * ew->Ly;
+			double r2 = rx*rx + ry*ry;
+			if (r2 == 0)
+				continue;
+			double r = sqrt(r2);
+			double f = (erfc(a * r) + 2 * a * r / sqrt(M_PI) * exp(-a * a * r2)) / (r2 * r);
+			sx += f * rx;
+			sy += f * ry;
+		}
+
+	double area = ew->Lx * ew->Ly;
+	for (int j = -ew->nbWavesY; j <= ew->nbWavesY; j++)
+		for (int i = -ew->nbWavesX; i <= ew->nbWavesX; i++)
+		{
+			if (i == 0 && j == 0)
+				continue;
+			double kx = 2 * M_PI * i / ew->Lx, ky = 2 * M_PI * j / ew->Ly;
+			double k = sqrt(kx*kx + ky*ky);
+			double f = 2 * M_PI / area * erfc(k / (2 * a)) * sin(kx * dx + ky * dy) / k;
+			sx += f * kx;
+			sy += f * ky;
+		}
+
+	*fx = sx;
+	*fy = sy;
+}
+
+// Apply the forces of the particles in c and of all their images on each other
+// by the Ewald summation of each pair, naive version for regression tests
+void ewaldDirectSum(Ewald *ew, Cell *c)
+{
+	#pragma omp parallel for schedule(dynamic, 16)
+	for (int i = 0; i < c->nbParticles; i++)
+		for (int j = 0; j < c->nbParticles; j++)
+		{
+			if (j == i)
+				continue;
+			double fx, fy;
+			ewaldForce(ew, minimumImage(c->x[j] - c->x[i], ew->Lx),
+					   minimumImage(c->y[j] - c->y[i], ew->Ly), &fx, &fy);
+			c->fx[i] += G * c->m[i] * c->m[j] * fx;
+			c->fy[i] += G * c->m[i] * c->m[j] * fy;
+		}
+}
+
+// Copy in image the multipole m moved to the image of its center of mass nearest to c
+void periodicImage(Ewald *ew, Multipole *m, Cell *c, Multipole *image)
+{
+	double sx = -ew->Lx * rint((m->x - 0.5 * (c->xMin + c->xMax)) / ew->Lx);
+	double sy = -ew->Ly * rint((m->y - 0.5 * (c->yMin + c->yMax)) / ew->Ly);
+	initMultipole(image, m->m, m->x + sx, m->y + sy, m->xMin + sx, m->xMax + sx, m->yMin + sy, m->yMax + sy);
+}
+
+// Periodic versions of the operators of Cell.h: minimum image offsets plus Ewald correction
+void ponPperiodic(Ewald *ew, double mC, double xC, double yC, int nbParticles, double *m,
+				  double *x, double *y, double *fx, double *fy)
+{
+	double gmC = G * mC;
+
+	#pragma omp simd
+	for (int i = 0; i < nbParticles; i++)
+	{
+		double dx = minimumImage(xC - x[i], ew->Lx);
+		double dy = minimumImage(yC - y[i], ew->Ly);
+		double d2 = dx*dx + dy*dy;
+		double cx, cy;
+		ewaldCorrection(ew, dx, dy, &cx, &cy);
+
+		double r = gmC * m[i];
+		double id3 = 1 / (d2 * sqrt(d2));
+		fx[i] += r * (dx * id3 + cx);
+		fy[i] += r * (dy * id3 + cy);
+	}
+}
+
+void P2P_inPeriodic(Ewald *ew, Cell *c)
+{
+	for (int i = 0; i < c->nbParticles; i++)
+	{
+		ponPperiodic(ew, c->m[i], c->x[i], c->y[i], i, c->m, c->x, c->y, c->fx, c->fy);
+		ponPperiodic(ew, c->m[i], c->x[i], c->y[i], c->nbParticles - (i+1),
+					 c->m + (i+1), c->x + (i+1), c->y + (i+1), c->fx + (i+1), c->fy + (i+1));
+	}
+}
+
+void P2P_extPeriodic(Ewald *ew, Cell *c1, Cell *c2)
+{
+	for (int i = 0; i < c1->nbParticles; i++)
+		ponPperiodic(ew, c1->m[i], c1->x[i], c1->y[i], c2->nbParticles, c2->m, c2->x, c2->y, c2->fx, c2->fy);
+}
+
+void M2Pperiodic(Ewald *ew, Multipole *m, Cell *c)
+{
+	ponPperiodic(ew, m->m, m->x, m->y, c->nbParticles, c->m, c->x, c->y, c->fx, c->fy);
+}
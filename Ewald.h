@@ -0,0 +1,72 @@
+#ifndef EWALD_H
+#define EWALD_H
+
+#include "Cell.h"
+#include "Multipole.h"
+#include "Quadtree.h"
+
+// Periodic boundary conditions: the area of the quadtree is the period of an infinite
+// lattice of images. The force exerted by a particle at offset r and all its images is
+//
+// 		F(r) = sum over the images n of (r + n) / |r + n|³ = r / |r|³ + C(r)
+//
+// where r is the minimum image offset, and C the Ewald correction, smooth over the period.
+// The sum is only conditionnally convergent, it is computed by an Ewald summation
+// (real space sum of the erfc screened force and reciprocal space sum of the erf one),
+// equivalent to a neutralizing uniform background.
+// C is odd, so it is tabulated on a quarter of the period and interpolated bilinearly by
+// the periodic operators, used by the tree walk for the near field and the far field.
+// A vertex is seen at the image of its center of mass nearest to the cell, as F is smooth
+// and periodic the multipole approximation stays valid.
+
+typedef struct Ewald
+{
+	double Lx;                 // periods
+	double Ly;
+	double alpha;              // splitting parameter of the Ewald summation
+
+	// number of images and of wave vectors of the sums, per side
+	int nbImagesX;
+	int nbImagesY;
+	int nbWavesX;
+	int nbWavesY;
+
+	// C on [0, Lx/2]*[0, Ly/2], (tableSize+1)² nodes per component
+	int tableSize;
+	double hX;
+	double hY;
+	double *corrX;
+	double *corrY;
+} Ewald;
+
+// Initialize the periodic boundary conditions of the area of the quadtree qt,
+// with a correction table of tableSize intervals over half a period
+extern void initEwald(Ewald *ew, Quadtree *qt, int tableSize);
+
+// Release the ressources associated with the Ewald tables
+extern void freeEwald(Ewald *ew);
+
+// Compute the gravitationnal force exerted on each particule of the quadtree and all
+// their periodic images. The multipoles must have been computed.
+// The potential energy and the virial are not computed in this mode, computeEnergy fails afterwards
+extern void computeForcesPeriodic(Quadtree *qt, Ewald *ew, double farFieldLimit);
+
+// Force (fx, fy) exerted on a unit mass by a unit mass at offset (dx, dy) and all its
+// images, by the Ewald summation, without G (for tests and tables)
+extern void ewaldForce(Ewald *ew, double dx, double dy, double *fx, double *fy);
+
+// Apply the forces of the particles in c and of all their images on each other
+// by the Ewald summation of each pair, naive version for regression tests
+extern void ewaldDirectSum(Ewald *ew, Cell *c);
+
+// Copy in image the multipole m moved to the image of its center of mass nearest to c
+extern void periodicImage(Ewald *ew, Multipole *m, Cell *c, Multipole *image);
+
+// Periodic versions of the operators of Cell.h: minimum image offsets plus Ewald correction
+extern void ponPperiodic(Ewald *ew, double mC, double xC, double yC, int nbParticles, double *m,
+						 double *x, double *y, double *fx, double *fy);
+extern void P2P_inPeriodic(Ewald *ew, Cell *c);
+extern void P2P_extPeriodic(Ewald *ew, Cell *c1, Cell *c2);
+extern void M2Pperiodic(Ewald *ew, Multipole *m, Cell *c);
+
+#endif
@@ -0,0 +1,89 @@
+#include "FFT.h"
+
+#include <malloc.h>
+#include <math.h>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+// Private
+
+// In-place iterative radix-2 complex FFT of n points (n power of 2)
+static void fft1d(double *data, int n, int sign)
+{
+	// bit reversal permutation
+	for (int i = 1, j = 0; i < n; i++)
+	{
+		int bit = n >> 1;
+		for (; j & bit; bit >>= 1)
+			j ^= bit;
+		j ^= bit;
+		if (i < j)
+		{
+			double re = data[2*i], im = data[2*i+1];
+			data[2*i] = data[2*j]; data[2*i+1] = data[2*j+1];
+			data[2*j] = re; data[2*j+1] = im;
+		}
+	}
+
+	// butterflies
+	for (int len = 2; len <= n; len <<= 1)
+	{
+		double angle = sign * 2 * M_PI / len;
+		double wRe = cos(angle), wIm = sin(angle);
+		for (int i = 0; i < n; i += len)
+		{
+			double uRe = 1, uIm = 0;
+			for (int k = 0; k < len / 2; k++)
+			{
+				double *a = data + 2*(i + k), *b = data + 2*(i + k + len/2);
+				double tRe = b[0] * uRe - b[1] * uIm;
+				double tIm = b[0] * uIm + b[1] * uRe;
+				b[0] = a[0] - tRe; b[1] = a[1] - tIm;
+				a[0] += tRe; a[1] += tIm;
+
+				double nRe = uRe * wRe - uIm * wIm;
+				uIm = uRe * wIm + uIm * wRe;
+				uRe = nRe;
+			}
+		}
+	}
+}
+
+// Public
+
+// In-place 2D complex FFT of an n x n array (n power of 2), stored by rows
+// with interleaved real and imaginary parts (2*n*n doubles).
+// sign = -1 for the forward transform, +1 for the inverse one (normalized by 1/n²).
+// Rows and columns are transformed in parallel
+void fft2d(double *data, int n, int sign)
+{
+	#pragma omp parallel
+	{
+		double *column = (double *) malloc(2 * n * sizeof(double));
+
+		#pragma omp for schedule(static)
+		for (int row = 0; row < n; row++)
+			fft1d(data + 2*row*n, n, sign);
+
+		#pragma omp for schedule(static)
+		for (int col = 0; col < n; col++)
+		{
+			for (int row = 0; row < n; row++)
+			{
+				column[2*row] = data[2*(row*n + col)];
+				column[2*row+1] = data[2*(row*n + col) + 1];
+			}
+			fft1d(column, n, sign);
+			double scale = (sign > 0) ? 1.0 / ((double)n * n) : 1.0;
+			for (int row = 0; row < n; row++)
+			{
+				data[2*(row*n + col)] = scale * column[2*row];
+				data[2*(row*n + col) + 1] = scale * column[2*row+1];
+			}
+		}
+
+		free(column);
+	}
+}
@@ -0,0 +1,10 @@
+#ifndef FFT_H
+#define FFT_H
+
+// In-place 2D complex FFT of an n x n array (n power of 2), stored by rows
+// with interleaved real and imaginary parts (2*n*n doubles).
+// sign = -1 for the forward transform, +1 for the inverse one (normalized by 1/n²).
+// Rows and columns are transformed in parallel
+extern void fft2d(double *data, int n, int sign);
+
+#endif
@@ -0,0 +1,160 @@
+#include "Generator.h"
+
+#include <math.h>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+#define MAX_ATTEMPTS 64          // draws of a position before it is clamped to the area
+#define CENTERS_BLOCK 0x7FFFFFFF // block of the counters of the centers of the clusters
+
+// Private
+
+static inline uint32_t mulhilo(uint32_t a, uint32_t b, uint32_t *hi)
+{
+	uint64_t p = (uint64_t)a * b;
+	*hi = (uint32_t)(p >> 32);
+	return (uint32_t)p;
+}
+
+// 4 uniform numbers in ]0, 1[ for the particle i, from the counters 2 block and 2 block + 1 
+// of its stream: 53 bits from 2 words each, shifted by half a step away from 0
+static void uniforms(Generator *gen, uint64_t i, uint32_t block, double u[4])
+{
+	uint32_t key[2] = {(uint32_t)gen->seed, (uint32_t)(gen->seed >> 32)};
+
+	for (int k = 0; k < 2; k++)
+	{
+		uint32_t ctr[4] = {(uint32_t)i, (uint32_t)(i >> 32), 2 * block + k, gen->stream};
+		uint32_t out[4];
+		philox4x32(ctr, key, out);
+
+		uint64_t a = ((uint64_t)out[0] << 32) | out[1], b = ((uint64_t)out[2] << 32) | out[3];
+		u[2*k] = ((a >> 11) + 0.5) * 0x1p-53;
+		u[2*k+1] = ((b >> 11) + 0.5) * 0x1p-53;
+	}
+}
+
+static inline int inArea(Generator *gen, double x, double y)
+{
+	return x >= gen->xMin && x < gen->xMax && y >= gen->yMin && y < gen->yMax;
+}
+
+// Draw the position (x, y) of the particle i from u[1], u[2] and u[3], the numbers of its 
+// block 0, u[0] being its mass. The next blocks are drawn if the position is out of the area
+static void drawPosition(Generator *gen, uint64_t i, double u[4], double *x, double *y)
+{
+	double w = gen->xMax - gen->xMin, h = gen->yMax - gen->yMin;
+	double xC = gen->xMin + 0.5 * w, yC = gen->yMin + 0.5 * h;
+	double rMax = 0.5 * fmin(w, h), a = gen->scale;
+
+	for (uint32_t block = 1; block <= MAX_ATTEMPTS; block++)
+	{
+		double r = 0, theta = 2 * M_PI * u[2];
+
+		switch (gen->distribution)
+		{
+		case UNIFORM_DISTRIBUTION:
+			*x = gen->xMin + u[1] * w;
+			*y = gen->yMin + u[2] * h;
+			break;
+
+		case PLUMMER_DISTRIBUTION:
+			// mass inside R: R² / (R² + a²), inverted below rMax
+			r = u[1] * rMax * rMax / (rMax * rMax + a * a);
+			r = a * sqrt(r / (1 - r));
+			*x = xC + r * cos(theta);
+			*y = yC + r * sin(theta);
+			break;
+
+		case EXPONENTIAL_DISK_DISTRIBUTION:
+			// R exp(-R/a) is the density of the sum of 2 exponential variables
+			r = -a * log(u[1] * u[3]);
+			*x = xC + r * cos(theta);
+			*y = yC + r * sin(theta);
+			break;
+
+		case GAUSSIAN_MIXTURE_DISTRIBUTION:
+		{
+			// the centers are drawn on their own block, 2 deviations away from the boundaries
+			double v[4];
+			int k = (int)(u[1] * gen->nbClusters);
+			uniforms(gen, k, CENTERS_BLOCK, v);
+			double mx = fmin(2 * a, 0.5 * w), my = fmin(2 * a, 0.5 * h);
+			double cx = gen->xMin + mx + v[0] * (w - 2 * mx);
+			double cy = gen->yMin + my + v[1] * (h - 2 * my);
+
+			// Box-Muller
+			r = a * sqrt(-2 * log(u[3]));
+			*x = cx + r * cos(theta);
+			*y = cy + r * sin(theta);
+			break;
+		}
+		}
+
+		if (inArea(gen, *x, *y))
+			return;
+		uniforms(gen, i, block, u);
+	}
+
+	*x = fmin(fmax(*x, gen->xMin), nextafter(gen->xMax, gen->xMin));
+	*y = fmin(fmax(*y, gen->yMin), nextafter(gen->yMax, gen->yMin));
+}
+
+// Public
+
+// Philox4x32-10: encrypt the counter ctr with the key into out
+void philox4x32(const uint32_t ctr[4], const uint32_t key[2], uint32_t out[4])
+{
+	uint32_t c0 = ctr[0], c1 = ctr[1], c2 = ctr[2], c3 = ctr[3];
+	uint32_t k0 = key[0], k1 = key[1];
+
+	for (int round = 0; round < 10; round++)
+	{
+		uint32_t hi0, hi1;
+		uint32_t lo0 = mulhilo(0xD2511F53, c0, &hi0);
+		uint32_t lo1 = mulhilo(0xCD9E8D57, c2, &hi1);
+		c0 = hi1 ^ c1 ^ k0;
+		c1 = lo1;
+		c2 = hi0 ^ c3 ^ k1;
+		c3 = lo0;
+		k0 += 0x9E3779B9;
+		k1 += 0xBB67AE85;
+	}
+
+	out[0] = c0; out[1] = c1; out[2] = c2; out[3] = c3;
+}
+
+// Initialize a generator of the specified distribution over the area [xMin, xMax]*[yMin, yMax],
+// of masses in [mMin, mMax], on the stream 0. The scale is an eighth of the smallest side
+// of the area, and there are 8 clusters
+void initGenerator(Generator *gen, Distribution distribution, uint64_t seed, double mMin,
+				   double mMax, double xMin, double xMax, double yMin, double yMax)
+{
+	gen->distribution = distribution;
+	gen->seed = seed;
+	gen->stream = 0;
+	gen->mMin = mMin;
+	gen->mMax = mMax;
+	gen->xMin = xMin;
+	gen->xMax = xMax;
+	gen->yMin = yMin;
+	gen->yMax = yMax;
+	gen->scale = 0.125 * fmin(xMax - xMin, yMax - yMin);
+	gen->nbClusters = 8;
+}
+
+// Generate the particles first to first+n-1 of the generator in (m[i], x[i], y[i]),
+// in parallel
+void generateParticles(Generator *gen, long first, int n, double *m, double *x, double *y)
+{
+	#pragma omp parallel for schedule(static)
+	for (int i = 0; i < n; i++)
+	{
+		double u[4];
+		uniforms(gen, first + i, 0, u);
+		m[i] = gen->mMin + u[0] * (gen->mMax - gen->mMin);
+		drawPosition(gen, first + i, u, x + i, y + i);
+	}
+}
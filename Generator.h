@@ -0,0 +1,55 @@
+#ifndef GENERATOR_H
+#define GENERATOR_H
+
+#include <stdint.h>
+
+// Parallel generator of particles, on the counter-based random number generator Philox4x32-10
+// (Salmon et al., 2011): the random numbers of the particle i are the encryption of the counter
+// (i, block, stream) with the key seed, so that any range of particles can be generated by
+// any thread or process, in any order, with the same result.
+// Unlike randDouble, the numbers have the 53 bits of precision of a double.
+
+// Distribution of the positions, centered on the area
+typedef enum Distribution
+{
+	UNIFORM_DISTRIBUTION,         // uniform over the area
+	PLUMMER_DISTRIBUTION,         // surface density of a projected Plummer sphere of radius scale
+	EXPONENTIAL_DISK_DISTRIBUTION,// surface density exp(-R/scale)
+	GAUSSIAN_MIXTURE_DISTRIBUTION // nbClusters gaussians of deviation scale, at random centers
+} Distribution;
+
+typedef struct Generator
+{
+	Distribution distribution;
+	uint64_t seed;
+	uint32_t stream;              // independent streams for the same seed
+
+	// masses, uniform in [mMin, mMax]
+	double mMin;
+	double mMax;
+
+	// area, the particles are drawn inside it
+	double xMin;
+	double xMax;
+	double yMin;
+	double yMax;
+
+	// parameters of the distributions
+	double scale;
+	int nbClusters;
+} Generator;
+
+// Philox4x32-10: encrypt the counter ctr with the key into out
+extern void philox4x32(const uint32_t ctr[4], const uint32_t key[2], uint32_t out[4]);
+
+// Initialize a generator of the specified distribution over the area [xMin, xMax]*[yMin, yMax],
+// of masses in [mMin, mMax], on the stream 0. The scale is an eighth of the smallest side
+// of the area, and there are 8 clusters
+extern void initGenerator(Generator *gen, Distribution distribution, uint64_t seed, double mMin,
+						  double mMax, double xMin, double xMax, double yMin, double yMax);
+
+// Generate the particles first to first+n-1 of the generator in (m[i], x[i], y[i]),
+// in parallel
+extern void generateParticles(Generator *gen, long first, int n, double *m, double *x, double *y);
+
+#endif
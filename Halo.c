@@ -0,0 +1,260 @@
+#include "Halo.h"
+
+#include <malloc.h>
+#include <math.h>
+#include <mpi.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Header of an encoded cell: its number, number of particles and bounding box
+#define HEADER_SIZE (2 * sizeof(int32_t) + 4 * sizeof(double))
+
+// Private
+
+// Size of the quantized coordinates, 0 for doubles
+static inline int coordinateBits(HaloEncoding encoding)
+{
+	return (encoding == HALO_QUANTIZED_32) ? 32 : (encoding == HALO_QUANTIZED_16) ? 16 : 0;
+}
+
+// Quantize v in [vMin, vMin + (2^bits - 1) / scale] on bits bits, and back
+static inline uint32_t quantize(double v, double vMin, double scale, int bits)
+{
+	double q = rint((v - vMin) * scale), qMax = (bits == 32) ? UINT32_MAX : UINT16_MAX;
+	return (q <= 0) ? 0 : (q >= qMax) ? (uint32_t)qMax : (uint32_t)q;
+}
+
+static inline double dequantize(uint32_t q, double vMin, double scale)
+{
+	return (scale > 0) ? vMin + q / scale : vMin;
+}
+
+static inline double quantizationScale(double vMin, double vMax, int bits)
+{
+	double qMax = (bits == 32) ? UINT32_MAX : UINT16_MAX;
+	return (vMax > vMin) ? qMax / (vMax - vMin) : 0;
+}
+
+static int cmpInt(const void *p1, const void *p2)
+{
+	int a = *(const int *)p1, b = *(const int *)p2;
+	return (a > b) - (a < b);
+}
+
+// Public
+
+// Returns the size of a cell of nbParticles particles encoded with encoding
+size_t encodedCellSize(int nbParticles, HaloEncoding encoding)
+{
+	int bits = coordinateBits(encoding);
+	size_t size = HEADER_SIZE + (size_t)nbParticles * ((bits == 0) ? 3 * sizeof(double)
+													   : sizeof(float) + 2 * bits / 8);
+	// the arrays of the next cell stay aligned
+	return (size + 7) & ~(size_t)7;
+}
+
+// Encode the cell c, of number cellNo, in buf of encodedCellSize bytes. Returns their number
+size_t encodeCell(Cell *c, int cellNo, HaloEncoding encoding, unsigned char *buf)
+{
+	int32_t header[2] = {cellNo, c->nbParticles};
+	double box[4] = {c->xMin, c->xMax, c->yMin, c->yMax};
+	memcpy(buf, header, sizeof(header));
+	memcpy(buf + sizeof(header), box, sizeof(box));
+
+	int n = c->nbParticles, bits = coordinateBits(encoding);
+	unsigned char *p = buf + HEADER_SIZE;
+	if (bits == 0)
+	{
+		memcpy(p, c->m, n * sizeof(double));
+		memcpy(p + n * sizeof(double), c->x, n * sizeof(double));
+		memcpy(p + 2 * n * sizeof(double), c->y, n * sizeof(double));
+		return encodedCellSize(n, encoding);
+	}
+
+	float *m = (float *) p;
+	double sx = quantizationScale(c->xMin, c->xMax, bits), sy = quantizationScale(c->yMin, c->yMax, bits);
+	for (int i = 0; i < n; i++)
+		m[i] = (float) c->m[i];
+
+	if (bits == 32)
+	{
+		uint32_t *x = (uint32_t *) (m + n), *y = x + n;
+		for (int i = 0; i < n; i++)
+		{
+			x[i] = quantize(c->x[i], c->xMin, sx, 32);
+			y[i] = quantize(c->y[i], c->yMin, sy, 32);
+		}
+	}
+	else
+	{
+		uint16_t *x = (uint16_t *) (m + n), *y = x + n;
+		for (int i = 0; i < n; i++)
+		{
+			x[i] = quantize(c->x[i], c->xMin, sx, 16);
+			y[i] = quantize(c->y[i], c->yMin, sy, 16);
+		}
+	}
+	return encodedCellSize(n, encoding);
+}
+
+// Decode the cell encoded in buf in c, whose arrays are allocated as by initCell, with zero
+// forces, and its number in cellNo. Returns the number of bytes read
+size_t decodeCell(const unsigned char *buf, HaloEncoding encoding, int *cellNo, Cell *c)
+{
+	int32_t header[2];
+	double box[4];
+	memcpy(header, buf, sizeof(header));
+	memcpy(box, buf + sizeof(header), sizeof(box));
+
+	int n = header[1], bits = coordinateBits(encoding);
+	*cellNo = header[0];
+	c->xMin = box[0]; c->xMax = box[1]; c->yMin = box[2]; c->yMax = box[3];
+	c->nbParticles = n;
+	c->m = (double *) malloc(5 * n * sizeof(double));
+	c->x = c->m + n;
+	c->y = c->x + n;
+	c->fx = c->y + n;
+	c->fy = c->fx + n;
+	c->pot = NULL;
+	c->vir[0] = c->vir[1] = c->vir[2] = 0;
+	memset(c->fx, 0, 2 * n * sizeof(double));
+
+	const unsigned char *p = buf + HEADER_SIZE;
+	if (bits == 0)
+	{
+		memcpy(c->m, p, 3 * n * sizeof(double));
+		return encodedCellSize(n, encoding);
+	}
+
+	const float *m = (const float *) p;
+	double sx = quantizationScale(c->xMin, c->xMax, bits), sy = quantizationScale(c->yMin, c->yMax, bits);
+	for (int i = 0; i < n; i++)
+		c->m[i] = m[i];
+
+	if (bits == 32)
+	{
+		const uint32_t *x = (const uint32_t *) (m + n), *y = x + n;
+		for (int i = 0; i < n; i++)
+		{
+			c->x[i] = dequantize(x[i], c->xMin, sx);
+			c->y[i] = dequantize(y[i], c->yMin, sy);
+		}
+	}
+	else
+	{
+		const uint16_t *x = (const uint16_t *) (m + n), *y = x + n;
+		for (int i = 0; i < n; i++)
+		{
+			c->x[i] = dequantize(x[i], c->xMin, sx);
+			c->y[i] = dequantize(y[i], c->yMin, sy);
+		}
+	}
+	return encodedCellSize(n, encoding);
+}
+
+// Same as computeForcesDistributed, the particles of the cells in the near field of the cells of
+// the node being received from the nodes owning them, with the specified encoding, and replacing
+// its own copies during the walk. stats is filled if it is not NULL
+void computeForcesDistributedHalo(Quadtree *qt, double farFieldLimit, HaloEncoding encoding,
+								  HaloStats *stats)
+{
+	int rank, size;
+	MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+	MPI_Comm_size(MPI_COMM_WORLD, &size);
+	double start = MPI_Wtime();
+
+	int first, last;
+	distributedCells(qt, rank, size, &first, &last);
+
+	// cells of the other nodes in the near field of the cells of the node, by owner
+	int *queue = (int *) malloc(qt->nbMultipoles * sizeof(int));
+	char *marks = (char *) calloc(qt->nbCells, 1);
+	int *needed = (int *) malloc(qt->nbCells * sizeof(int)), nbNeeded = 0;
+	for (int cellNo = first; cellNo < last; cellNo++)
+		nbNeeded += listNearField(qt, cellNo, farFieldLimit, queue, marks, needed + nbNeeded);
+	qsort(needed, nbNeeded, sizeof(int), cmpInt);
+
+	int nbRequested = 0;
+	for (int i = 0; i < nbNeeded; i++)
+		if (needed[i] < first || needed[i] >= last)
+			needed[nbRequested++] = needed[i];
+
+	int *counts = (int *) calloc(4 * size, sizeof(int));
+	int *sendCounts = counts, *sendDispls = counts + size, *recvCounts = sendDispls + size, *recvDispls = recvCounts + size;
+	for (int i = 0; i < nbRequested; i++)
+		sendCounts[distributedOwner(qt, needed[i], size)]++;
+	MPI_Alltoall(sendCounts, 1, MPI_INT, recvCounts, 1, MPI_INT, MPI_COMM_WORLD);
+	for (int r = 1; r < size; r++)
+	{
+		sendDispls[r] = sendDispls[r-1] + sendCounts[r-1];
+		recvDispls[r] = recvDispls[r-1] + recvCounts[r-1];
+	}
+
+	// cells requested by the other nodes
+	int nbToSend = recvDispls[size-1] + recvCounts[size-1];
+	int *toSend = (int *) malloc((nbToSend + 1) * sizeof(int));
+	MPI_Alltoallv(needed, sendCounts, sendDispls, MPI_INT, toSend, recvCounts, recvDispls, MPI_INT, MPI_COMM_WORLD);
+
+	// encode them, in the order of the requests, the counts are now in bytes
+	int *byteCounts = (int *) calloc(4 * size, sizeof(int));
+	int *bSendCounts = byteCounts, *bSendDispls = byteCounts + size;
+	int *bRecvCounts = bSendDispls + size, *bRecvDispls = bRecvCounts + size;
+	for (int r = 0; r < size; r++)
+		for (int i = recvDispls[r]; i < recvDispls[r] + recvCounts[r]; i++)
+			bSendCounts[r] += encodedCellSize(qt->cells[toSend[i]].nbParticles, encoding);
+	MPI_Alltoall(bSendCounts, 1, MPI_INT, bRecvCounts, 1, MPI_INT, MPI_COMM_WORLD);
+	for (int r = 1; r < size; r++)
+	{
+		bSendDispls[r] = bSendDispls[r-1] + bSendCounts[r-1];
+		bRecvDispls[r] = bRecvDispls[r-1] + bRecvCounts[r-1];
+	}
+
+	long nbSendBytes = bSendDispls[size-1] + bSendCounts[size-1];
+	long nbRecvBytes = bRecvDispls[size-1] + bRecvCounts[size-1];
+	unsigned char *sendBuf = (unsigned char *) malloc(nbSendBytes + 1);
+	unsigned char *recvBuf = (unsigned char *) malloc(nbRecvBytes + 1);
+
+	long offset = 0;
+	for (int i = 0; i < nbToSend; i++)
+		offset += encodeCell(qt->cells + toSend[i], toSend[i], encoding, sendBuf + offset);
+	MPI_Alltoallv(sendBuf, bSendCounts, bSendDispls, MPI_BYTE, recvBuf, bRecvCounts, bRecvDispls,
+				  MPI_BYTE, MPI_COMM_WORLD);
+
+	// the received cells replace the copies of the node during the walk
+	Cell *copies = (Cell *) malloc((nbRequested + 1) * sizeof(Cell));
+	HaloStats st = {nbRequested, 0, nbRecvBytes, 0, 0};
+	offset = 0;
+	for (int i = 0; i < nbRequested; i++)
+	{
+		int cellNo;
+		Cell received;
+		offset += decodeCell(recvBuf + offset, encoding, &cellNo, &received);
+		copies[i] = qt->cells[cellNo];
+		qt->cells[cellNo] = received;
+		st.nbParticles += received.nbParticles;
+		st.doubleBytes += encodedCellSize(received.nbParticles, HALO_DOUBLE);
+	}
+	st.seconds = MPI_Wtime() - start;
+
+	computeForcesDistributed(qt, farFieldLimit);
+
+	for (int i = 0; i < nbRequested; i++)
+	{
+		freeCell(qt->cells + needed[i]);
+		qt->cells[needed[i]] = copies[i];
+	}
+
+	if (stats != NULL)
+		*stats = st;
+
+	free(queue);
+	free(marks);
+	free(needed);
+	free(counts);
+	free(toSend);
+	free(byteCounts);
+	free(sendBuf);
+	free(recvBuf);
+	free(copies);
+}
@@ -0,0 +1,49 @@
+#ifndef HALO_H
+#define HALO_H
+
+#include <stddef.h>
+
+#include "Quadtree.h"
+
+// Halo exchange of the distributed force pass: each node owns the cells of computeForcesDistributed
+// and receives, from the nodes owning them, the particles of the cells in the near field of its
+// own cells. The multipoles are replicated, only the particles are exchanged.
+//
+// The cells can be encoded to reduce the volume of the messages: the positions are quantized
+// on 32 or 16 bits relative to the bounding box of the sending cell, and the masses are sent
+// in single precision. The error of a position is at most half a step of the grid of the cell,
+// width / (2^32 - 1) or width / (2^16 - 1), and the relative error of a mass 2^-24
+
+typedef enum HaloEncoding
+{
+	HALO_DOUBLE,               // m, x, y as doubles, 24 bytes per particle
+	HALO_QUANTIZED_32,         // m as float, x and y on 32 bits, 12 bytes per particle
+	HALO_QUANTIZED_16          // m as float, x and y on 16 bits, 8 bytes per particle
+} HaloEncoding;
+
+typedef struct HaloStats
+{
+	long nbCells;              // cells received by the node
+	long nbParticles;
+	long bytes;                // bytes received, headers included
+	long doubleBytes;          // bytes of the same cells encoded with HALO_DOUBLE
+	double seconds;            // time of the exchange, encoding and decoding included
+} HaloStats;
+
+// Returns the size of a cell of nbParticles particles encoded with encoding
+extern size_t encodedCellSize(int nbParticles, HaloEncoding encoding);
+
+// Encode the cell c, of number cellNo, in buf of encodedCellSize bytes. Returns their number
+extern size_t encodeCell(Cell *c, int cellNo, HaloEncoding encoding, unsigned char *buf);
+
+// Decode the cell encoded in buf in c, whose arrays are allocated as by initCell, with zero
+// forces, and its number in cellNo. Returns the number of bytes read
+extern size_t decodeCell(const unsigned char *buf, HaloEncoding encoding, int *cellNo, Cell *c);
+
+// Same as computeForcesDistributed, the particles of the cells in the near field of the cells of
+// the node being received from the nodes owning them, with the specified encoding, and replacing
+// its own copies during the walk. stats is filled if it is not NULL
+extern void computeForcesDistributedHalo(Quadtree *qt, double farFieldLimit, HaloEncoding encoding,
+										 HaloStats *stats);
+
+#endif
@@ -0,0 +1,97 @@
+#include "Hilbert.h"
+#include "Morton.h"
+
+// Private
+
+// Branch-free encoding, so that the batch loops vectorize.
+// At each level, the quadrant (rx, ry) gives 2 bits of the key, then the 
+// coordinates are reflected (rx = 1, ry = 0) and transposed (ry = 0) so that 
+// the sub-curve of the quadrant has the same orientation as the whole curve
+static inline __attribute__((always_inline)) uint64_t encode(uint32_t x, uint32_t y, int order)
+{
+	uint64_t key = 0;
+	for (int l = order - 1; l >= 0; l--)
+	{
+		uint32_t s = (uint32_t)1 << l;
+		uint32_t rx = (x >> l) & 1;
+		uint32_t ry = (y >> l) & 1;
+		key |= (uint64_t)((3 * rx) ^ ry) << (2*l);
+
+		uint32_t reflect = -(rx & (ry ^ 1)) & (s - 1);
+		x ^= reflect;
+		y ^= reflect;
+		uint32_t transpose = -(ry ^ 1) & (x ^ y);
+		x ^= transpose;
+		y ^= transpose;
+	}
+	return key;
+}
+
+static inline __attribute__((always_inline)) void decode(uint64_t key, int order, uint32_t *xOut, uint32_t *yOut)
+{
+	uint32_t x = 0, y = 0;
+	for (int l = 0; l < order; l++)
+	{
+		uint32_t s = (uint32_t)1 << l;
+		uint32_t q = (key >> (2*l)) & 3;
+		uint32_t rx = q >> 1;
+		uint32_t ry = (q ^ rx) & 1;
+
+		uint32_t reflect = -(rx & (ry ^ 1)) & (s - 1);
+		x ^= reflect;
+		y ^= reflect;
+		uint32_t transpose = -(ry ^ 1) & (x ^ y);
+		x ^= transpose;
+		y ^= transpose;
+
+		x += s * rx;
+		y += s * ry;
+	}
+	*xOut = x;
+	*yOut = y;
+}
+
+// Public
+
+// Hilbert index of the cell (x, y)
+uint64_t xy_to_hilbert(uint32_t x, uint32_t y, int order)
+{
+	return encode(x, y, order);
+}
+
+// Coordinates (x, y) of the cell of Hilbert index key
+void hilbert_to_xy(uint64_t key, int order, uint32_t *x, uint32_t *y)
+{
+	decode(key, order, x, y);
+}
+
+// Hilbert indices keys[i] of the n cells (x[i], y[i])
+void xy_to_hilbert_batch(int n, const uint32_t *x, const uint32_t *y, int order, uint64_t *keys)
+{
+	#pragma omp simd
+	for (int i = 0; i < n; i++)
+		keys[i] = encode(x[i], y[i], order);
+}
+
+// Coordinates (x[i], y[i]) of the n cells of Hilbert indices keys[i]
+void hilbert_to_xy_batch(int n, const uint64_t *keys, int order, uint32_t *x, uint32_t *y)
+{
+	#pragma omp simd
+	for (int i = 0; i < n; i++)
+		decode(keys[i], order, x + i, y + i);
+}
+
+// Hilbert index of the neighbour (x+dx, y+dy) of the cell of Hilbert index key.
+// Returns NO_NEIGHBOUR (see Morton.h) if the neighbour is out of the grid
+uint64_t hilbertNeighbour(uint64_t key, int dx, int dy, int order)
+{
+	uint32_t x, y;
+	int64_t dim = (int64_t)1 << order;
+	decode(key, order, &x, &y);
+
+	int64_t nx = (int64_t)x + dx, ny = (int64_t)y + dy;
+	if (nx < 0 || ny < 0 || nx >= dim || ny >= dim)
+		return NO_NEIGHBOUR;
+
+	return encode(nx, ny, order);
+}
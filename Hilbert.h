@@ -0,0 +1,27 @@
+#ifndef HILBERT_H
+#define HILBERT_H
+
+#include <stdint.h>
+
+// Hilbert curve keys on a grid of 2^order x 2^order cells. 
+// As with Morton keys, the 4 sub-cells of a cell have consecutive keys, 
+// but consecutive keys are always adjacent cells, which reduces the surface
+// of ranges of keys.
+
+// Hilbert index of the cell (x, y)
+extern uint64_t xy_to_hilbert(uint32_t x, uint32_t y, int order);
+
+// Coordinates (x, y) of the cell of Hilbert index key
+extern void hilbert_to_xy(uint64_t key, int order, uint32_t *x, uint32_t *y);
+
+// Hilbert indices keys[i] of the n cells (x[i], y[i])
+extern void xy_to_hilbert_batch(int n, const uint32_t *x, const uint32_t *y, int order, uint64_t *keys);
+
+// Coordinates (x[i], y[i]) of the n cells of Hilbert indices keys[i]
+extern void hilbert_to_xy_batch(int n, const uint64_t *keys, int order, uint32_t *x, uint32_t *y);
+
+// Hilbert index of the neighbour (x+dx, y+dy) of the cell of Hilbert index key.
+// Returns NO_NEIGHBOUR (see Morton.h) if the neighbour is out of the grid
+extern uint64_t hilbertNeighbour(uint64_t key, int dx, int dy, int order);
+
+#endif
@@ -1,22 +1,160 @@
+#include "Backend.h"
 #include "Morton.h"
 
+#include <immintrin.h>
 
-#if defined __BMI2__
+#define X_MASK 0x5555555555555555
+#define Y_MASK 0xAAAAAAAAAAAAAAAA
 
-// requires Haswell or better, compile with -mbmi2
-#include <immintrin.h>
+// Private
+
+// Spread the 32 bits of x over the even bits of the result
+static inline __attribute__((always_inline)) uint64_t dilate(uint64_t x)
+{
+    x = (x | (x << 16)) & 0x0000FFFF0000FFFF;
+    x = (x | (x << 8)) & 0x00FF00FF00FF00FF;
+    x = (x | (x << 4)) & 0x0F0F0F0F0F0F0F0F;
+    x = (x | (x << 2)) & 0x3333333333333333;
+    x = (x | (x << 1)) & 0x5555555555555555;
+    return x;
+}
+
+// Gather the even bits of key in the 32 bits of the result
+static inline __attribute__((always_inline)) uint32_t contract(uint64_t key)
+{
+    key &= 0x5555555555555555;
+    key = (key | (key >> 1)) & 0x3333333333333333;
+    key = (key | (key >> 2)) & 0x0F0F0F0F0F0F0F0F;
+    key = (key | (key >> 4)) & 0x00FF00FF00FF00FF;
+    key = (key | (key >> 8)) & 0x0000FFFF0000FFFF;
+    key = (key | (key >> 16)) & 0x00000000FFFFFFFF;
+    return key;
+}
+
+// Public
 
+// Morton index of the cell (x, y), computed by the selected kernel backend
 uint64_t xy_to_morton(uint32_t x, uint32_t y)
 {
-  return _pdep_u32(x, 0x55555555) | _pdep_u32(y,0xaaaaaaaa);
+  return getBackend()->xy_to_morton(x, y);
 }
 
-#elif defined __PCLMUL__
+// Coordinates (x, y) of the cell of Morton index key
+void morton_to_xy(uint64_t key, uint32_t *x, uint32_t *y)
+{
+  getBackend()->morton_to_xy(key, x, y);
+}
 
-// requires Westmere or better, compile with -mpclmul
+// Morton indices keys[i] of the n cells (x[i], y[i])
+void xy_to_morton_batch(int n, const uint32_t *x, const uint32_t *y, uint64_t *keys)
+{
+  getBackend()->xy_to_morton_batch(n, x, y, keys);
+}
 
-#include <wmmintrin.h>
+// Coordinates (x[i], y[i]) of the n cells of Morton indices keys[i]
+void morton_to_xy_batch(int n, const uint64_t *keys, uint32_t *x, uint32_t *y)
+{
+  getBackend()->morton_to_xy_batch(n, keys, x, y);
+}
+
+// Morton index of the neighbour (x+dx, y+dy) of the cell of Morton index key, in a grid 
+// of 2^level x 2^level cells, computed without decoding key. 
+// Returns NO_NEIGHBOUR if the neighbour is out of the grid
+//
+// Note: the x (resp. y) bits are added with the bits of y (resp. x) set (resp. cleared) 
+// so that the carries propagate across them
+uint64_t mortonNeighbour(uint64_t key, int dx, int dy, int level)
+{
+  uint64_t levelMask = (level >= 32) ? UINT64_MAX : (((uint64_t)1 << (2*level)) - 1);
+  uint64_t kx = key & X_MASK, ky = key & Y_MASK;
+
+  if (dx >= 0)
+    kx = ((key | Y_MASK) + dilate(dx)) & X_MASK;
+  else
+    kx = (kx - dilate(-dx)) & X_MASK;
+
+  if (dy >= 0)
+    ky = ((key | X_MASK) + (dilate(dy) << 1)) & Y_MASK;
+  else
+    ky = (ky - (dilate(-dy) << 1)) & Y_MASK;
+
+  // overflows and underflows leave bits above the grid
+  if ((kx | ky) & ~levelMask)
+    return NO_NEIGHBOUR;
+
+  return kx | ky;
+}
+
+// Returns 1 if the running CPU supports PCLMUL
+int hasPCLMUL(void)
+{
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("pclmul");
+}
+
+
+// requires Haswell or better
+
+__attribute__((target("bmi2")))
+uint64_t xy_to_morton_bmi2(uint32_t x, uint32_t y)
+{
+  return _pdep_u64(x, X_MASK) | _pdep_u64(y, Y_MASK);
+}
 
+__attribute__((target("bmi2")))
+void morton_to_xy_bmi2(uint64_t key, uint32_t *x, uint32_t *y)
+{
+  *x = _pext_u64(key, X_MASK);
+  *y = _pext_u64(key, Y_MASK);
+}
+
+// The batch loops are vectorized by the compiler for each target
+
+__attribute__((target("avx2")))
+void xy_to_morton_batch_avx2(int n, const uint32_t *x, const uint32_t *y, uint64_t *keys)
+{
+  #pragma omp simd
+  for (int i = 0; i < n; i++)
+    keys[i] = dilate(x[i]) | (dilate(y[i]) << 1);
+}
+
+__attribute__((target("avx2")))
+void morton_to_xy_batch_avx2(int n, const uint64_t *keys, uint32_t *x, uint32_t *y)
+{
+  #pragma omp simd
+  for (int i = 0; i < n; i++)
+  {
+    x[i] = contract(keys[i]);
+    y[i] = contract(keys[i] >> 1);
+  }
+}
+
+
+// requires Skylake-SP or better
+
+__attribute__((target("avx512f")))
+void xy_to_morton_batch_avx512(int n, const uint32_t *x, const uint32_t *y, uint64_t *keys)
+{
+  #pragma omp simd
+  for (int i = 0; i < n; i++)
+    keys[i] = dilate(x[i]) | (dilate(y[i]) << 1);
+}
+
+__attribute__((target("avx512f")))
+void morton_to_xy_batch_avx512(int n, const uint64_t *keys, uint32_t *x, uint32_t *y)
+{
+  #pragma omp simd
+  for (int i = 0; i < n; i++)
+  {
+    x[i] = contract(keys[i]);
+    y[i] = contract(keys[i] >> 1);
+  }
+}
+
+
+// requires Westmere or better
+
+__attribute__((target("pclmul,sse2")))
 static uint64_t carryless_square(uint32_t x)
 {
   uint64_t val[2] = {x, 0};
@@ -25,28 +163,39 @@ static uint64_t carryless_square(uint32_t x)
   return val[0];
 }
 
-uint64_t xy_to_morton(uint32_t x, uint32_t y)
+__attribute__((target("pclmul,sse2")))
+uint64_t xy_to_morton_pclmul(uint32_t x, uint32_t y)
 {
   return carryless_square(x) | (carryless_square(y) << 1);
 }
 
-#else
 
-uint64_t xy_to_morton(uint32_t x, uint32_t y)
+// Portable versions, with 64-bit intermediates
+
+uint64_t xy_to_morton_generic(uint32_t x, uint32_t y)
 {
-    x = (x | (x << 16)) & 0x0000FFFF0000FFFF;
-    x = (x | (x << 8)) & 0x00FF00FF00FF00FF;
-    x = (x | (x << 4)) & 0x0F0F0F0F0F0F0F0F;
-    x = (x | (x << 2)) & 0x3333333333333333;
-    x = (x | (x << 1)) & 0x5555555555555555;
+  return dilate(x) | (dilate(y) << 1);
+}
 
-    y = (y | (y << 16)) & 0x0000FFFF0000FFFF;
-    y = (y | (y << 8)) & 0x00FF00FF00FF00FF;
-    y = (y | (y << 4)) & 0x0F0F0F0F0F0F0F0F;
-    y = (y | (y << 2)) & 0x3333333333333333;
-    y = (y | (y << 1)) & 0x5555555555555555;
+void morton_to_xy_generic(uint64_t key, uint32_t *x, uint32_t *y)
+{
+  *x = contract(key);
+  *y = contract(key >> 1);
+}
 
-    return x | (y << 1);
+void xy_to_morton_batch_generic(int n, const uint32_t *x, const uint32_t *y, uint64_t *keys)
+{
+  #pragma omp simd
+  for (int i = 0; i < n; i++)
+    keys[i] = dilate(x[i]) | (dilate(y[i]) << 1);
 }
 
-#endif
\ No newline at end of file
+void morton_to_xy_batch_generic(int n, const uint64_t *keys, uint32_t *x, uint32_t *y)
+{
+  #pragma omp simd
+  for (int i = 0; i < n; i++)
+  {
+    x[i] = contract(keys[i]);
+    y[i] = contract(keys[i] >> 1);
+  }
+}
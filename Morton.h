@@ -3,6 +3,48 @@
 
 #include <stdint.h>
 
+// Returned by the neighbour functions when the neighbour is out of the grid
+#define NO_NEIGHBOUR UINT64_MAX
+
+// Morton index of the cell (x, y), computed by the selected kernel backend
 extern uint64_t xy_to_morton(uint32_t x, uint32_t y);
 
-#endif 
\ No newline at end of file
+// Coordinates (x, y) of the cell of Morton index key
+extern void morton_to_xy(uint64_t key, uint32_t *x, uint32_t *y);
+
+// Morton indices keys[i] of the n cells (x[i], y[i])
+extern void xy_to_morton_batch(int n, const uint32_t *x, const uint32_t *y, uint64_t *keys);
+
+// Coordinates (x[i], y[i]) of the n cells of Morton indices keys[i]
+extern void morton_to_xy_batch(int n, const uint64_t *keys, uint32_t *x, uint32_t *y);
+
+// Morton index of the neighbour (x+dx, y+dy) of the cell of Morton index key, in a grid 
+// of 2^level x 2^level cells, computed without decoding key. 
+// Returns NO_NEIGHBOUR if the neighbour is out of the grid
+extern uint64_t mortonNeighbour(uint64_t key, int dx, int dy, int level);
+
+
+// Implementations for each instruction set, selected through the kernel backend
+
+extern uint64_t xy_to_morton_generic(uint32_t x, uint32_t y);
+extern void morton_to_xy_generic(uint64_t key, uint32_t *x, uint32_t *y);
+extern void xy_to_morton_batch_generic(int n, const uint32_t *x, const uint32_t *y, uint64_t *keys);
+extern void morton_to_xy_batch_generic(int n, const uint64_t *keys, uint32_t *x, uint32_t *y);
+
+// requires Haswell or better
+extern uint64_t xy_to_morton_bmi2(uint32_t x, uint32_t y);
+extern void morton_to_xy_bmi2(uint64_t key, uint32_t *x, uint32_t *y);
+extern void xy_to_morton_batch_avx2(int n, const uint32_t *x, const uint32_t *y, uint64_t *keys);
+extern void morton_to_xy_batch_avx2(int n, const uint64_t *keys, uint32_t *x, uint32_t *y);
+
+// requires Skylake-SP or better
+extern void xy_to_morton_batch_avx512(int n, const uint32_t *x, const uint32_t *y, uint64_t *keys);
+extern void morton_to_xy_batch_avx512(int n, const uint64_t *keys, uint32_t *x, uint32_t *y);
+
+// requires Westmere or better
+extern uint64_t xy_to_morton_pclmul(uint32_t x, uint32_t y);
+
+// Returns 1 if the running CPU supports PCLMUL
+extern int hasPCLMUL(void);
+
+#endif 
@@ -18,6 +18,17 @@ struct Multipole
 } 
 typedef Multipole;
 
+// Centers of mass, masses and widths of 4 sibling multipoles: the data read by the traversal,
+// stored apart from the bounding boxes. 4 doubles per field, 2 cache lines per group
+struct MultipoleGroup
+{
+  double x[4];
+  double y[4];
+  double m[4];
+  double l[4]; // width of the area approximated, or length of the MAC (see Quadtree.h)
+} __attribute__((aligned(128)))
+typedef MultipoleGroup;
+
 // Initialize a multipole
 extern void initMultipole(Multipole *mp, double m, double x, double y, 
 						  double xMin, double xMax, double yMin, double yMax);
@@ -0,0 +1,281 @@
+#include "Neighbours.h"
+
+#include <math.h>
+#include <omp.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Results of the queries of a thread, appended in the order it runs them
+typedef struct NeighbourBuffer
+{
+	long size;
+	long capacity;
+	long *neighbours;
+	double *distances;         // squared until gathered
+} NeighbourBuffer;
+
+// Query of a batch: fills its results in buf, from its point (x, y)
+typedef void (*NeighbourQuery)(Quadtree *qt, const double *boxes, const long *first, double x,
+							   double y, double param, int *stack, NeighbourBuffer *buf);
+
+// Private
+
+static inline void append(NeighbourBuffer *buf, long p, double d2)
+{
+	if (buf->size == buf->capacity)
+	{
+		buf->capacity = 2 * buf->capacity + 64;
+		buf->neighbours = (long *) realloc(buf->neighbours, buf->capacity * sizeof(long));
+		buf->distances = (double *) realloc(buf->distances, buf->capacity * sizeof(double));
+	}
+	buf->neighbours[buf->size] = p;
+	buf->distances[buf->size++] = d2;
+}
+
+// Squared distance between (x, y) and the box b (xMin, xMax, yMin, yMax), infinite if it is empty
+static inline double boxDistance2(const double *b, double x, double y)
+{
+	double dx = fmax(fmax(b[0] - x, x - b[1]), 0), dy = fmax(fmax(b[2] - y, y - b[3]), 0);
+	return dx*dx + dy*dy;
+}
+
+// Bounding boxes of the particles below each vertex, 4 values per vertex, and number of the
+// first particle of each cell, nbCells+1 values
+static void computeBoxes(Quadtree *qt, double *boxes, long *first)
+{
+	#pragma omp parallel for schedule(dynamic, 16)
+	for (int cellNo = 0; cellNo < qt->nbCells; cellNo++)
+	{
+		Cell *c = qt->cells + cellNo;
+		double *b = boxes + 4 * (qt->firstOuterCM + cellNo);
+		b[0] = b[2] = INFINITY;
+		b[1] = b[3] = -INFINITY;
+		for (int i = 0; i < c->nbParticles; i++)
+		{
+			b[0] = fmin(b[0], c->x[i]); b[1] = fmax(b[1], c->x[i]);
+			b[2] = fmin(b[2], c->y[i]); b[3] = fmax(b[3], c->y[i]);
+		}
+	}
+
+	for (int cmNo = qt->firstOuterCM - 1; cmNo >= 0; cmNo--)
+	{
+		double *b = boxes + 4 * cmNo, *children = boxes + 4 * (4*cmNo+1);
+		b[0] = fmin(fmin(children[0], children[4]), fmin(children[8], children[12]));
+		b[1] = fmax(fmax(children[1], children[5]), fmax(children[9], children[13]));
+		b[2] = fmin(fmin(children[2], children[6]), fmin(children[10], children[14]));
+		b[3] = fmax(fmax(children[3], children[7]), fmax(children[11], children[15]));
+	}
+
+	first[0] = 0;
+	for (int cellNo = 0; cellNo < qt->nbCells; cellNo++)
+		first[cellNo + 1] = first[cellNo] + qt->cells[cellNo].nbParticles;
+}
+
+// Particles within sqrt(r2) of (x, y), depth first. stack holds 3 * height vertices
+static void queryRadius(Quadtree *qt, const double *boxes, const long *first, double x, double y,
+						double r2, int *stack, NeighbourBuffer *buf)
+{
+	int top = 0;
+	stack[top++] = 0;
+	while (top > 0)
+	{
+		int cmNo = stack[--top];
+		if (boxDistance2(boxes + 4 * cmNo, x, y) > r2)
+			continue;
+
+		if (cmNo < qt->firstOuterCM)
+		{
+			for (int j = 4; j >= 1; j--)
+				stack[top++] = 4*cmNo + j;
+			continue;
+		}
+
+		int cellNo = cmNo - qt->firstOuterCM;
+		Cell *c = qt->cells + cellNo;
+		for (int i = 0; i < c->nbParticles; i++)
+		{
+			double dx = c->x[i] - x, dy = c->y[i] - y, d2 = dx*dx + dy*dy;
+			if (d2 <= r2)
+				append(buf, first[cellNo] + i, d2);
+		}
+	}
+}
+
+// Sift down the root of the max-heap of n squared distances d and particles p
+static inline void siftDown(double *d, long *p, int n)
+{
+	for (int i = 0; 2*i+1 < n; )
+	{
+		int j = 2*i+1;
+		if (j+1 < n && d[j+1] > d[j])
+			j++;
+		if (d[i] >= d[j])
+			return;
+		double td = d[i]; d[i] = d[j]; d[j] = td;
+		long tp = p[i]; p[i] = p[j]; p[j] = tp;
+		i = j;
+	}
+}
+
+// The k particles nearest to (x, y) by increasing distance, at the end of buf. Depth first, the
+// nearest children first, with a max-heap of the nearest particles found. stack holds 3 * height vertices
+static void queryNearest(Quadtree *qt, const double *boxes, const long *first, double x, double y,
+						 double k, int *stack, NeighbourBuffer *buf)
+{
+	long start = buf->size;
+	int n = 0, kMax = (int) k;
+	if (kMax <= 0)
+		return;
+	for (int i = 0; i < kMax; i++)
+		append(buf, -1, INFINITY);
+	double *d = buf->distances + start;
+	long *p = buf->neighbours + start;
+
+	int top = 0;
+	stack[top++] = 0;
+	while (top > 0)
+	{
+		int cmNo = stack[--top];
+		if (boxDistance2(boxes + 4 * cmNo, x, y) >= d[0])
+			continue;
+
+		if (cmNo < qt->firstOuterCM)
+		{
+			// push the farthest child first
+			int children[4];
+			double dist[4];
+			for (int j = 0; j < 4; j++)
+			{
+				children[j] = 4*cmNo+1 + j;
+				dist[j] = boxDistance2(boxes + 4 * children[j], x, y);
+				for (int l = j; l > 0 && dist[l] > dist[l-1]; l--)
+				{
+					double td = dist[l]; dist[l] = dist[l-1]; dist[l-1] = td;
+					int tc = children[l]; children[l] = children[l-1]; children[l-1] = tc;
+				}
+			}
+			for (int j = 0; j < 4; j++)
+				stack[top++] = children[j];
+			continue;
+		}
+
+		int cellNo = cmNo - qt->firstOuterCM;
+		Cell *c = qt->cells + cellNo;
+		for (int i = 0; i < c->nbParticles; i++)
+		{
+			double dx = c->x[i] - x, dy = c->y[i] - y, d2 = dx*dx + dy*dy;
+			if (d2 < d[0])
+			{
+				d[0] = d2;
+				p[0] = first[cellNo] + i;
+				siftDown(d, p, kMax);
+				n += (n < kMax);
+			}
+		}
+	}
+
+	// heap sort by increasing distance, the empty slots being at the end
+	for (int m = kMax - 1; m > 0; m--)
+	{
+		double td = d[0]; d[0] = d[m]; d[m] = td;
+		long tp = p[0]; p[0] = p[m]; p[m] = tp;
+		siftDown(d, p, m);
+	}
+	buf->size = start + n;
+}
+
+// Run the queries of the batch, and gather their results in nl
+static void runQueries(Quadtree *qt, int nbQueries, const double *x, const double *y,
+					   NeighbourQuery query, double param, NeighbourLists *nl)
+{
+	double *boxes = (double *) malloc(4 * qt->nbMultipoles * sizeof(double));
+	long *first = (long *) malloc((qt->nbCells + 1) * sizeof(long));
+	computeBoxes(qt, boxes, first);
+
+	// Counting sort of the queries by leaf
+	int *leafFirst = (int *) malloc((qt->nbCells + 1) * sizeof(int));
+	int *order = (int *) malloc(nbQueries * sizeof(int));
+	sortByLeaf(qt, nbQueries, x, y, leafFirst, order);
+
+	// thread and start of the results of each query
+	int nbThreads = omp_get_max_threads();
+	NeighbourBuffer *buffers = (NeighbourBuffer *) calloc(nbThreads, sizeof(NeighbourBuffer));
+	int *threads = (int *) malloc(nbQueries * sizeof(int));
+	long *starts = (long *) malloc(nbQueries * sizeof(long));
+	nl->nbQueries = nbQueries;
+	nl->offsets = (long *) malloc((nbQueries + 1) * sizeof(long));
+
+	#pragma omp parallel
+	{
+		NeighbourBuffer *buf = buffers + omp_get_thread_num();
+		int *stack = (int *) malloc(3 * qt->height * sizeof(int) + 4 * sizeof(int));
+
+		#pragma omp for schedule(dynamic, 1)
+		for (int cellNo = 0; cellNo < qt->nbCells; cellNo++)
+			for (int k = leafFirst[cellNo]; k < leafFirst[cellNo + 1]; k++)
+			{
+				int q = order[k];
+				threads[q] = omp_get_thread_num();
+				starts[q] = buf->size;
+				query(qt, boxes, first, x[q], y[q], param, stack, buf);
+				nl->offsets[q + 1] = buf->size - starts[q];
+			}
+
+		free(stack);
+	}
+
+	nl->offsets[0] = 0;
+	for (int q = 0; q < nbQueries; q++)
+		nl->offsets[q + 1] += nl->offsets[q];
+	nl->neighbours = (long *) malloc((nl->offsets[nbQueries] + 1) * sizeof(long));
+	nl->distances = (double *) malloc((nl->offsets[nbQueries] + 1) * sizeof(double));
+
+	#pragma omp parallel for schedule(dynamic, 64)
+	for (int q = 0; q < nbQueries; q++)
+	{
+		NeighbourBuffer *buf = buffers + threads[q];
+		long o = nl->offsets[q], n = nl->offsets[q + 1] - o;
+		memcpy(nl->neighbours + o, buf->neighbours + starts[q], n * sizeof(long));
+		for (long i = 0; i < n; i++)
+			nl->distances[o + i] = sqrt(buf->distances[starts[q] + i]);
+	}
+
+	for (int t = 0; t < nbThreads; t++)
+	{
+		free(buffers[t].neighbours);
+		free(buffers[t].distances);
+	}
+	free(buffers);
+	free(threads);
+	free(starts);
+	free(leafFirst);
+	free(order);
+	free(boxes);
+	free(first);
+}
+
+// Public
+
+// Find the particles of the quadtree within radius of each of the nbQueries points (x, y),
+// in the order of the cells
+void findNeighboursRadius(Quadtree *qt, int nbQueries, const double *x, const double *y,
+						  double radius, NeighbourLists *nl)
+{
+	runQueries(qt, nbQueries, x, y, queryRadius, radius * radius, nl);
+}
+
+// Find the k particles of the quadtree nearest to each of the nbQueries points (x, y), by
+// increasing distance. A query gets all the particles if there are less than k
+void findNearestNeighbours(Quadtree *qt, int nbQueries, const double *x, const double *y,
+						   int k, NeighbourLists *nl)
+{
+	runQueries(qt, nbQueries, x, y, queryNearest, k, nl);
+}
+
+// Release the ressources associated with the neighbour lists
+void freeNeighbourLists(NeighbourLists *nl)
+{
+	free(nl->offsets);
+	free(nl->neighbours);
+	free(nl->distances);
+}
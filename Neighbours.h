@@ -0,0 +1,38 @@
+#ifndef NEIGHBOURS_H
+#define NEIGHBOURS_H
+
+#include "Quadtree.h"
+
+// Neighbour queries on the particles of a quadtree, for density estimates and collisions.
+// The queries are batched: they are sorted along the curve of the cells, as by computeField,
+// then walk the tree in parallel, each thread appending its results to its own buffers, which
+// are finally gathered in compressed rows (CSR). A vertex is pruned by the bounding box of its
+// particles, computed once per batch: the boxes of the multipoles are the areas of the cells,
+// that the particles of initQuadtreeGenerator or of the block timesteps can leave.
+//
+// The particles are numbered along the cells: the particle j of the cell c is the particle
+// first + j, first being the number of particles of the cells before c. A particle at the
+// position of a query is one of its neighbours, at distance 0
+
+typedef struct NeighbourLists
+{
+	int nbQueries;
+	long *offsets;             // neighbours of the query i: offsets[i] to offsets[i+1]-1
+	long *neighbours;          // particles
+	double *distances;         // from the query
+} NeighbourLists;
+
+// Find the particles of the quadtree within radius of each of the nbQueries points (x, y),
+// in the order of the cells
+extern void findNeighboursRadius(Quadtree *qt, int nbQueries, const double *x, const double *y,
+								 double radius, NeighbourLists *nl);
+
+// Find the k particles of the quadtree nearest to each of the nbQueries points (x, y), by
+// increasing distance. A query gets all the particles if there are less than k
+extern void findNearestNeighbours(Quadtree *qt, int nbQueries, const double *x, const double *y,
+								  int k, NeighbourLists *nl);
+
+// Release the ressources associated with the neighbour lists
+extern void freeNeighbourLists(NeighbourLists *nl);
+
+#endif
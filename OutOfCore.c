@@ -0,0 +1,459 @@
+#define _DEFAULT_SOURCE
+
+#include "OutOfCore.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <malloc.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "Generator.h"
+
+#define PARTICLE_FILE_MAGIC "BHPART1"
+
+// Private
+
+// Offsets in the file of the index, of the block of particles of the cell cellNo,
+// and of its block of forces
+static inline off_t indexOffset(void)
+{
+	return sizeof(ParticleFileHeader);
+}
+
+static inline off_t particlesOffset(ParticleFile *pf, int cellNo)
+{
+	return indexOffset() + (off_t)(pf->nbCells + 1) * sizeof(int64_t)
+		 + 3 * pf->first[cellNo] * (off_t)sizeof(double);
+}
+
+static inline off_t forcesOffset(ParticleFile *pf, int cellNo)
+{
+	return particlesOffset(pf, pf->nbCells) + 2 * pf->first[cellNo] * (off_t)sizeof(double);
+}
+
+// Read or write size bytes at offset, until done. Returns 0, or -1 with errno set
+static int preadAll(int fd, void *buf, size_t size, off_t offset)
+{
+	for (size_t done = 0; done < size; )
+	{
+		ssize_t r = pread(fd, (char *)buf + done, size - done, offset + done);
+		if (r < 0 && errno == EINTR)
+			continue;
+		if (r <= 0)
+		{
+			errno = (r == 0) ? EIO : errno;
+			return -1;
+		}
+		done += r;
+	}
+	return 0;
+}
+
+static int pwriteAll(int fd, const void *buf, size_t size, off_t offset)
+{
+	for (size_t done = 0; done < size; )
+	{
+		ssize_t r = pwrite(fd, (const char *)buf + done, size - done, offset + done);
+		if (r < 0 && errno == EINTR)
+			continue;
+		if (r < 0)
+			return -1;
+		done += r;
+	}
+	return 0;
+}
+
+static int cmpInt(const void *p1, const void *p2)
+{
+	int a = *(const int *)p1, b = *(const int *)p2;
+	return (a > b) - (a < b);
+}
+
+// Quadtree of the geometry of the file, its cells holding their number of particles
+// but no arrays
+static void initQuadtreeGeometry(Quadtree *qt, ParticleFile *pf)
+{
+	ParticleFileHeader *h = &pf->header;
+	initQuadtreeCurve(qt, h->curve, h->height, 0, 0, 0, 0, h->xMin, h->xMax, h->yMin, h->yMax);
+	for (int cellNo = 0; cellNo < qt->nbCells; cellNo++)
+	{
+		Cell *c = qt->cells + cellNo;
+		free(c->m);
+		c->m = c->x = c->y = c->fx = c->fy = NULL;
+		c->nbParticles = pf->first[cellNo + 1] - pf->first[cellNo];
+	}
+}
+
+static void evictCell(Cell *c)
+{
+	free(c->m);
+	c->m = c->x = c->y = c->fx = c->fy = NULL;
+}
+
+// Compute the multipoles from the cells read in order, by runs of at most maxResident particles,
+// or of one cell
+static int computeMultipolesOutOfCore(Quadtree *qt, ParticleFile *pf, int64_t maxResident)
+{
+	int64_t size = maxResident;
+	for (int cellNo = 0; cellNo < qt->nbCells; cellNo++)
+		size = (qt->cells[cellNo].nbParticles > size) ? qt->cells[cellNo].nbParticles : size;
+	double *buffer = (double *) malloc(3 * size * sizeof(double));
+
+	int status = 0;
+	for (int a = 0, b; a < qt->nbCells; a = b)
+	{
+		for (b = a + 1; b < qt->nbCells && pf->first[b+1] - pf->first[a] <= size; b++)
+			;
+		status = preadAll(pf->fd, buffer, 3 * (pf->first[b] - pf->first[a]) * sizeof(double),
+						  particlesOffset(pf, a));
+		if (status < 0)
+			break;
+
+		#pragma omp parallel for schedule(dynamic, 16)
+		for (int cellNo = a; cellNo < b; cellNo++)
+		{
+			Cell *c = qt->cells + cellNo;
+			int n = c->nbParticles;
+			c->m = buffer + 3 * (pf->first[cellNo] - pf->first[a]);
+			c->x = c->m + n;
+			c->y = c->x + n;
+			P2M(qt->multipoles + qt->firstOuterCM + cellNo, c);
+			qt->counts[qt->firstOuterCM + cellNo] = n;
+			c->m = c->x = c->y = NULL;
+		}
+	}
+	free(buffer);
+	if (status < 0)
+		return -1;
+
+	// the children of a vertex come after it
+	for (int cmNo = qt->firstOuterCM - 1; cmNo >= 0; cmNo--)
+	{
+		M2M(qt->multipoles + cmNo, 4, qt->multipoles + 4*cmNo+1);
+		qt->counts[cmNo] = qt->counts[4*cmNo+1] + qt->counts[4*cmNo+2]
+						 + qt->counts[4*cmNo+3] + qt->counts[4*cmNo+4];
+	}
+	for (int cmNo = 1; cmNo < qt->nbMultipoles; cmNo++)
+		syncMultipole(qt, cmNo);
+	return 0;
+}
+
+// Choose the window of target cells starting at the cell start: the cells are added while
+// their near field holds at most maxResident particles. The near field is marked in marks and
+// listed in list. Returns the cell after the window, or -1 if the near field of the cell
+// start alone is too large
+static int chooseWindow(Quadtree *qt, int start, int64_t maxResident, double farFieldLimit,
+						int *queue, char *marks, int *list, int *nbListed)
+{
+	int64_t nbParticles = 0;
+	int end = start;
+	*nbListed = 0;
+
+	for ( ; end < qt->nbCells; end++)
+	{
+		int *added = list + *nbListed;
+		int nbAdded = listNearField(qt, end, farFieldLimit, queue, marks, added);
+		int64_t n = 0;
+		for (int k = 0; k < nbAdded; k++)
+			n += qt->cells[added[k]].nbParticles;
+
+		if (nbParticles + n > maxResident)
+		{
+			for (int k = 0; k < nbAdded; k++)
+				marks[added[k]] = 0;
+			break;
+		}
+		nbParticles += n;
+		*nbListed += nbAdded;
+	}
+
+	return (end > start) ? end : -1;
+}
+
+// Public
+
+// Write the particles 0 to nbParticles-1 of the generator gen in the file path, sorted by cell
+// of a quadtree of specified curve and height on its area. They are generated twice, by chunks
+// of chunkSize particles: once to count the particles of each cell, once to write them.
+// The forces are set to 0. Returns 0, or -1 with errno set
+int writeParticleFile(const char *path, SpaceFillingCurve curve, int height, int64_t nbParticles,
+					  Generator *gen, int chunkSize)
+{
+	ParticleFile pf;
+	ParticleFileHeader *h = &pf.header;
+	memset(h, 0, sizeof(*h));
+	strcpy(h->magic, PARTICLE_FILE_MAGIC);
+	h->curve = curve;
+	h->height = height;
+	h->xMin = gen->xMin; h->xMax = gen->xMax;
+	h->yMin = gen->yMin; h->yMax = gen->yMax;
+	h->nbParticles = nbParticles;
+
+	// sortByLeaf only needs the geometry of the quadtree
+	Quadtree qt;
+	initQuadtreeCurve(&qt, curve, height, 0, 0, 0, 0, h->xMin, h->xMax, h->yMin, h->yMax);
+	pf.nbCells = qt.nbCells;
+	pf.first = (int64_t *) calloc(qt.nbCells + 1, sizeof(int64_t));
+	int64_t *cursors = (int64_t *) calloc(qt.nbCells, sizeof(int64_t));
+	int *chunkFirst = (int *) malloc((qt.nbCells + 1) * sizeof(int));
+	int *order = (int *) malloc(chunkSize * sizeof(int));
+	double *m = (double *) malloc(6 * chunkSize * sizeof(double));
+	double *x = m + chunkSize, *y = x + chunkSize, *sorted = y + chunkSize;
+
+	for (int64_t start = 0; start < nbParticles; start += chunkSize)
+	{
+		int n = (nbParticles - start < chunkSize) ? nbParticles - start : chunkSize;
+		generateParticles(gen, start, n, m, x, y);
+		sortByLeaf(&qt, n, x, y, chunkFirst, order);
+		for (int cellNo = 0; cellNo < qt.nbCells; cellNo++)
+			pf.first[cellNo + 1] += chunkFirst[cellNo + 1] - chunkFirst[cellNo];
+	}
+	for (int cellNo = 0; cellNo < qt.nbCells; cellNo++)
+		pf.first[cellNo + 1] += pf.first[cellNo];
+
+	int status = -1;
+	pf.fd = open(path, O_CREAT | O_TRUNC | O_RDWR, 0644);
+	if (pf.fd >= 0 && pwriteAll(pf.fd, h, sizeof(*h), 0) == 0
+		&& pwriteAll(pf.fd, pf.first, (qt.nbCells + 1) * sizeof(int64_t), indexOffset()) == 0
+		&& ftruncate(pf.fd, forcesOffset(&pf, qt.nbCells)) == 0)
+		status = 0;
+
+	// the particles of a chunk are appended to the block of their cell, run by run
+	for (int64_t start = 0; start < nbParticles && status == 0; start += chunkSize)
+	{
+		int n = (nbParticles - start < chunkSize) ? nbParticles - start : chunkSize;
+		generateParticles(gen, start, n, m, x, y);
+		sortByLeaf(&qt, n, x, y, chunkFirst, order);
+
+		for (int cellNo = 0; cellNo < qt.nbCells && status == 0; cellNo++)
+		{
+			int o = chunkFirst[cellNo], k = chunkFirst[cellNo + 1] - o;
+			if (k == 0)
+				continue;
+			int64_t nc = pf.first[cellNo + 1] - pf.first[cellNo];
+			off_t block = particlesOffset(&pf, cellNo) + cursors[cellNo] * sizeof(double);
+			for (int i = 0; i < k; i++)
+			{
+				sorted[i] = m[order[o + i]];
+				sorted[k + i] = x[order[o + i]];
+				sorted[2*k + i] = y[order[o + i]];
+			}
+			for (int a = 0; a < 3 && status == 0; a++)
+				status = pwriteAll(pf.fd, sorted + a*k, k * sizeof(double), block + a * nc * sizeof(double));
+			cursors[cellNo] += k;
+		}
+	}
+
+	int e = errno;
+	if (pf.fd >= 0)
+		close(pf.fd);
+	freeQuadtree(&qt);
+	free(pf.first);
+	free(cursors);
+	free(chunkFirst);
+	free(order);
+	free(m);
+	errno = e;
+	return status;
+}
+
+// Open the particle file path, for reading and writing. Returns 0, or -1 with errno set
+int openParticleFile(ParticleFile *pf, const char *path)
+{
+	pf->first = NULL;
+	pf->fd = open(path, O_RDWR);
+	if (pf->fd < 0)
+		return -1;
+
+	ParticleFileHeader *h = &pf->header;
+	if (preadAll(pf->fd, h, sizeof(*h), 0) < 0 || strcmp(h->magic, PARTICLE_FILE_MAGIC) != 0
+		|| h->height < 1 || h->height > 16)
+	{
+		close(pf->fd);
+		errno = EINVAL;
+		return -1;
+	}
+
+	pf->nbCells = 1 << (2 * (h->height - 1));
+	pf->first = (int64_t *) malloc((pf->nbCells + 1) * sizeof(int64_t));
+	if (preadAll(pf->fd, pf->first, (pf->nbCells + 1) * sizeof(int64_t), indexOffset()) < 0)
+	{
+		int e = errno;
+		closeParticleFile(pf);
+		errno = e;
+		return -1;
+	}
+	return 0;
+}
+
+// Release the ressources associated with the particle file, and close it
+void closeParticleFile(ParticleFile *pf)
+{
+	close(pf->fd);
+	free(pf->first);
+	pf->first = NULL;
+}
+
+// Read the particles and forces of the cell cellNo, pf->first[cellNo+1] - pf->first[cellNo]
+// values in each array. Returns 0, or -1 with errno set
+int readParticleCell(ParticleFile *pf, int cellNo, double *m, double *x, double *y,
+					 double *fx, double *fy)
+{
+	size_t n = pf->first[cellNo + 1] - pf->first[cellNo], size = n * sizeof(double);
+	off_t p = particlesOffset(pf, cellNo), f = forcesOffset(pf, cellNo);
+	if (preadAll(pf->fd, m, size, p) < 0 || preadAll(pf->fd, x, size, p + size) < 0
+		|| preadAll(pf->fd, y, size, p + 2*size) < 0 || preadAll(pf->fd, fx, size, f) < 0
+		|| preadAll(pf->fd, fy, size, f + size) < 0)
+		return -1;
+	return 0;
+}
+
+// Compute the gravitationnal force exerted on each particle of the file, and write them in it,
+// with at most maxResident particles in memory, besides the multipoles. stats is filled if it is
+// not NULL. Returns 0, or -1 with errno set: ENOMEM if the near field of a cell holds more than
+// maxResident particles
+int computeForcesOutOfCore(ParticleFile *pf, int64_t maxResident, double farFieldLimit,
+						   OutOfCoreStats *stats)
+{
+	Quadtree qt;
+	initQuadtreeGeometry(&qt, pf);
+	if (computeMultipolesOutOfCore(&qt, pf, maxResident) < 0)
+	{
+		int e = errno;
+		freeQuadtree(&qt);
+		errno = e;
+		return -1;
+	}
+
+	OutOfCoreStats st = {0, 0, 0};
+	int *queue = (int *) malloc(qt.nbMultipoles * sizeof(int));
+	char *marks[2] = {(char *) calloc(qt.nbCells, 1), (char *) calloc(qt.nbCells, 1)};
+	int *lists[2] = {(int *) malloc(qt.nbCells * sizeof(int)), (int *) malloc(qt.nbCells * sizeof(int))};
+	int nbListed[2];
+	int *residents = (int *) malloc(qt.nbCells * sizeof(int)), nbResidents = 0;
+	int *targets = (int *) malloc(qt.nbCells * sizeof(int));
+	double *forces = (double *) malloc(2 * maxResident * sizeof(double));
+	int64_t residentParticles = 0;
+	int status = 0;
+
+	int w = 0, start = 0;
+	int end = chooseWindow(&qt, 0, maxResident, farFieldLimit, queue, marks[0], lists[0], nbListed);
+	if (end < 0)
+	{
+		errno = ENOMEM;
+		status = -1;
+	}
+
+	while (status == 0 && start < qt.nbCells)
+	{
+		char *mk = marks[w];
+		int *list = lists[w];
+
+		// keep the cells of the previous window in the near field of this one
+		int nbKept = 0;
+		for (int i = 0; i < nbResidents; i++)
+		{
+			Cell *c = qt.cells + residents[i];
+			if (mk[residents[i]])
+				residents[nbKept++] = residents[i];
+			else
+			{
+				residentParticles -= c->nbParticles;
+				evictCell(c);
+			}
+		}
+		nbResidents = nbKept;
+
+		// read the others in the order of the file
+		qsort(list, nbListed[w], sizeof(int), cmpInt);
+		for (int i = 0; i < nbListed[w] && status == 0; i++)
+		{
+			Cell *c = qt.cells + list[i];
+			int n = c->nbParticles;
+			if (c->m != NULL || n == 0)
+				continue;
+
+			c->m = (double *) malloc(5 * n * sizeof(double));
+			c->x = c->m + n;
+			c->y = c->x + n;
+			c->fx = c->y + n;
+			c->fy = c->fx + n;
+			status = preadAll(pf->fd, c->m, 3 * n * sizeof(double), particlesOffset(pf, list[i]));
+			memset(c->fx, 0, 2 * n * sizeof(double));
+			residents[nbResidents++] = list[i];
+			residentParticles += n;
+			st.bytesRead += 3 * n * sizeof(double);
+		}
+		st.maxResident = (residentParticles > st.maxResident) ? residentParticles : st.maxResident;
+		if (status < 0)
+			break;
+
+		// prefetch the near field of the next window while computing this one
+		int nextEnd = end;
+		if (end < qt.nbCells)
+		{
+			nextEnd = chooseWindow(&qt, end, maxResident, farFieldLimit, queue, marks[1-w],
+								   lists[1-w], nbListed + 1-w);
+			if (nextEnd < 0)
+			{
+				errno = ENOMEM;
+				status = -1;
+				break;
+			}
+			for (int i = 0; i < nbListed[1-w]; i++)
+			{
+				int cellNo = lists[1-w][i];
+				if (qt.cells[cellNo].m == NULL && qt.cells[cellNo].nbParticles > 0)
+					posix_fadvise(pf->fd, particlesOffset(pf, cellNo),
+								  3 * qt.cells[cellNo].nbParticles * sizeof(double), POSIX_FADV_WILLNEED);
+			}
+		}
+
+		int nbTargets = 0;
+		for (int cellNo = start; cellNo < end; cellNo++)
+			if (qt.cells[cellNo].nbParticles > 0)
+				targets[nbTargets++] = cellNo;
+		qt.activeCells = targets;
+		qt.nbActiveCells = nbTargets;
+		computeForces(&qt, farFieldLimit);
+		qt.activeCells = NULL;
+
+		// the forces of the window are contiguous in the file
+		for (int cellNo = start; cellNo < end; cellNo++)
+		{
+			Cell *c = qt.cells + cellNo;
+			int64_t o = 2 * (pf->first[cellNo] - pf->first[start]);
+			memcpy(forces + o, c->fx, c->nbParticles * sizeof(double));
+			memcpy(forces + o + c->nbParticles, c->fy, c->nbParticles * sizeof(double));
+		}
+		status = pwriteAll(pf->fd, forces, 2 * (pf->first[end] - pf->first[start]) * sizeof(double),
+						   forcesOffset(pf, start));
+
+		for (int i = 0; i < nbListed[w]; i++)
+			mk[list[i]] = 0;
+		st.nbWindows++;
+		start = end;
+		end = nextEnd;
+		w = 1 - w;
+	}
+
+	int e = errno;
+	for (int i = 0; i < nbResidents; i++)
+		evictCell(qt.cells + residents[i]);
+	freeQuadtree(&qt);
+	free(queue);
+	free(marks[0]);
+	free(marks[1]);
+	free(lists[0]);
+	free(lists[1]);
+	free(residents);
+	free(targets);
+	free(forces);
+
+	if (stats != NULL)
+		*stats = st;
+	errno = e;
+	return status;
+}
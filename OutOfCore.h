@@ -0,0 +1,75 @@
+#ifndef OUT_OF_CORE_H
+#define OUT_OF_CORE_H
+
+#include <stdint.h>
+
+#include "Quadtree.h"
+
+struct Generator;
+
+// Out-of-core mode, for particle sets larger than the memory: the particles stay in a file,
+// sorted by cell along the curve of the quadtree, and only the multipoles are kept in memory.
+//
+// The file holds a header, the index of the first particle of each cell, then the particles
+// of each cell in one block (m, x, y), then the forces of each cell in one block (fx, fy),
+// in the order of the cells. computeForcesOutOfCore streams it twice:
+// - the cells in order, by runs of maxResident particles, for their multipoles
+// - the target cells in order, by windows: a window is a run of cells whose near field
+//   (see listNearField) holds at most maxResident particles. The cells of the near field
+//   are read, those of the previous window being kept, and the forces of the window are
+//   computed by computeForces on its cells, then written in one sequential write.
+//   The near field of the next window is prefetched by the kernel while computing one.
+
+typedef struct ParticleFileHeader
+{
+	char magic[8];
+	int curve;                 // SpaceFillingCurve
+	int height;                // of the quadtree, on the area [xMin, xMax]*[yMin, yMax]
+	double xMin;
+	double xMax;
+	double yMin;
+	double yMax;
+	int64_t nbParticles;
+} ParticleFileHeader;
+
+typedef struct ParticleFile
+{
+	int fd;
+	ParticleFileHeader header;
+	int nbCells;
+	int64_t *first;            // particles of the cell i: first[i] to first[i+1]-1
+} ParticleFile;
+
+typedef struct OutOfCoreStats
+{
+	int nbWindows;
+	int64_t maxResident;       // largest number of particles in memory
+	int64_t bytesRead;         // by the forces pass, the multipoles pass reads the file once
+} OutOfCoreStats;
+
+// Write the particles 0 to nbParticles-1 of the generator gen in the file path, sorted by cell
+// of a quadtree of specified curve and height on its area. They are generated twice, by chunks
+// of chunkSize particles: once to count the particles of each cell, once to write them.
+// The forces are set to 0. Returns 0, or -1 with errno set
+extern int writeParticleFile(const char *path, SpaceFillingCurve curve, int height, int64_t nbParticles,
+							 struct Generator *gen, int chunkSize);
+
+// Open the particle file path, for reading and writing. Returns 0, or -1 with errno set
+extern int openParticleFile(ParticleFile *pf, const char *path);
+
+// Release the ressources associated with the particle file, and close it
+extern void closeParticleFile(ParticleFile *pf);
+
+// Read the particles and forces of the cell cellNo, pf->first[cellNo+1] - pf->first[cellNo]
+// values in each array. Returns 0, or -1 with errno set
+extern int readParticleCell(ParticleFile *pf, int cellNo, double *m, double *x, double *y,
+							double *fx, double *fy);
+
+// Compute the gravitationnal force exerted on each particle of the file, and write them in it,
+// with at most maxResident particles in memory, besides the multipoles. stats is filled if it is
+// not NULL. Returns 0, or -1 with errno set: ENOMEM if the near field of a cell holds more than
+// maxResident particles
+extern int computeForcesOutOfCore(ParticleFile *pf, int64_t maxResident, double farFieldLimit,
+								  OutOfCoreStats *stats);
+
+#endif
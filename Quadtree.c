@@ -1,14 +1,147 @@
+#include "Ewald.h"
+#include "Generator.h"
+#include "Hilbert.h"
 #include "Morton.h"
 #include "Quadtree.h"
+#include "TreePM.h"
+#include "utils.h"
 
+#include <errno.h>
 #include <math.h>
 #include <mpi.h>
 #include <omp.h>
+#include <stdlib.h>
+#include <string.h>
 // Private auxiliary functions prototypes
 
+// Length l of the multipole mp for the MAC of the quadtree, see MultipoleAcceptance
+static inline double macLength(Quadtree *qt, Multipole *mp)
+{
+	double width = mp->xMax - mp->xMin;
+	if (qt->mac == GEOMETRIC_MAC)
+		return width;
+
+	// distance from the center of mass to the farthest corner of the box
+	double bx = fmax(mp->x - mp->xMin, mp->xMax - mp->x);
+	double by = fmax(mp->y - mp->yMin, mp->yMax - mp->y);
+	double bMax = sqrt(bx*bx + by*by);
+	if (qt->mac == BMAX_MAC)
+		return bMax;
+
+	// d (d - bMax) = k bMax solves 3 G m bMax² / (d² (d - bMax)²) = macTolerance
+	double k = sqrt(3 * G * mp->m / qt->macTolerance);
+	return 0.5 * (bMax + sqrt(bMax*bMax + 4 * k * bMax));
+}
+
+// Returns 1 if the vertex of center (x, y) and width l is in the far field of the cell c:
+// d > l / farFieldLimit where d is the distance between the center and the boundaries of c
+static inline int inFarField(double x, double y, double l, Cell *c, double farFieldLimit)
+{
+	double dx = (x < c->xMin) ? c->xMin - x : (x > c->xMax) ? x - c->xMax : 0;
+	double dy = (y < c->yMin) ? c->yMin - y : (y > c->yMax) ? y - c->yMax : 0;
+	double r = l / farFieldLimit;
+	return dx*dx + dy*dy > r*r;
+}
+
+// Returns 1 if P2P is the cheapest valid option for the vertex cmNo, in the far field of a cell 
+// of nt particles if far is set. With the costs of qt, in interactions:
+// - M2P costs one kernel call, costCall + nt, valid in the far field only
+// - P2P costs one call per particle below the vertex, always valid and exact
+// - opening an inner vertex costs at least 4 visits and one call, 4 costVisit + costCall + nt
+static inline int chooseP2P(Quadtree *qt, int cmNo, int far, double nt)
+{
+	double call = qt->costCall + nt;
+	double other = far ? call : (cmNo < qt->firstOuterCM) ? 4 * qt->costVisit + call : INFINITY;
+	return qt->counts[cmNo] * call <= other;
+}
+
+// Mark the cells below the vertex cmNo if the walk of a cell of nt particles applies them 
+// by P2P, or queue it if the walk opens it. If list is not NULL, the cells not marked yet
+// are also appended to it, not atomically
+static inline void markVertex(Quadtree *qt, int cmNo, int far, double nt, int *queue, int *tail, 
+							  char *marks, int *list, int *nbListed)
+{
+	if (qt->counts[cmNo] == 0)
+		return;
+	if (!chooseP2P(qt, cmNo, far, nt))
+	{
+		if (!far)
+			queue[(*tail)++] = cmNo;
+		return;
+	}
+
+	int first = cmNo, last = cmNo;
+	while (first < qt->firstOuterCM)
+	{
+		first = 4*first+1;
+		last = 4*last+4;
+	}
+	for (int i = first - qt->firstOuterCM; i <= last - qt->firstOuterCM; i++)
+	{
+		if (list != NULL)
+		{
+			if (!marks[i])
+				list[(*nbListed)++] = i;
+			marks[i] = 1;
+		}
+		else
+		{
+			#pragma omp atomic write
+			marks[i] = 1;
+		}
+	}
+}
+
 // Compute the centers of mass of the i-th vertex and its children
 static void computeCMrec(Quadtree *qt, int cmNo);
 
+// Bounds of the contiguous ranges of cells (or groups) owned by the threads: the thread t of 
+// nbThreads owns the items ownedBound(t) to ownedBound(t+1)-1 of nbItems
+static inline int ownedBound(int t, int nbThreads, int nbItems)
+{
+	return (int)((long)nbItems * t / nbThreads);
+}
+
+// Counters of the owned schedule, one per cache line
+#define SCHEDULE_STRIDE 16
+
+// Owned schedule of nbItems items: returns the next item for the thread t of nbThreads, the 
+// next one of its own range, or once it is done the next one of the ranges of the other threads,
+// -1 at the end. next holds the counters of the ranges, set to their first items
+static inline int nextOwnedItem(int *next, int t, int nbThreads, int nbItems)
+{
+	for (int k = 0; k < nbThreads; k++)
+	{
+		int v = (t + k) % nbThreads, i;
+		#pragma omp atomic capture
+		i = next[v * SCHEDULE_STRIDE]++;
+		if (i < ownedBound(v+1, nbThreads, nbItems))
+			return i;
+	}
+	return -1;
+}
+
+// Allocate the cells and multipoles of a quadtree, the cells are not initialized
+static void allocQuadtree(Quadtree *qt, SpaceFillingCurve curve, int height, 
+						  double xMin, double xMax, double yMin, double yMax);
+
+// Apply on the cell c the forces of the multipoles in its far field, and of the particles 
+// of the cells in its near field. If c is the cell selfNo of the quadtree, the forces of its 
+// own particles are applied by P2P_in, selfNo is -1 for a cell outside the quadtree.
+// lists is a buffer of WALK_LISTS_SIZE(qt) vertices
+static void walkCell(Quadtree *qt, Cell *c, int selfNo, double farFieldLimit, int *lists, WorkingVecs *wv);
+
+// Size of the buffer of walkCell: its queue of opened vertices, far field and near field lists, 
+// with the margin of the branch-free appends
+#define WALK_LISTS_SIZE(qt) (3 * ((qt)->nbMultipoles + 4))
+
+// Apply on the cells below the vertex groupNo the forces of all the particles,
+// with one walk for the group. lists is a buffer of GROUP_LISTS_SIZE(qt) vertices
+static void walkGroup(Quadtree *qt, int groupNo, double farFieldLimit, int *lists, WorkingVecs *wv);
+
+// Size of the buffer of walkGroup: the lists of the group, then of its cells
+#define GROUP_LISTS_SIZE(qt) (2 * WALK_LISTS_SIZE(qt))
+
 // Public functions
 
 // Initialise the cells of a quadtree of specified height, built on the 2D area [xMin, xMax]*[yMin, yMax]
@@ -17,16 +150,16 @@ static void computeCMrec(Quadtree *qt, int cmNo);
 void initQuadtree(Quadtree *qt, int height, int nbPartMin, int nbPartMax, 
 				  double mMin, double mMax, double xMin, double xMax, double yMin, double yMax)
 {
-	qt->height = height;
-	qt->xMin = xMin;
-	qt->xMax = xMax;
-	qt->yMin = yMin;
-	qt->yMax = yMax;
-	qt->nbCells = powl(4, height-1);
-	qt->cells = (Cell *) malloc(qt->nbCells * sizeof(Cell));
-	qt->nbMultipoles = (powl(4, height) - 1) / 3;
-	qt->multipoles = (Multipole *) malloc(qt->nbMultipoles * sizeof(Multipole));
-	qt->firstOuterCM = qt->nbMultipoles - qt->nbCells; 
+	initQuadtreeCurve(qt, MORTON_CURVE, height, nbPartMin, nbPartMax, mMin, mMax, xMin, xMax, yMin, yMax);
+}
+
+// Same as initQuadtree, but the cells are numbered along the specified curve.
+// A contiguous range of cells is a more compact area with HILBERT_CURVE
+void initQuadtreeCurve(Quadtree *qt, SpaceFillingCurve curve, int height, int nbPartMin, 
+					   int nbPartMax, double mMin, double mMax, double xMin, double xMax, 
+					   double yMin, double yMax)
+{
+	allocQuadtree(qt, curve, height, xMin, xMax, yMin, yMax);
 	
 	long dim = powl(2, height-1);
 	double dX = (xMax - xMin) / (double)dim;
@@ -34,23 +167,285 @@ void initQuadtree(Quadtree *qt, int height, int nbPartMin, int nbPartMax,
 	int nbPartPerCellMin = nbPartMin / qt->nbCells;
 	int nbPartPerCellMax = nbPartMax / qt->nbCells;
 
-	int cellNo;
+	// Number all the cells at once
+	uint32_t *xs = (uint32_t *) malloc(2 * qt->nbCells * sizeof(uint32_t));
+	uint32_t *ys = xs + qt->nbCells;
+	uint64_t *keys = (uint64_t *) malloc(qt->nbCells * sizeof(uint64_t));
 	for (int x = 0; x < dim; x++)
 		for (int y = 0; y < dim; y++)
 		{
-			cellNo = xy_to_morton(x, y);
-			initCell(qt->cells + cellNo, nbPartPerCellMin, nbPartPerCellMax, mMin, mMax, 
-					 x*dX, (x+1)*dX, y*dY, (y+1)*dY);
+			xs[x*dim + y] = x;
+			ys[x*dim + y] = y;
+		}
+
+	if (curve == HILBERT_CURVE)
+		xy_to_hilbert_batch(qt->nbCells, xs, ys, height-1, keys);
+	else
+		xy_to_morton_batch(qt->nbCells, xs, ys, keys);
+
+	for (int i = 0; i < qt->nbCells; i++)
+		initCell(qt->cells + keys[i], nbPartPerCellMin, nbPartPerCellMax, mMin, mMax, 
+				 xMin + xs[i]*dX, xMin + (xs[i]+1)*dX, yMin + ys[i]*dY, yMin + (ys[i]+1)*dY);
+
+	free(xs);
+	free(keys);
+}
+
+// Initialise a quadtree of specified height on the area of the generator gen, with its 
+// particles 0 to nbParticles-1 sorted by cell. The particles are generated in parallel,
+// and the cells are placed as by placeQuadtree
+void initQuadtreeGenerator(Quadtree *qt, SpaceFillingCurve curve, int height, int nbParticles,
+						   Generator *gen)
+{
+	allocQuadtree(qt, curve, height, gen->xMin, gen->xMax, gen->yMin, gen->yMax);
+
+	double *m = (double *) malloc(3 * nbParticles * sizeof(double));
+	double *x = m + nbParticles, *y = x + nbParticles;
+	generateParticles(gen, 0, nbParticles, m, x, y);
+
+	int *first = (int *) malloc((qt->nbCells + 1) * sizeof(int));
+	int *order = (int *) malloc(nbParticles * sizeof(int));
+	sortByLeaf(qt, nbParticles, x, y, first, order);
+
+	long dim = 1L << (height - 1);
+	double dX = (gen->xMax - gen->xMin) / (double)dim;
+	double dY = (gen->yMax - gen->yMin) / (double)dim;
+
+	// each cell is first touched by the thread owning it, see placeQuadtree
+	#pragma omp parallel
+	{
+		int t = omp_get_thread_num(), nbThreads = omp_get_num_threads();
+		for (int cellNo = ownedBound(t, nbThreads, qt->nbCells); 
+			 cellNo < ownedBound(t+1, nbThreads, qt->nbCells); cellNo++)
+		{
+			uint32_t u, v;
+			if (curve == HILBERT_CURVE)
+				hilbert_to_xy(cellNo, height-1, &u, &v);
+			else
+				morton_to_xy(cellNo, &u, &v);
+
+			Cell *c = qt->cells + cellNo;
+			int o = first[cellNo], n = first[cellNo + 1] - o;
+			c->xMin = gen->xMin + u*dX; c->xMax = gen->xMin + (u+1)*dX; 
+			c->yMin = gen->yMin + v*dY; c->yMax = gen->yMin + (v+1)*dY;
+			c->pot = NULL;
+			c->vir[0] = c->vir[1] = c->vir[2] = 0;
+			c->nbParticles = n;
+			c->m = (double *) malloc(5 * n * sizeof(double));
+			c->x = c->m + n;
+			c->y = c->x + n;
+			c->fx = c->y + n;
+			c->fy = c->fx + n;
+			for (int k = 0; k < n; k++)
+			{
+				c->m[k] = m[order[o + k]];
+				c->x[k] = x[order[o + k]];
+				c->y[k] = y[order[o + k]];
+				c->fx[k] = c->fy[k] = 0;
+			}
 		}
+	}
+	qt->placed = 1;
+
+	free(m);
+	free(first);
+	free(order);
+}
+
+// Sort in place the nbParticles particles (m, x, y) by cell of a quadtree of specified curve and 
+// height on the area [xMin, xMax]*[yMin, yMax], as expected by initQuadtreeArrays. If order is not 
+// NULL, it receives the initial index of each particle, to sort the other arrays of the caller
+void sortParticles(SpaceFillingCurve curve, int height, double xMin, double xMax, double yMin, 
+				   double yMax, int nbParticles, double *m, double *x, double *y, int *order)
+{
+	// sortByLeaf only needs the geometry of the quadtree
+	Quadtree qt;
+	qt.curve = curve;
+	qt.height = height;
+	qt.xMin = xMin; qt.xMax = xMax;
+	qt.yMin = yMin; qt.yMax = yMax;
+	qt.nbCells = 1 << (2 * (height - 1));
+
+	int *first = (int *) malloc((qt.nbCells + 1) * sizeof(int));
+	int *o = (order != NULL) ? order : (int *) malloc(nbParticles * sizeof(int));
+	sortByLeaf(&qt, nbParticles, x, y, first, o);
+
+	double *sorted = (double *) malloc(3 * nbParticles * sizeof(double));
+	#pragma omp parallel for
+	for (int i = 0; i < nbParticles; i++)
+	{
+		sorted[i] = m[o[i]];
+		sorted[nbParticles + i] = x[o[i]];
+		sorted[2*nbParticles + i] = y[o[i]];
+	}
+	memcpy(m, sorted, nbParticles * sizeof(double));
+	memcpy(x, sorted + nbParticles, nbParticles * sizeof(double));
+	memcpy(y, sorted + 2*nbParticles, nbParticles * sizeof(double));
+
+	free(sorted);
+	free(first);
+	if (order == NULL)
+		free(o);
+}
+
+// Initialise a quadtree of specified height on the area [xMin, xMax]*[yMin, yMax], on the arrays 
+// of nbParticles particles (m, x, y) of the caller, sorted by cell, without copying them: each cell 
+// is a view on its range of the arrays, and computeForces adds the forces to fx and fy.
+// The arrays stay owned by the caller, and must outlive the quadtree.
+// Returns 0, or -1 if the particles are not sorted by cell
+int initQuadtreeArrays(Quadtree *qt, SpaceFillingCurve curve, int height, int nbParticles, 
+					   double *m, double *x, double *y, double *fx, double *fy, 
+					   double xMin, double xMax, double yMin, double yMax)
+{
+	allocQuadtree(qt, curve, height, xMin, xMax, yMin, yMax);
+	qt->views = 1;
+
+	int *first = (int *) malloc((qt->nbCells + 1) * sizeof(int));
+	int *order = (int *) malloc(nbParticles * sizeof(int));
+	sortByLeaf(qt, nbParticles, x, y, first, order);
+
+	// the sort is stable, sorted particles keep their order
+	int sorted = 1;
+	for (int i = 0; i < nbParticles && sorted; i++)
+		sorted = (order[i] == i);
+	free(order);
+
+	long dim = 1L << (height - 1);
+	double dX = (xMax - xMin) / (double)dim;
+	double dY = (yMax - yMin) / (double)dim;
+
+	for (int cellNo = 0; cellNo < qt->nbCells; cellNo++)
+	{
+		uint32_t u, v;
+		if (curve == HILBERT_CURVE)
+			hilbert_to_xy(cellNo, height-1, &u, &v);
+		else
+			morton_to_xy(cellNo, &u, &v);
+
+		Cell *c = qt->cells + cellNo;
+		int o = sorted ? first[cellNo] : 0;
+		c->xMin = xMin + u*dX; c->xMax = xMin + (u+1)*dX; 
+		c->yMin = yMin + v*dY; c->yMax = yMin + (v+1)*dY;
+		c->pot = NULL;
+		c->vir[0] = c->vir[1] = c->vir[2] = 0;
+		c->nbParticles = sorted ? first[cellNo + 1] - o : 0;
+		c->m = m + o;
+		c->x = x + o;
+		c->y = y + o;
+		c->fx = fx + o;
+		c->fy = fy + o;
+	}
+
+	free(first);
+	if (!sorted)
+	{
+		freeQuadtree(qt);
+		return -1;
+	}
+	return 0;
+}
+
+// Returns the number of the cell at (dx, dy) cells of the cell cellNo, -1 if out of the grid
+int quadtreeNeighbour(Quadtree *qt, int cellNo, int dx, int dy)
+{
+	uint64_t key = (qt->curve == HILBERT_CURVE) ? hilbertNeighbour(cellNo, dx, dy, qt->height-1) 
+											   : mortonNeighbour(cellNo, dx, dy, qt->height-1);
+	return (key == NO_NEIGHBOUR) ? -1 : (int)key;
 }
 
 // Release the ressources associated with the specified quadtree
 void freeQuadtree(Quadtree *qt)
 {
 	for (int i = 0; i < qt->nbCells; i++)
-		freeCell(qt->cells + i);
+	{
+		if (qt->views)
+			free(qt->cells[i].pot);
+		else
+			freeCell(qt->cells + i);
+	}
 	free(qt->cells);
 	free(qt->multipoles);
+	free(qt->groups);
+	free(qt->counts);
+}
+
+
+// Move the particles of each cell to the memory of the thread owning it, i.e. of its NUMA node:
+// each thread owns a contiguous range of cells along the curve, and copies them first.
+// computeForces then starts each thread on its own cells, and shares the last ones
+void placeQuadtree(Quadtree *qt)
+{
+	if (qt->views)
+		return;
+
+	#pragma omp parallel
+	{
+		int t = omp_get_thread_num(), nbThreads = omp_get_num_threads();
+		for (int cellNo = ownedBound(t, nbThreads, qt->nbCells); 
+			 cellNo < ownedBound(t+1, nbThreads, qt->nbCells); cellNo++)
+		{
+			Cell *c = qt->cells + cellNo;
+			int n = c->nbParticles;
+			double *m = (double *) malloc(5 * n * sizeof(double));
+			memcpy(m, c->m, 5 * n * sizeof(double));
+			free(c->m);
+			c->m = m;
+			c->x = m + n;
+			c->y = c->x + n;
+			c->fx = c->y + n;
+			c->fy = c->fx + n;
+
+			if (c->pot != NULL)
+			{
+				double *pot = (double *) malloc(n * sizeof(double));
+				memcpy(pot, c->pot, n * sizeof(double));
+				free(c->pot);
+				c->pot = pot;
+			}
+		}
+	}
+	qt->placed = 1;
+}
+
+// Enable the computation of the potential energy and virial of the particles of the quadtree
+// in the same pass as the forces by computeForces, and reset them
+void initQuadtreePotential(Quadtree *qt)
+{
+	for (int i = 0; i < qt->nbCells; i++)
+		initPotential(qt->cells + i);
+}
+
+// Total potential energy and virial (xx, xy, yy) of the particles of the quadtree, 
+// accumulated by computeForces after initQuadtreePotential. Returns 0, or -1 with errno set
+// to EINVAL if the last forces were computed in TreePM or periodic mode, without them
+//
+// Note: each pair of particles is counted by both of its particles, hence the halves
+int computeEnergy(Quadtree *qt, double *potential, double *virial)
+{
+	if (qt->potentialSkipped || qt->pm != NULL || qt->ewald != NULL)
+	{
+		errno = EINVAL;
+		return -1;
+	}
+
+	double u = 0, wxx = 0, wxy = 0, wyy = 0;
+
+	#pragma omp parallel for reduction(+:u, wxx, wxy, wyy)
+	for (int cellNo = 0; cellNo < qt->nbCells; cellNo++)
+	{
+		Cell *c = qt->cells + cellNo;
+		for (int i = 0; i < c->nbParticles; i++)
+			u += c->pot[i];
+		wxx += c->vir[0];
+		wxy += c->vir[1];
+		wyy += c->vir[2];
+	}
+
+	*potential = 0.5 * u;
+	virial[0] = 0.5 * wxx;
+	virial[1] = 0.5 * wxy;
+	virial[2] = 0.5 * wyy;
+	return 0;
 }
 
 
@@ -59,6 +454,60 @@ void freeQuadtree(Quadtree *qt)
 void computeMultipoles(Quadtree *qt)
 {
 	computeCMrec(qt, 0);
+	for (int cmNo = 1; cmNo < qt->nbMultipoles; cmNo++)
+		syncMultipole(qt, cmNo);
+}
+
+// Copy the multipole cmNo to the traversal layout, after modifying it outside of computeMultipoles
+void syncMultipole(Quadtree *qt, int cmNo)
+{
+	if (cmNo == 0)
+		return;
+
+	Multipole *mp = qt->multipoles + cmNo;
+	MultipoleGroup *g = qt->groups + (cmNo-1) / 4;
+	int j = (cmNo-1) % 4;
+	g->x[j] = mp->x;
+	g->y[j] = mp->y;
+	g->m[j] = mp->m;
+	g->l[j] = macLength(qt, mp);
+}
+
+// Mark the cells in the near field of the cell cellNo, itself included, i.e. the cells
+// whose particles computeForces applies on it by P2P: marks[i] is set to 1 for each of them.
+// queue holds qt->nbMultipoles vertices
+void markNearField(Quadtree *qt, int cellNo, double farFieldLimit, int *queue, char *marks)
+{
+	listNearField(qt, cellNo, farFieldLimit, queue, marks, NULL);
+}
+
+// Same as markNearField, and the cells it marks that were not marked yet are appended to list
+// if it is not NULL, which holds qt->nbCells cells. Returns their number. 
+// Not thread safe with a list
+int listNearField(Quadtree *qt, int cellNo, double farFieldLimit, int *queue, char *marks, int *list)
+{
+	Cell *c = qt->cells + cellNo;
+	double nt = c->nbParticles;
+	int head = 0, tail = 0, nbListed = 0;
+	Multipole *root = qt->multipoles;
+
+	markVertex(qt, 0, inFarField(root->x, root->y, macLength(qt, root), c, farFieldLimit), 
+			   nt, queue, &tail, marks, list, &nbListed);
+	while (head < tail)
+	{
+		int parent = queue[head++];
+		MultipoleGroup *g = qt->groups + parent;
+
+		for (int j = 0; j < 4; j++)
+			markVertex(qt, 4*parent+1 + j, inFarField(g->x[j], g->y[j], g->l[j], c, farFieldLimit), 
+					   nt, queue, &tail, marks, list, &nbListed);
+	}
+
+	if (list != NULL && !marks[cellNo])
+		list[nbListed++] = cellNo;
+	#pragma omp atomic write
+	marks[cellNo] = 1;
+	return nbListed;
 }
 
 // Compute the gravitationnal force exerted on each particule of the quadtree
@@ -67,48 +516,147 @@ void computeMultipoles(Quadtree *qt)
 // and w is the width of the area approximated by the cm
 void computeForces(Quadtree *qt, double farFieldLimit)
 {
+	// the operators of these modes do not accumulate the potential
+	qt->potentialSkipped = (qt->pm != NULL || qt->ewald != NULL);
+
+	// the group walk is only in the default mode, on all the cells
+	int groupLevels = qt->groupLevels;
+	groupLevels = (groupLevels < qt->height-1) ? groupLevels : qt->height-1;
+	if (qt->pm != NULL || qt->ewald != NULL || qt->activeCells != NULL)
+		groupLevels = 0;
+
+	// cells, groups of cells or active cells
+	int nbItems = (groupLevels > 0) ? qt->nbCells >> (2*groupLevels) 
+				: (qt->activeCells != NULL) ? qt->nbActiveCells : qt->nbCells;
+	int owned = qt->placed && qt->activeCells == NULL;
+	int *next = (int *) malloc(omp_get_max_threads() * SCHEDULE_STRIDE * sizeof(int));
+
 	#pragma omp parallel
 	{
 		WorkingVecs wv;
 		initWorkingVecs(&wv);
 
-		#pragma omp for schedule(dynamic, 1)
-		for (int cellNo = 0; cellNo < qt->nbCells; cellNo++)
+		// with the owned schedule, each thread starts with the cells it placed, or the groups 
+		// of these cells, the groups of a level being in the order of their cells
+		int t = omp_get_thread_num(), nbThreads = omp_get_num_threads();
+		if (owned)
+		{
+			next[t * SCHEDULE_STRIDE] = ownedBound(t, nbThreads, nbItems);
+			#pragma omp barrier
+		}
+
+		if (groupLevels > 0)
 		{
-			int queue[qt->nbMultipoles];
-			int head = 0, tail = 0;
-			queue[tail++] = 0;
+			int *lists = (int *) malloc(GROUP_LISTS_SIZE(qt) * sizeof(int));
+			int firstGroup = qt->firstOuterCM;
+			for (int k = 0; k < groupLevels; k++)
+				firstGroup = (firstGroup - 1) / 4;
 
-			int cmNo;
-			double d, l;
-			while (head < tail)
+			if (owned)
+				for (int i; (i = nextOwnedItem(next, t, nbThreads, nbItems)) >= 0; )
+					walkGroup(qt, firstGroup + i, farFieldLimit, lists, &wv);
+			else
 			{
-				cmNo = queue[head++];
+				#pragma omp for schedule(dynamic, 1)
+				for (int i = 0; i < nbItems; i++)
+					walkGroup(qt, firstGroup + i, farFieldLimit, lists, &wv);
+			}
 
-				d = distance(qt->multipoles + cmNo, qt->cells + cellNo); 
-				l = qt->multipoles[cmNo].xMax - qt->multipoles[cmNo].xMin;
+			free(lists);
+		}
+		else
+		{
+			int *lists = (int *) malloc(WALK_LISTS_SIZE(qt) * sizeof(int));
 
-				if (d > l / farFieldLimit)
-				{
-					M2P(qt->multipoles + cmNo, qt->cells + cellNo, &wv);
-				}
-				else if (cmNo < qt->firstOuterCM)
-				{
-					queue[tail++] = 4*cmNo+1;
-					queue[tail++] = 4*cmNo+2;
-					queue[tail++] = 4*cmNo+3;
-					queue[tail++] = 4*cmNo+4;
-				}
-				else if (cmNo != qt->firstOuterCM + cellNo)
+			if (owned)
+				for (int i; (i = nextOwnedItem(next, t, nbThreads, nbItems)) >= 0; )
+					walkCell(qt, qt->cells + i, i, farFieldLimit, lists, &wv);
+			else
+			{
+				// only the active cells, when a list is set
+				#pragma omp for schedule(dynamic, 1)
+				for (int i = 0; i < nbItems; i++)
 				{
-					P2P_ext(qt->cells + (cmNo - qt->firstOuterCM), qt->cells + cellNo, &wv);
+					int cellNo = (qt->activeCells != NULL) ? qt->activeCells[i] : i;
+					walkCell(qt, qt->cells + cellNo, cellNo, farFieldLimit, lists, &wv);
 				}
 			}
-			P2P_in(qt->cells + cellNo, &wv);
+
+			free(lists);
 		}
 		
 		freeWorkingVecs(&wv);
 	}
+
+	free(next);
+}
+
+// Initialise nbSystems quadtrees of specified height on the area of the generator gen, 
+// each one with nbParticles particles of its own stream: the system s is drawn from the 
+// stream gen->stream + s. The systems are built in parallel
+void initQuadtreeEnsemble(int nbSystems, Quadtree *qts, SpaceFillingCurve curve, int height, 
+						  int nbParticles, Generator *gen)
+{
+	#pragma omp parallel for schedule(dynamic, 1)
+	for (int s = 0; s < nbSystems; s++)
+	{
+		Generator g = *gen;
+		g.stream = gen->stream + s;
+		initQuadtreeGenerator(qts + s, curve, height, nbParticles, &g);
+
+		// built by one thread, the cells are not spread over the team
+		qts[s].placed = 0;
+	}
+}
+
+// Compute the multipoles of nbSystems quadtrees, the systems in parallel
+void computeMultipolesEnsemble(int nbSystems, Quadtree *qts)
+{
+	#pragma omp parallel for schedule(dynamic, 1)
+	for (int s = 0; s < nbSystems; s++)
+		computeMultipoles(qts + s);
+}
+
+// Compute the forces on the particles of nbSystems independent quadtrees in one parallel 
+// region: the cells of all the systems form one work queue, and each thread keeps its 
+// working vectors and lists for all of them. Each system is computed as by computeForces, 
+// on all its cells and with one walk per cell. The multipoles must have been computed
+void computeForcesEnsemble(int nbSystems, Quadtree *qts, double farFieldLimit)
+{
+	// first cell of each system in the queue, and largest lists
+	int *firstCells = (int *) malloc((nbSystems + 1) * sizeof(int));
+	int listsSize = 0;
+	firstCells[0] = 0;
+	for (int s = 0; s < nbSystems; s++)
+	{
+		firstCells[s + 1] = firstCells[s] + qts[s].nbCells;
+		listsSize = (WALK_LISTS_SIZE(qts + s) > listsSize) ? WALK_LISTS_SIZE(qts + s) : listsSize;
+	}
+
+	#pragma omp parallel
+	{
+		WorkingVecs wv;
+		initWorkingVecs(&wv);
+		int *lists = (int *) malloc(listsSize * sizeof(int));
+		int s = 0;
+
+		#pragma omp for schedule(dynamic, 1)
+		for (int i = 0; i < firstCells[nbSystems]; i++)
+		{
+			// the cells of a thread are increasing, as the systems
+			while (i >= firstCells[s + 1])
+				s++;
+			while (i < firstCells[s])
+				s--;
+			int cellNo = i - firstCells[s];
+			walkCell(qts + s, qts[s].cells + cellNo, cellNo, farFieldLimit, lists, &wv);
+		}
+
+		free(lists);
+		freeWorkingVecs(&wv);
+	}
+
+	free(firstCells);
 }
 
 // Compute the gravitationnal force exerted on each particule of the quadtree
@@ -121,55 +669,192 @@ void computeForcesDistributed(Quadtree *qt, double farFieldLimit)
 	MPI_Comm_rank(MPI_COMM_WORLD, &rank);
 	MPI_Comm_size(MPI_COMM_WORLD, &size);
 
+	int firstCell, lastCell;
+	distributedCells(qt, rank, size, &firstCell, &lastCell);
+
+	#pragma omp parallel
+	{
+		WorkingVecs wv;
+		initWorkingVecs(&wv);
+		int *lists = (int *) malloc(WALK_LISTS_SIZE(qt) * sizeof(int));
+
+		#pragma omp for schedule(dynamic, 1)
+		for (int cellNo = firstCell; cellNo < lastCell; cellNo++)
+			walkCell(qt, qt->cells + cellNo, cellNo, farFieldLimit, lists, &wv);
+		
+		free(lists);
+		freeWorkingVecs(&wv);
+	}
+}
+
+// Cells firstCell to lastCell-1 of the node rank among size nodes in computeForcesDistributed:
+// nbCells / size cells per node, the last one keeping the remainder
+void distributedCells(Quadtree *qt, int rank, int size, int *firstCell, int *lastCell)
+{
 	int nbCellsPerNode = qt->nbCells / size;
+	*firstCell = rank * nbCellsPerNode;
+	*lastCell = (rank == size-1) ? qt->nbCells : (rank+1) * nbCellsPerNode;
+}
+
+// Node owning the cell cellNo among size nodes in computeForcesDistributed
+int distributedOwner(Quadtree *qt, int cellNo, int size)
+{
+	int nbCellsPerNode = qt->nbCells / size;
+	int r = (nbCellsPerNode > 0) ? cellNo / nbCellsPerNode : size-1;
+	return (r < size) ? r : size-1;
+}
+
+// Compute the gravitational field (gx, gy) of the particles of the quadtree at nbProbes points 
+// (x, y), i.e. the force exerted on a unit mass, and the potential per unit mass if pot is 
+// not NULL. The probes are sorted along the curve of the cells and grouped by leaf, then each 
+// group is evaluated against the multipoles and the cells like a cell by computeForces.
+// The quadtree is not modified, its multipoles must have been computed
+void computeField(Quadtree *qt, int nbProbes, const double *x, const double *y, 
+				  double *gx, double *gy, double *pot, double farFieldLimit)
+{
+	// Counting sort of the probes by leaf
+	int *first = (int *) malloc((qt->nbCells + 1) * sizeof(int));
+	int *order = (int *) malloc(nbProbes * sizeof(int));
+	sortByLeaf(qt, nbProbes, x, y, first, order);
+
+	// Sorted probes of unit mass
+	double *m = (double *) malloc(6 * nbProbes * sizeof(double));
+	double *px = m + nbProbes, *py = px + nbProbes;
+	double *fx = py + nbProbes, *fy = fx + nbProbes, *p = fy + nbProbes;
+
+	#pragma omp parallel for
+	for (int k = 0; k < nbProbes; k++)
+	{
+		m[k] = 1;
+		px[k] = x[order[k]];
+		py[k] = y[order[k]];
+		fx[k] = fy[k] = p[k] = 0;
+	}
 
 	#pragma omp parallel
 	{
 		WorkingVecs wv;
 		initWorkingVecs(&wv);
+		int *lists = (int *) malloc(WALK_LISTS_SIZE(qt) * sizeof(int));
 
 		#pragma omp for schedule(dynamic, 1)
-		for (int cellNo = rank*nbCellsPerNode; cellNo < (rank+1 * nbCellsPerNode); cellNo++)
+		for (int cellNo = 0; cellNo < qt->nbCells; cellNo++)
 		{
-			int queue[qt->nbMultipoles];
-			int head = 0, tail = 0;
-			queue[tail++] = 0;
+			int o = first[cellNo], n = first[cellNo + 1] - o;
+			if (n == 0)
+				continue;
 
-			int cmNo;
-			double d, l;
-			while (head < tail)
+			// group of the probes of the leaf, bounded by their box
+			Cell group;
+			group.nbParticles = n;
+			group.m = m + o; group.x = px + o; group.y = py + o; 
+			group.fx = fx + o; group.fy = fy + o;
+			group.pot = (pot != NULL) ? p + o : NULL;
+			group.vir[0] = group.vir[1] = group.vir[2] = 0;
+			group.xMin = group.xMax = px[o];
+			group.yMin = group.yMax = py[o];
+			for (int k = o + 1; k < o + n; k++)
 			{
-				cmNo = queue[head++];
-
-				d = distance(qt->multipoles + cmNo, qt->cells + cellNo); 
-				l = qt->multipoles[cmNo].xMax - qt->multipoles[cmNo].xMin;
-
-				if (d > l / farFieldLimit)
-				{
-					M2P(qt->multipoles + cmNo, qt->cells + cellNo, &wv);
-				}
-				else if (cmNo < qt->firstOuterCM)
-				{
-					queue[tail++] = 4*cmNo+1;
-					queue[tail++] = 4*cmNo+2;
-					queue[tail++] = 4*cmNo+3;
-					queue[tail++] = 4*cmNo+4;
-				}
-				else if (cmNo != qt->firstOuterCM + cellNo)
-				{
-					P2P_ext(qt->cells + (cmNo - qt->firstOuterCM), qt->cells + cellNo, &wv);
-				}
+				group.xMin = min(group.xMin, px[k]); group.xMax = max(group.xMax, px[k]);
+				group.yMin = min(group.yMin, py[k]); group.yMax = max(group.yMax, py[k]);
 			}
-			P2P_in(qt->cells + cellNo, &wv);
+
+			walkCell(qt, &group, -1, farFieldLimit, lists, &wv);
 		}
-		
+
+		free(lists);
 		freeWorkingVecs(&wv);
 	}
+
+	#pragma omp parallel for
+	for (int k = 0; k < nbProbes; k++)
+	{
+		gx[order[k]] = fx[k];
+		gy[order[k]] = fy[k];
+		if (pot != NULL)
+			pot[order[k]] = p[k];
+	}
+
+	free(first);
+	free(order);
+	free(m);
+}
+
+// Counting sort of the n points (x, y) by leaf of the quadtree, the points outside the area
+// going to the nearest leaf: the points of the leaf i are order[first[i]] to order[first[i+1]-1],
+// in their initial order. first holds qt->nbCells+1 values
+void sortByLeaf(Quadtree *qt, int n, const double *x, const double *y, int *first, int *order)
+{
+	long dim = 1L << (qt->height - 1);
+	double dX = (qt->xMax - qt->xMin) / (double)dim;
+	double dY = (qt->yMax - qt->yMin) / (double)dim;
+
+	uint32_t *xs = (uint32_t *) malloc(2 * n * sizeof(uint32_t));
+	uint32_t *ys = xs + n;
+	uint64_t *keys = (uint64_t *) malloc(n * sizeof(uint64_t));
+
+	#pragma omp parallel for
+	for (int i = 0; i < n; i++)
+	{
+		double u = floor((x[i] - qt->xMin) / dX), v = floor((y[i] - qt->yMin) / dY);
+		xs[i] = (u < 0) ? 0 : (u >= dim) ? dim - 1 : (uint32_t)u;
+		ys[i] = (v < 0) ? 0 : (v >= dim) ? dim - 1 : (uint32_t)v;
+	}
+
+	if (qt->curve == HILBERT_CURVE)
+		xy_to_hilbert_batch(n, xs, ys, qt->height-1, keys);
+	else
+		xy_to_morton_batch(n, xs, ys, keys);
+
+	int *next = (int *) malloc((qt->nbCells + 1) * sizeof(int));
+	memset(first, 0, (qt->nbCells + 1) * sizeof(int));
+	for (int i = 0; i < n; i++)
+		first[keys[i] + 1]++;
+	for (int cellNo = 0; cellNo < qt->nbCells; cellNo++)
+		first[cellNo + 1] += first[cellNo];
+	memcpy(next, first, (qt->nbCells + 1) * sizeof(int));
+	for (int i = 0; i < n; i++)
+		order[next[keys[i]]++] = i;
+
+	free(xs);
+	free(keys);
+	free(next);
 }
 
 // Private auxiliary functions
 
 
+void allocQuadtree(Quadtree *qt, SpaceFillingCurve curve, int height, 
+				   double xMin, double xMax, double yMin, double yMax)
+{
+	qt->height = height;
+	qt->curve = curve;
+	qt->xMin = xMin;
+	qt->xMax = xMax;
+	qt->yMin = yMin;
+	qt->yMax = yMax;
+	qt->nbCells = powl(4, height-1);
+	qt->cells = (Cell *) malloc(qt->nbCells * sizeof(Cell));
+	qt->nbMultipoles = (powl(4, height) - 1) / 3;
+	qt->multipoles = (Multipole *) malloc(qt->nbMultipoles * sizeof(Multipole));
+	qt->groups = (MultipoleGroup *) aligned_alloc(sizeof(MultipoleGroup), 
+												  (qt->nbMultipoles - qt->nbCells) * sizeof(MultipoleGroup));
+	qt->firstOuterCM = qt->nbMultipoles - qt->nbCells; 
+	qt->counts = (int *) calloc(qt->nbMultipoles, sizeof(int));
+	qt->costCall = COST_CALL;
+	qt->costVisit = COST_VISIT;
+	qt->mac = GEOMETRIC_MAC;
+	qt->macTolerance = 0;
+	qt->pm = NULL;
+	qt->ewald = NULL;
+	qt->nbActiveCells = 0;
+	qt->activeCells = NULL;
+	qt->groupLevels = 0;
+	qt->placed = 0;
+	qt->views = 0;
+	qt->potentialSkipped = 0;
+}
+
 void computeCMrec(Quadtree *qt, int cmNo)
 {
 	if (cmNo < qt->firstOuterCM)
@@ -179,9 +864,312 @@ void computeCMrec(Quadtree *qt, int cmNo)
 		computeCMrec(qt, 4*cmNo+3);
 		computeCMrec(qt, 4*cmNo+4);
 		M2M(qt->multipoles + cmNo, 4, qt->multipoles + 4*cmNo+1);
+		qt->counts[cmNo] = qt->counts[4*cmNo+1] + qt->counts[4*cmNo+2] 
+						 + qt->counts[4*cmNo+3] + qt->counts[4*cmNo+4];
 	}
 	else
 	{
 		P2M(qt->multipoles + cmNo, qt->cells + (cmNo - qt->firstOuterCM));
+		qt->counts[cmNo] = qt->cells[cmNo - qt->firstOuterCM].nbParticles;
 	}
 }
+
+// Apply on the cell c the vertex cmNo, of center (x, y), mass m and width l, if it is in the far 
+// field of c. Otherwise queue it to be opened, or apply the particles of its cell if it is a leaf.
+// TreePM and periodic modes only
+static inline void visitVertex(Quadtree *qt, Cell *c, int selfNo, int cmNo, double x, double y, 
+							   double m, double l, double farFieldLimit, int *queue, int *tail, 
+							   WorkingVecs *wv)
+{
+	TreePM *pm = qt->pm;
+	Ewald *ew = qt->ewald;
+	Multipole mp;
+
+	// the cutoff and the images need the bounding box, from the cold data
+	if (ew != NULL)
+	{
+		periodicImage(ew, qt->multipoles + cmNo, c, &mp);
+		x = mp.x;
+		y = mp.y;
+	}
+	if (pm != NULL && boxDistance((ew != NULL) ? &mp : qt->multipoles + cmNo, c) >= pm->rcut)
+		return;
+
+	if (inFarField(x, y, l, c, farFieldLimit))
+	{
+		if (pm != NULL)
+			M2Pshort(pm, (ew != NULL) ? &mp : qt->multipoles + cmNo, c);
+		else
+			M2Pperiodic(ew, &mp, c);
+	}
+	else if (cmNo < qt->firstOuterCM)
+		queue[(*tail)++] = cmNo;
+	else if (cmNo != qt->firstOuterCM + selfNo)
+	{
+		if (pm != NULL)
+			P2P_extShort(pm, qt->cells + (cmNo - qt->firstOuterCM), c);
+		else
+			P2P_extPeriodic(ew, qt->cells + (cmNo - qt->firstOuterCM), c);
+	}
+}
+
+// Breadth first walk from the root with the operators of the TreePM or periodic modes,
+// which need the bounding boxes of the vertices. queue holds qt->nbMultipoles vertices
+static void walkCellModes(Quadtree *qt, Cell *c, int selfNo, double farFieldLimit, int *queue, WorkingVecs *wv)
+{
+	int head = 0, tail = 0;
+	Multipole *root = qt->multipoles;
+	visitVertex(qt, c, selfNo, 0, root->x, root->y, root->m, macLength(qt, root), 
+				farFieldLimit, queue, &tail, wv);
+
+	while (head < tail)
+	{
+		int parent = queue[head++];
+		MultipoleGroup *g = qt->groups + parent;
+
+		for (int j = 0; j < 4; j++)
+			visitVertex(qt, c, selfNo, 4*parent+1 + j, g->x[j], g->y[j], g->m[j], g->l[j], 
+						farFieldLimit, queue, &tail, wv);
+	}
+}
+
+// Center, mass and width of the vertex cmNo in the traversal layout, the root has no group
+static inline void hotVertex(Quadtree *qt, int cmNo, double *x, double *y, double *m, double *l)
+{
+	if (cmNo == 0)
+	{
+		Multipole *root = qt->multipoles;
+		*x = root->x; *y = root->y; *m = root->m; *l = macLength(qt, root);
+		return;
+	}
+	const MultipoleGroup *g = qt->groups + (cmNo-1) / 4;
+	int j = (cmNo-1) % 4;
+	*x = g->x[j]; *y = g->y[j]; *m = g->m[j]; *l = g->l[j];
+}
+
+// Far field test of the 4 vertices of the group g against the box [xMin, xMax]*[yMin, yMax],
+// in one vector operation
+static inline void farFieldMask(const MultipoleGroup *g, double xMin, double xMax, double yMin, 
+								double yMax, double farFieldLimit, int far[4])
+{
+	#pragma omp simd
+	for (int j = 0; j < 4; j++)
+	{
+		double dx = fmax(0, fmax(xMin - g->x[j], g->x[j] - xMax));
+		double dy = fmax(0, fmax(yMin - g->y[j], g->y[j] - yMax));
+		double r = g->l[j] / farFieldLimit;
+		far[j] = dx*dx + dy*dy > r*r;
+	}
+}
+
+// Near field test of the 4 vertices of the group g against every point of the box [xMin, xMax]*
+// [yMin, yMax], so against every cell within the box, in one vector operation
+static inline void nearFieldMask(const MultipoleGroup *g, double xMin, double xMax, double yMin, 
+								 double yMax, double farFieldLimit, int near[4])
+{
+	#pragma omp simd
+	for (int j = 0; j < 4; j++)
+	{
+		double dx = fmax(xMax - g->x[j], g->x[j] - xMin);
+		double dy = fmax(yMax - g->y[j], g->y[j] - yMin);
+		double r = g->l[j] / farFieldLimit;
+		near[j] = dx*dx + dy*dy <= r*r;
+	}
+}
+
+// Apply on the cell c the vertices of farList by M2P from the traversal data
+static inline void applyFarList(Quadtree *qt, Cell *c, int nbFar, const int *farList, WorkingVecs *wv)
+{
+	for (int i = 0; i < nbFar; i++)
+	{
+		double x, y, m, l;
+		hotVertex(qt, farList[i], &x, &y, &m, &l);
+		if (c->pot != NULL)
+			ponPpot(m, x, y, c->nbParticles, c->m, c->x, c->y, c->fx, c->fy, c->pot, c->vir, wv);
+		else
+			ponP(m, x, y, c->nbParticles, c->m, c->x, c->y, c->fx, c->fy, wv);
+	}
+}
+
+// Apply on the cell c the particles of the cells below the vertices of nearList by P2P,
+// but its own particles
+static inline void applyNearList(Quadtree *qt, Cell *c, int selfNo, int nbNear, const int *nearList, 
+								 WorkingVecs *wv)
+{
+	for (int i = 0; i < nbNear; i++)
+	{
+		int first = nearList[i], last = nearList[i];
+		while (first < qt->firstOuterCM)
+		{
+			first = 4*first+1;
+			last = 4*last+4;
+		}
+		for (int cellNo = first - qt->firstOuterCM; cellNo <= last - qt->firstOuterCM; cellNo++)
+			if (cellNo != selfNo)
+				P2P_ext(qt->cells + cellNo, c, wv);
+	}
+}
+
+// Lists built by the walk of a cell
+typedef struct WalkLists
+{
+	int *queue;                // vertices to open
+	int head;
+	int tail;
+	int *farList;              // vertices applied by M2P
+	int nbFar;
+	int *nearList;             // vertices whose particles are applied by P2P
+	int nbNear;
+} WalkLists;
+
+// Append the vertex cmNo to the list of the cheapest valid option, without branches. 
+// The vertices without particles are dropped
+static inline void chooseOperator(Quadtree *qt, int cmNo, int far, double nt, WalkLists *wl)
+{
+	int p2p = chooseP2P(qt, cmNo, far, nt);
+
+	wl->farList[wl->nbFar] = cmNo;
+	wl->nbFar += far & (!p2p);
+	wl->queue[wl->tail] = cmNo;
+	wl->tail += (!far) & (!p2p);
+	wl->nearList[wl->nbNear] = cmNo;
+	wl->nbNear += p2p & (qt->counts[cmNo] > 0);
+}
+
+// Breadth first walk from the vertices starts building the lists of the vertices in the far 
+// field of c, of the vertices to open, and of the vertices whose particles are applied directly,
+// then applying them. The 4 children of an opened vertex are tested at once from its group, 
+// and appended without branches to their list by chooseOperator. 
+// Compiled for each instruction set
+__attribute__((target_clones("avx2", "default")))
+static void walkCellLists(Quadtree *qt, Cell *c, int selfNo, double farFieldLimit, int nbStarts, 
+						  const int *starts, int *lists, WorkingVecs *wv)
+{
+	WalkLists wl = {lists, 0, 0, lists + qt->nbMultipoles + 4, 0, lists + 2 * (qt->nbMultipoles + 4), 0};
+	double nt = c->nbParticles;
+
+	for (int i = 0; i < nbStarts; i++)
+	{
+		double x, y, m, l;
+		hotVertex(qt, starts[i], &x, &y, &m, &l);
+		chooseOperator(qt, starts[i], inFarField(x, y, l, c, farFieldLimit), nt, &wl);
+	}
+
+	while (wl.head < wl.tail)
+	{
+		int parent = wl.queue[wl.head++];
+		int far[4];
+		farFieldMask(qt->groups + parent, c->xMin, c->xMax, c->yMin, c->yMax, farFieldLimit, far);
+
+		for (int j = 0; j < 4; j++)
+			chooseOperator(qt, 4*parent+1 + j, far[j], nt, &wl);
+	}
+
+	applyFarList(qt, c, wl.nbFar, wl.farList, wv);
+	applyNearList(qt, c, selfNo, wl.nbNear, wl.nearList, wv);
+}
+
+// Apply on the cells below the vertex groupNo the forces of all the particles. The tree is walked
+// once against the box of the group, taking only the decisions of the walk of each of its cells:
+// the vertices in its far field form a list shared by its cells, and the vertices above the level
+// of groupNo in the near field of all its cells are opened, unless P2P is cheaper for one of them.
+// Each cell then walks its own lists from the other vertices only, so that the forces are the
+// ones of one walk per cell, summed in another order.
+// lists is a buffer of GROUP_LISTS_SIZE(qt) vertices
+__attribute__((target_clones("avx2", "default")))
+static void walkGroup(Quadtree *qt, int groupNo, double farFieldLimit, int *lists, WorkingVecs *wv)
+{
+	int *queue = lists, *farList = queue + qt->nbMultipoles + 4, *undecided = farList + qt->nbMultipoles + 4;
+	int *cellLists = lists + WALK_LISTS_SIZE(qt);
+	int head = 0, tail = 0, nbFar = 0, nbUndecided = 0;
+
+	// the cells below the group are contiguous, as the first vertex of its level
+	int firstCell = groupNo, lastCell = groupNo, firstOfLevel = 0;
+	while (firstCell < qt->firstOuterCM)
+	{
+		firstCell = 4*firstCell+1;
+		lastCell = 4*lastCell+4;
+	}
+	firstCell -= qt->firstOuterCM;
+	lastCell -= qt->firstOuterCM;
+	while (4*firstOfLevel+1 <= groupNo)
+		firstOfLevel = 4*firstOfLevel+1;
+
+	// P2P is the cheapest for the fewest target particles, the empty cells walk for nothing
+	Cell box = qt->cells[firstCell];
+	double ntMin = INFINITY;
+	for (int cellNo = firstCell; cellNo <= lastCell; cellNo++)
+	{
+		Cell *c = qt->cells + cellNo;
+		box.xMin = fmin(box.xMin, c->xMin); box.xMax = fmax(box.xMax, c->xMax);
+		box.yMin = fmin(box.yMin, c->yMin); box.yMax = fmax(box.yMax, c->yMax);
+		if (c->nbParticles > 0)
+			ntMin = fmin(ntMin, c->nbParticles);
+	}
+	ntMin = isinf(ntMin) ? 0 : ntMin;
+
+	// M2P is chosen in the far field for more than one particle, whatever the target
+	double x, y, m, l;
+	hotVertex(qt, 0, &x, &y, &m, &l);
+	double dx = fmax(box.xMax - x, x - box.xMin), dy = fmax(box.yMax - y, y - box.yMin);
+	if (inFarField(x, y, l, &box, farFieldLimit) && qt->counts[0] > 1)
+		farList[nbFar++] = 0;
+	else if (firstOfLevel > 0 && dx*dx + dy*dy <= (l / farFieldLimit) * (l / farFieldLimit)
+			 && !chooseP2P(qt, 0, 0, ntMin))
+		queue[tail++] = 0;
+	else if (qt->counts[0] > 0)
+		undecided[nbUndecided++] = 0;
+
+	while (head < tail)
+	{
+		int parent = queue[head++];
+		int first = 4*parent+1;
+		int above = first < firstOfLevel;
+		int far[4], near[4];
+		farFieldMask(qt->groups + parent, box.xMin, box.xMax, box.yMin, box.yMax, farFieldLimit, far);
+		nearFieldMask(qt->groups + parent, box.xMin, box.xMax, box.yMin, box.yMax, farFieldLimit, near);
+
+		for (int j = 0; j < 4; j++)
+		{
+			int child = first + j, ns = qt->counts[child];
+			int open = near[j] & above & (!chooseP2P(qt, child, 0, ntMin));
+			farList[nbFar] = child;
+			nbFar += far[j] & (ns > 1);
+			queue[tail] = child;
+			tail += open & (ns > 0);
+			undecided[nbUndecided] = child;
+			nbUndecided += (ns > 0) & ((far[j] & (ns == 1)) | ((!far[j]) & (!open)));
+		}
+	}
+
+	for (int cellNo = firstCell; cellNo <= lastCell; cellNo++)
+	{
+		Cell *c = qt->cells + cellNo;
+		applyFarList(qt, c, nbFar, farList, wv);
+		walkCellLists(qt, c, cellNo, farFieldLimit, nbUndecided, undecided, cellLists, wv);
+		P2P_in(c, wv);
+	}
+}
+
+// Breadth first walk from the root: the multipoles far enough from the cell are applied, 
+// the others are opened down to the cells of the near field, by lists in the default mode.
+// With a TreePM solver, only the short-range forces are applied, and the vertices beyond 
+// its cutoff are skipped. With periodic boundaries, each vertex is seen at its image
+// nearest to the cell, and the periodic operators add the Ewald correction
+void walkCell(Quadtree *qt, Cell *c, int selfNo, double farFieldLimit, int *lists, WorkingVecs *wv)
+{
+	int root = 0;
+	if (qt->pm != NULL || qt->ewald != NULL)
+		walkCellModes(qt, c, selfNo, farFieldLimit, lists, wv);
+	else
+		walkCellLists(qt, c, selfNo, farFieldLimit, 1, &root, lists, wv);
+
+	if (selfNo < 0)
+		return;
+	if (qt->pm != NULL)
+		P2P_inShort(qt->pm, c);
+	else if (qt->ewald != NULL)
+		P2P_inPeriodic(qt->ewald, c);
+	else
+		P2P_in(c, wv);
+}
@@ -4,6 +4,37 @@
 #include "Multipole.h"
 #include "Cell.h"
 
+// Space filling curve numbering the cells of a quadtree
+typedef enum SpaceFillingCurve
+{
+	MORTON_CURVE,
+	HILBERT_CURVE
+} SpaceFillingCurve;
+
+// Default cost model of the walk, in interactions (see tuning)
+#define COST_CALL 12.0
+#define COST_VISIT 16.0
+
+// Multipole acceptance criterion of the walk: a vertex is in the far field of a cell
+// if d > l / farFieldLimit, where d is the distance between its center of mass and the cell,
+// and l depends on the criterion:
+// - GEOMETRIC_MAC: l is the width of the area approximated by the vertex
+// - BMAX_MAC: l is the distance from its center of mass to the farthest corner of the area
+//   (Salmon-Warren), the criterion accepts more vertices whose center of mass is central
+// - ERROR_MAC: l is the distance beyond which the bound of the error of the monopole on the
+//   acceleration, 3 G m bMax² / (d² (d - bMax)²), is below macTolerance (m.s^-2), it
+//   accepts more light vertices. farFieldLimit is then a safety factor, 1 by default
+typedef enum MultipoleAcceptance
+{
+	GEOMETRIC_MAC,
+	BMAX_MAC,
+	ERROR_MAC
+} MultipoleAcceptance;
+
+struct TreePM;
+struct Generator;
+struct Ewald;
+
 // Perfect complete 4-ary tree
 // Below each leaf is stored a Cell, square subdivision of space containing particles.
 // Each leaf is the center of mass of the particles contained in the corresponding Cell.
@@ -12,6 +43,7 @@ struct Quadtree
 {
 	// properties of the quadtree
 	int height;
+	SpaceFillingCurve curve;
 	double xMin;
 	double xMax;
 	double yMin;
@@ -25,8 +57,53 @@ struct Quadtree
 	int nbMultipoles;
 	Multipole *multipoles;
 
+	// traversal layout of the multipoles: groups[i] holds the 4 children of the inner vertex i,
+	// i.e. the vertices 4i+1 to 4i+4, so the groups of a level are contiguous.
+	// Their lengths l are the ones of the MAC
+	MultipoleGroup *groups;
+
+	// MAC of the walk, GEOMETRIC_MAC by default. The multipoles must be computed after 
+	// changing it, see MultipoleAcceptance
+	MultipoleAcceptance mac;
+	double macTolerance;
+
 	// Index of the first outer vertex of the tree : nbCMS - nbCells
 	int firstOuterCM;  
+
+	// number of particles below each vertex, set by computeMultipoles
+	int *counts;
+
+	// Cost model of the walk of computeForces, in interactions of the kernels: cost of a kernel
+	// call besides its interactions, and of the visit of a vertex. For each vertex, the walk picks
+	// the cheapest valid option of M2P, P2P with the particles below it, or opening it.
+	// Set to COST_CALL and COST_VISIT by initQuadtree, calibrated by tuning
+	double costCall;
+	double costVisit;
+
+	// When set, computeForces only computes the short-range forces (see TreePM.h)
+	struct TreePM *pm;
+
+	// When set, computeForces computes the forces with periodic boundaries (see Ewald.h)
+	struct Ewald *ewald;
+
+	// When set, computeForces only computes the forces on these cells (see Timesteps.h)
+	int nbActiveCells;
+	int *activeCells;
+
+	// When positive, computeForces walks the tree once per vertex groupLevels levels above
+	// the leaves, for all the cells below it, then refines the walk per cell only from the 
+	// vertices of that level it could not accept. 0 by default, one walk per cell
+	int groupLevels;
+
+	// Set once the cells are placed on the threads owning them, see placeQuadtree
+	int placed;
+
+	// Set when the cells are views on the arrays of the caller, see initQuadtreeArrays
+	int views;
+
+	// Set by computeForces when its last pass did not compute the potential and virial,
+	// in TreePM and periodic modes
+	int potentialSkipped;
 }
 typedef Quadtree;
 
@@ -36,23 +113,122 @@ typedef Quadtree;
 extern void initQuadtree(Quadtree *qt, int height, int nbPartMin, int nbPartMax, 
 						 double mMin, double mMax, double xMin, double xMax, double yMin, double yMax);
 
+// Same as initQuadtree, but the cells are numbered along the specified curve.
+// A contiguous range of cells is a more compact area with HILBERT_CURVE
+extern void initQuadtreeCurve(Quadtree *qt, SpaceFillingCurve curve, int height, int nbPartMin, 
+							  int nbPartMax, double mMin, double mMax, double xMin, double xMax, 
+							  double yMin, double yMax);
+
+// Initialise a quadtree of specified height on the area of the generator gen, with its 
+// particles 0 to nbParticles-1 sorted by cell. The particles are generated in parallel,
+// and the cells are placed as by placeQuadtree
+extern void initQuadtreeGenerator(Quadtree *qt, SpaceFillingCurve curve, int height, int nbParticles,
+								  struct Generator *gen);
+
+// Counting sort of the n points (x, y) by leaf of the quadtree, the points outside the area
+// going to the nearest leaf: the points of the leaf i are order[first[i]] to order[first[i+1]-1],
+// in their initial order. first holds qt->nbCells+1 values
+extern void sortByLeaf(Quadtree *qt, int n, const double *x, const double *y, int *first, int *order);
+
+// Sort in place the nbParticles particles (m, x, y) by cell of a quadtree of specified curve and 
+// height on the area [xMin, xMax]*[yMin, yMax], as expected by initQuadtreeArrays. If order is not 
+// NULL, it receives the initial index of each particle, to sort the other arrays of the caller
+extern void sortParticles(SpaceFillingCurve curve, int height, double xMin, double xMax, double yMin, 
+						  double yMax, int nbParticles, double *m, double *x, double *y, int *order);
+
+// Initialise a quadtree of specified height on the area [xMin, xMax]*[yMin, yMax], on the arrays 
+// of nbParticles particles (m, x, y) of the caller, sorted by cell, without copying them: each cell 
+// is a view on its range of the arrays, and computeForces adds the forces to fx and fy.
+// The arrays stay owned by the caller, and must outlive the quadtree.
+// Returns 0, or -1 if the particles are not sorted by cell
+extern int initQuadtreeArrays(Quadtree *qt, SpaceFillingCurve curve, int height, int nbParticles, 
+							  double *m, double *x, double *y, double *fx, double *fy, 
+							  double xMin, double xMax, double yMin, double yMax);
+
+// Returns the number of the cell at (dx, dy) cells of the cell cellNo, -1 if out of the grid
+extern int quadtreeNeighbour(Quadtree *qt, int cellNo, int dx, int dy);
+
 // Release the ressources associated with the specified quadtree
 extern void freeQuadtree(Quadtree *qt);
 
+// Move the particles of each cell to the memory of the thread owning it, i.e. of its NUMA node:
+// each thread owns a contiguous range of cells along the curve, and copies them first.
+// computeForces then starts each thread on its own cells, and shares the last ones.
+// Call it from the team of threads of computeForces, bound to their cores (see README.md).
+// The cells of initQuadtreeArrays are not moved
+extern void placeQuadtree(Quadtree *qt);
+
+// Enable the computation of the potential energy and virial of the particles of the quadtree
+// in the same pass as the forces by computeForces, and reset them
+extern void initQuadtreePotential(Quadtree *qt);
+
+// Total potential energy and virial (xx, xy, yy) of the particles of the quadtree, 
+// accumulated by computeForces after initQuadtreePotential. Returns 0, or -1 with errno set
+// to EINVAL if the last forces were computed in TreePM or periodic mode, without them
+extern int computeEnergy(Quadtree *qt, double *potential, double *virial);
+
 // Compute all the centers of mass of the specified quadtree recursively, 
 // starting by the lower level ones
 extern void computeMultipoles(Quadtree *qt);
 
+// Copy the multipole cmNo to the traversal layout, after modifying it outside of computeMultipoles
+extern void syncMultipole(Quadtree *qt, int cmNo);
+
+// Mark the cells in the near field of the cell cellNo, itself included, i.e. the cells
+// whose particles computeForces applies on it by P2P: marks[i] is set to 1 for each of them.
+// queue holds qt->nbMultipoles vertices
+extern void markNearField(Quadtree *qt, int cellNo, double farFieldLimit, int *queue, char *marks);
+
+// Same as markNearField, and the cells it marks that were not marked yet are appended to list
+// if it is not NULL, which holds qt->nbCells cells. Returns their number. 
+// Not thread safe with a list
+extern int listNearField(Quadtree *qt, int cellNo, double farFieldLimit, int *queue, char *marks, int *list);
+
 // Compute the gravitationnal force exerted on each particule of the quadtree
 // Note: we consider that a center of mass is in the far field of a cell
 // if d/l > farFieldLimit    where d is the distance between the cm and the cell
-// and w is the width of the area approximated by the cm
+// and w is the width of the area approximated by the cm, or the length of qt->mac
 extern void computeForces(Quadtree *qt, double farFieldLimit);
 
+// Ensemble mode, for sweeps over many independent small systems: the calls below handle 
+// nbSystems quadtrees at once, sharing one parallel region and the buffers of its threads.
+//
+// Initialise nbSystems quadtrees of specified height on the area of the generator gen, 
+// each one with nbParticles particles of its own stream: the system s is drawn from the 
+// stream gen->stream + s. The systems are built in parallel
+extern void initQuadtreeEnsemble(int nbSystems, Quadtree *qts, SpaceFillingCurve curve, int height, 
+								 int nbParticles, struct Generator *gen);
+
+// Compute the multipoles of nbSystems quadtrees, the systems in parallel
+extern void computeMultipolesEnsemble(int nbSystems, Quadtree *qts);
+
+// Compute the forces on the particles of nbSystems independent quadtrees in one parallel 
+// region: the cells of all the systems form one work queue, and each thread keeps its 
+// working vectors and lists for all of them. Each system is computed as by computeForces, 
+// on all its cells and with one walk per cell. The multipoles must have been computed
+extern void computeForcesEnsemble(int nbSystems, Quadtree *qts, double farFieldLimit);
+
 // Compute the gravitationnal force exerted on each particule of the quadtree
 // Note: we consider that a center of mass is in the far field of a cell
 // if d/l > farFieldLimit    where d is the distance between the cm and the cell
 // and w is the width of the area approximated by the cm
 extern void computeForcesDistributed(Quadtree *qt, double farFieldLimit);
 
+// Cells firstCell to lastCell-1 of the node rank among size nodes in computeForcesDistributed:
+// nbCells / size cells per node, the last one keeping the remainder
+extern void distributedCells(Quadtree *qt, int rank, int size, int *firstCell, int *lastCell);
+
+// Node owning the cell cellNo among size nodes in computeForcesDistributed
+extern int distributedOwner(Quadtree *qt, int cellNo, int size);
+
+// Compute the gravitational field (gx, gy) of the particles of the quadtree at nbProbes points 
+// (x, y), i.e. the force exerted on a unit mass, and the potential per unit mass if pot is 
+// not NULL. The probes are sorted along the curve of the cells and grouped by leaf, then each 
+// group is evaluated against the multipoles and the cells like a cell by computeForces.
+// The quadtree is not modified, its multipoles must have been computed
+//
+// Note: the field is infinite at the position of a particle
+extern void computeField(Quadtree *qt, int nbProbes, const double *x, const double *y, 
+						 double *gx, double *gy, double *pot, double farFieldLimit);
+
 #endif 
\ No newline at end of file
@@ -0,0 +1,370 @@
+#define _DEFAULT_SOURCE
+
+#include "Service.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <malloc.h>
+#include <omp.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#define MAX_HEIGHT 14          // 4^13 cells
+
+// Private
+
+static inline size_t segmentSize(int capacity)
+{
+	return sizeof(ServiceSegment) + 5 * (size_t)capacity * sizeof(double);
+}
+
+// Array k of a segment of capacity particles. The service only trusts its own capacity, the
+// one of the segment being written by the clients
+static inline double *segmentArray(ServiceSegment *seg, int capacity, int k)
+{
+	return seg->data + (size_t)k * capacity;
+}
+
+// Read or write size bytes on the socket fd, until done. Returns 0, or -1 when the
+// connection is closed or fails
+static int readAll(int fd, void *buf, size_t size)
+{
+	for (size_t done = 0; done < size; )
+	{
+		ssize_t r = read(fd, (char *)buf + done, size - done);
+		if (r < 0 && errno == EINTR)
+			continue;
+		if (r <= 0)
+			return -1;
+		done += r;
+	}
+	return 0;
+}
+
+static int writeAll(int fd, const void *buf, size_t size)
+{
+	for (size_t done = 0; done < size; )
+	{
+		ssize_t r = write(fd, (const char *)buf + done, size - done);
+		if (r < 0 && errno == EINTR)
+			continue;
+		if (r <= 0)
+			return -1;
+		done += r;
+	}
+	return 0;
+}
+
+static int sameGeometry(Quadtree *qt, ServiceRequest *rq)
+{
+	return qt->curve == rq->curve && qt->height == rq->height && qt->xMin == rq->xMin
+		&& qt->xMax == rq->xMax && qt->yMin == rq->yMin && qt->yMax == rq->yMax;
+}
+
+// Build the empty quadtree of the request, the arrays of its cells grow with the particles
+static void buildQuadtree(Service *sv, ServiceRequest *rq)
+{
+	if (sv->built)
+	{
+		freeQuadtree(&sv->qt);
+		free(sv->capacities);
+		free(sv->first);
+	}
+
+	initQuadtreeCurve(&sv->qt, rq->curve, rq->height, 0, 0, 0, 0, rq->xMin, rq->xMax, rq->yMin, rq->yMax);
+	sv->capacities = (int *) calloc(sv->qt.nbCells, sizeof(int));
+	sv->first = (int *) malloc((sv->qt.nbCells + 1) * sizeof(int));
+	sv->built = 1;
+}
+
+// Sort the particles of the segment into the cells of the quadtree, compute their forces,
+// and write them back in the segment
+static int computeRequest(Service *sv, ServiceRequest *rq)
+{
+	ServiceSegment *seg = sv->segment;
+	if (rq->nbParticles < 0 || rq->nbParticles > sv->capacity || rq->height < 1
+		|| rq->height > MAX_HEIGHT || !(rq->xMin < rq->xMax) || !(rq->yMin < rq->yMax))
+		return -1;
+
+	if (!sv->built || !sameGeometry(&sv->qt, rq))
+		buildQuadtree(sv, rq);
+
+	Quadtree *qt = &sv->qt;
+	double *m = segmentArray(seg, sv->capacity, 0), *x = segmentArray(seg, sv->capacity, 1);
+	double *y = segmentArray(seg, sv->capacity, 2), *fx = segmentArray(seg, sv->capacity, 3);
+	double *fy = segmentArray(seg, sv->capacity, 4);
+	sortByLeaf(qt, rq->nbParticles, x, y, sv->first, sv->order);
+
+	#pragma omp parallel for schedule(dynamic, 16)
+	for (int cellNo = 0; cellNo < qt->nbCells; cellNo++)
+	{
+		Cell *c = qt->cells + cellNo;
+		int o = sv->first[cellNo], n = sv->first[cellNo + 1] - o;
+
+		// the arrays of a cell are only reallocated to grow, with a margin
+		if (n > sv->capacities[cellNo])
+		{
+			free(c->m);
+			sv->capacities[cellNo] = n + n / 2;
+			c->m = (double *) malloc(5 * sv->capacities[cellNo] * sizeof(double));
+		}
+		int capacity = sv->capacities[cellNo];
+		c->x = c->m + capacity;
+		c->y = c->x + capacity;
+		c->fx = c->y + capacity;
+		c->fy = c->fx + capacity;
+		c->nbParticles = n;
+
+		for (int k = 0; k < n; k++)
+		{
+			int i = sv->order[o + k];
+			c->m[k] = m[i];
+			c->x[k] = x[i];
+			c->y[k] = y[i];
+			c->fx[k] = c->fy[k] = 0;
+		}
+	}
+
+	computeMultipoles(qt);
+	computeForces(qt, rq->farFieldLimit);
+
+	#pragma omp parallel for schedule(dynamic, 16)
+	for (int cellNo = 0; cellNo < qt->nbCells; cellNo++)
+	{
+		Cell *c = qt->cells + cellNo;
+		int o = sv->first[cellNo];
+		for (int k = 0; k < c->nbParticles; k++)
+		{
+			fx[sv->order[o + k]] = c->fx[k];
+			fy[sv->order[o + k]] = c->fy[k];
+		}
+	}
+
+	sv->nbRequests++;
+	return 0;
+}
+
+// Serve the requests of one client until it disconnects. Returns 1 after a SERVICE_STOP request
+static int serveClient(Service *sv, int fd)
+{
+	ServiceRequest rq;
+	while (readAll(fd, &rq, sizeof(rq)) == 0)
+	{
+		double start = omp_get_wtime();
+		ServiceReply reply;
+		reply.status = (rq.operation == SERVICE_FORCES) ? computeRequest(sv, &rq)
+					 : (rq.operation == SERVICE_STOP) ? 0 : -1;
+		reply.seconds = omp_get_wtime() - start;
+
+		if (writeAll(fd, &reply, sizeof(reply)) < 0 || rq.operation == SERVICE_STOP)
+			return rq.operation == SERVICE_STOP;
+	}
+	return 0;
+}
+
+static ServiceReply sendRequest(ServiceClient *cl, ServiceRequest *rq)
+{
+	ServiceReply reply = {-1, 0};
+	if (writeAll(cl->socket, rq, sizeof(*rq)) < 0 || readAll(cl->socket, &reply, sizeof(reply)) < 0)
+		reply.status = -1;
+	return reply;
+}
+
+// Public
+
+// Create the shared segment segmentName of capacity particles and listen on the Unix domain
+// socket socketPath. Returns 0, or -1 with errno set
+int initService(Service *sv, const char *socketPath, const char *segmentName, int capacity)
+{
+	struct sockaddr_un addr;
+	if (strlen(socketPath) >= sizeof(addr.sun_path) || strlen(socketPath) >= sizeof(sv->socketPath)
+		|| strlen(segmentName) >= sizeof(sv->segmentName))
+	{
+		errno = ENAMETOOLONG;
+		return -1;
+	}
+	if (capacity <= 0)
+	{
+		errno = EINVAL;
+		return -1;
+	}
+	strcpy(sv->socketPath, socketPath);
+	strcpy(sv->segmentName, segmentName);
+	sv->built = 0;
+	sv->nbRequests = 0;
+	sv->socket = -1;
+	sv->segment = NULL;
+	sv->order = NULL;
+	sv->capacity = capacity;
+
+	sv->segmentSize = segmentSize(capacity);
+	int fd = shm_open(segmentName, O_CREAT | O_RDWR | O_TRUNC, 0600);
+	if (fd < 0)
+		return -1;
+	if (ftruncate(fd, sv->segmentSize) < 0)
+	{
+		close(fd);
+		shm_unlink(segmentName);
+		return -1;
+	}
+	void *p = mmap(NULL, sv->segmentSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (p == MAP_FAILED)
+	{
+		shm_unlink(segmentName);
+		return -1;
+	}
+	sv->segment = (ServiceSegment *) p;
+	sv->segment->capacity = capacity;
+	sv->order = (int *) malloc(capacity * sizeof(int));
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strcpy(addr.sun_path, socketPath);
+	unlink(socketPath);
+	sv->socket = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (sv->socket < 0 || bind(sv->socket, (struct sockaddr *)&addr, sizeof(addr)) < 0
+		|| listen(sv->socket, 4) < 0)
+	{
+		int e = errno;
+		freeService(sv);
+		errno = e;
+		return -1;
+	}
+	return 0;
+}
+
+// Serve the requests of the clients, one client after the other, until a SERVICE_STOP request.
+// Returns 0, or -1 with errno set if the socket fails
+int runService(Service *sv)
+{
+	for (int stop = 0; !stop; )
+	{
+		int fd = accept(sv->socket, NULL, NULL);
+		if (fd < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			return -1;
+		}
+		stop = serveClient(sv, fd);
+		close(fd);
+	}
+	return 0;
+}
+
+// Release the ressources associated with the service, its socket and segment are removed
+void freeService(Service *sv)
+{
+	if (sv->built)
+	{
+		freeQuadtree(&sv->qt);
+		free(sv->capacities);
+		free(sv->first);
+		sv->built = 0;
+	}
+	free(sv->order);
+	sv->order = NULL;
+
+	if (sv->segment != NULL)
+	{
+		munmap(sv->segment, sv->segmentSize);
+		shm_unlink(sv->segmentName);
+		sv->segment = NULL;
+	}
+	if (sv->socket >= 0)
+	{
+		close(sv->socket);
+		unlink(sv->socketPath);
+		sv->socket = -1;
+	}
+}
+
+// Connect to the service listening on socketPath and map its segment segmentName.
+// Returns 0, or -1 with errno set
+int openServiceClient(ServiceClient *cl, const char *socketPath, const char *segmentName)
+{
+	struct sockaddr_un addr;
+	if (strlen(socketPath) >= sizeof(addr.sun_path))
+	{
+		errno = ENAMETOOLONG;
+		return -1;
+	}
+
+	int fd = shm_open(segmentName, O_RDWR, 0600);
+	if (fd < 0)
+		return -1;
+	int capacity;
+	if (pread(fd, &capacity, sizeof(int), offsetof(ServiceSegment, capacity)) != sizeof(int) || capacity <= 0)
+	{
+		close(fd);
+		errno = EINVAL;
+		return -1;
+	}
+	cl->segmentSize = segmentSize(capacity);
+	void *p = mmap(NULL, cl->segmentSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (p == MAP_FAILED)
+		return -1;
+
+	cl->segment = (ServiceSegment *) p;
+	cl->capacity = capacity;
+	cl->m = segmentArray(cl->segment, capacity, 0);
+	cl->x = segmentArray(cl->segment, capacity, 1);
+	cl->y = segmentArray(cl->segment, capacity, 2);
+	cl->fx = segmentArray(cl->segment, capacity, 3);
+	cl->fy = segmentArray(cl->segment, capacity, 4);
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strcpy(addr.sun_path, socketPath);
+	cl->socket = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (cl->socket < 0 || connect(cl->socket, (struct sockaddr *)&addr, sizeof(addr)) < 0)
+	{
+		int e = errno;
+		closeServiceClient(cl);
+		errno = e;
+		return -1;
+	}
+	return 0;
+}
+
+// Compute the forces (fx, fy) on the particles 0 to nbParticles-1 of the segment, in a quadtree
+// of specified curve and height on the area [xMin, xMax]*[yMin, yMax].
+// Returns the reply of the service, of status -1 if the connection fails
+ServiceReply requestForces(ServiceClient *cl, int nbParticles, SpaceFillingCurve curve, int height,
+						   double xMin, double xMax, double yMin, double yMax, double farFieldLimit)
+{
+	ServiceRequest rq;
+	memset(&rq, 0, sizeof(rq));
+	rq.operation = SERVICE_FORCES;
+	rq.nbParticles = nbParticles;
+	rq.curve = curve;
+	rq.height = height;
+	rq.xMin = xMin; rq.xMax = xMax;
+	rq.yMin = yMin; rq.yMax = yMax;
+	rq.farFieldLimit = farFieldLimit;
+	return sendRequest(cl, &rq);
+}
+
+// Stop the service. Returns 0, or -1 if the connection fails
+int stopService(ServiceClient *cl)
+{
+	ServiceRequest rq;
+	memset(&rq, 0, sizeof(rq));
+	rq.operation = SERVICE_STOP;
+	return sendRequest(cl, &rq).status;
+}
+
+// Disconnect from the service and unmap its segment
+void closeServiceClient(ServiceClient *cl)
+{
+	if (cl->socket >= 0)
+		close(cl->socket);
+	munmap(cl->segment, cl->segmentSize);
+	cl->socket = -1;
+	cl->segment = NULL;
+}
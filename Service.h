@@ -0,0 +1,112 @@
+#ifndef SERVICE_H
+#define SERVICE_H
+
+#include <stddef.h>
+
+#include "Quadtree.h"
+
+// Resident solver service, to amortize the startup and the allocations of the solver over
+// many jobs: a service process keeps its quadtree, the arrays of its cells and its OpenMP
+// threads from one request to the next. The particles are exchanged through a POSIX shared
+// memory segment, and the requests through a Unix domain socket:
+// - the client writes its particles (m, x, y) in the segment, then sends a request
+// - the service sorts them by cell into its quadtree, whose arrays only grow, computes
+//   the forces and writes them in (fx, fy) in the segment, in the order of the client
+// - the reply returns once the forces are in the segment
+// The quadtree is only rebuilt when the height, the curve or the area of a request change.
+// The service handles one client at a time, each one sending any number of requests.
+
+// Shared segment: capacity particles, each array holding capacity values. The capacity is
+// written by the service for its clients, which may overwrite it
+typedef struct ServiceSegment
+{
+	int capacity;
+	double data[];             // m, x, y, fx, fy
+} ServiceSegment;
+
+typedef enum ServiceOperation
+{
+	SERVICE_FORCES,            // compute the forces on the particles of the segment
+	SERVICE_STOP               // stop the service after the reply
+} ServiceOperation;
+
+typedef struct ServiceRequest
+{
+	ServiceOperation operation;
+	int nbParticles;           // particles 0 to nbParticles-1 of the segment
+	SpaceFillingCurve curve;
+	int height;                // of the quadtree, on the area [xMin, xMax]*[yMin, yMax]
+	double xMin;
+	double xMax;
+	double yMin;
+	double yMax;
+	double farFieldLimit;
+} ServiceRequest;
+
+typedef struct ServiceReply
+{
+	int status;                // 0, or -1 for an invalid request
+	double seconds;            // time spent by the service on the request
+} ServiceReply;
+
+typedef struct Service
+{
+	int socket;
+	char socketPath[108];
+	char segmentName[256];
+	int capacity;              // of the segment, as created
+	size_t segmentSize;
+	ServiceSegment *segment;
+
+	// resident solver, built by the first request
+	int built;
+	Quadtree qt;
+	int *capacities;           // number of particles the arrays of each cell hold
+	int *first;                // particles of each cell, see sortByLeaf
+	int *order;
+	long nbRequests;
+} Service;
+
+typedef struct ServiceClient
+{
+	int socket;
+	size_t segmentSize;
+	ServiceSegment *segment;
+
+	// arrays of the segment: the client writes m, x and y, the service fx and fy
+	int capacity;
+	double *m;
+	double *x;
+	double *y;
+	double *fx;
+	double *fy;
+} ServiceClient;
+
+// Create the shared segment segmentName of capacity particles and listen on the Unix domain
+// socket socketPath. Returns 0, or -1 with errno set
+extern int initService(Service *sv, const char *socketPath, const char *segmentName, int capacity);
+
+// Serve the requests of the clients, one client after the other, until a SERVICE_STOP request.
+// Returns 0, or -1 with errno set if the socket fails
+extern int runService(Service *sv);
+
+// Release the ressources associated with the service, its socket and segment are removed
+extern void freeService(Service *sv);
+
+// Connect to the service listening on socketPath and map its segment segmentName.
+// Returns 0, or -1 with errno set
+extern int openServiceClient(ServiceClient *cl, const char *socketPath, const char *segmentName);
+
+// Compute the forces (fx, fy) on the particles 0 to nbParticles-1 of the segment, in a quadtree
+// of specified curve and height on the area [xMin, xMax]*[yMin, yMax].
+// Returns the reply of the service, of status -1 if the connection fails
+extern ServiceReply requestForces(ServiceClient *cl, int nbParticles, SpaceFillingCurve curve, int height,
+								  double xMin, double xMax, double yMin, double yMax, double farFieldLimit);
+
+// Stop the service. Returns 0, or -1 if the connection fails
+extern int stopService(ServiceClient *cl);
+
+// Disconnect from the service and unmap its segment
+extern void closeServiceClient(ServiceClient *cl);
+
+#endif
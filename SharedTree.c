@@ -0,0 +1,221 @@
+#include "SharedTree.h"
+
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Alignment of the arrays in the window, the groups being loaded by SIMD instructions
+#define WINDOW_ALIGNMENT 64
+
+// Properties of the quadtree of the leader, broadcast to the ranks of its node
+typedef struct SharedHeader
+{
+	int height;
+	int curve;
+	int mac;
+	int groupLevels;
+	double xMin;
+	double xMax;
+	double yMin;
+	double yMax;
+	double macTolerance;
+	double costCall;
+	double costVisit;
+	long nbParticles;
+} SharedHeader;
+
+// Private
+
+static inline long alignOffset(long offset)
+{
+	return (offset + WINDOW_ALIGNMENT - 1) & ~(long)(WINDOW_ALIGNMENT - 1);
+}
+
+// Make the writes of the ranks of the node to the window visible to all of them
+static void nodeSync(SharedQuadtree *sq)
+{
+	MPI_Win_sync(sq->win);
+	MPI_Barrier(sq->nodeComm);
+	MPI_Win_sync(sq->win);
+}
+
+// Public
+
+// Move the quadtree qt built by the leader of each node to a window shared by the ranks of
+// the node, the other ranks getting a view on it in qt. The leader releases its own copy.
+// The nodes are the ones of nodeComm, which must share memory, or of MPI_COMM_TYPE_SHARED if
+// it is MPI_COMM_NULL. Collective over MPI_COMM_WORLD. Release it with freeSharedQuadtree
+void shareQuadtree(Quadtree *qt, SharedQuadtree *sq, MPI_Comm nodeComm)
+{
+	int nodeRank;
+	if (nodeComm == MPI_COMM_NULL)
+		MPI_Comm_split_type(MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, 0, MPI_INFO_NULL, &sq->nodeComm);
+	else
+		MPI_Comm_dup(nodeComm, &sq->nodeComm);
+	MPI_Comm_rank(sq->nodeComm, &nodeRank);
+	MPI_Comm_split(MPI_COMM_WORLD, (nodeRank == 0) ? 0 : MPI_UNDEFINED, 0, &sq->leadersComm);
+
+	SharedHeader h;
+	if (nodeRank == 0)
+	{
+		h = (SharedHeader) {qt->height, qt->curve, qt->mac, qt->groupLevels, qt->xMin, qt->xMax,
+							qt->yMin, qt->yMax, qt->macTolerance, qt->costCall, qt->costVisit, 0};
+		for (int i = 0; i < qt->nbCells; i++)
+			h.nbParticles += qt->cells[i].nbParticles;
+	}
+	MPI_Bcast(&h, sizeof(h), MPI_BYTE, 0, sq->nodeComm);
+
+	if (nodeRank != 0)
+	{
+		qt->height = h.height;
+		qt->curve = h.curve;
+		qt->xMin = h.xMin;
+		qt->xMax = h.xMax;
+		qt->yMin = h.yMin;
+		qt->yMax = h.yMax;
+		qt->nbCells = 1 << (2 * (h.height-1));
+		qt->cells = (Cell *) malloc(qt->nbCells * sizeof(Cell));
+		qt->nbMultipoles = (4 * qt->nbCells - 1) / 3;
+		qt->firstOuterCM = qt->nbMultipoles - qt->nbCells;
+		qt->mac = h.mac;
+		qt->macTolerance = h.macTolerance;
+		qt->costCall = h.costCall;
+		qt->costVisit = h.costVisit;
+		qt->pm = NULL;
+		qt->ewald = NULL;
+		qt->nbActiveCells = 0;
+		qt->activeCells = NULL;
+		qt->groupLevels = h.groupLevels;
+		qt->potentialSkipped = 0;
+	}
+	qt->placed = 0;
+	qt->views = 1;
+
+	// boundaries and number of particles of the cells
+	double *bounds = (double *) malloc(4 * qt->nbCells * sizeof(double));
+	int *nbParticles = (int *) malloc(qt->nbCells * sizeof(int));
+	if (nodeRank == 0)
+		for (int i = 0; i < qt->nbCells; i++)
+		{
+			Cell *c = qt->cells + i;
+			bounds[4*i] = c->xMin; bounds[4*i+1] = c->xMax; bounds[4*i+2] = c->yMin; bounds[4*i+3] = c->yMax;
+			nbParticles[i] = c->nbParticles;
+		}
+	MPI_Bcast(bounds, 4 * qt->nbCells, MPI_DOUBLE, 0, sq->nodeComm);
+	MPI_Bcast(nbParticles, qt->nbCells, MPI_INT, 0, sq->nodeComm);
+
+	// layout of the window: groups, multipoles, counts, then m, x, y, fx, fy of all the particles
+	long nbGroups = qt->nbMultipoles - qt->nbCells;
+	long multipolesOffset = alignOffset(nbGroups * sizeof(MultipoleGroup));
+	long countsOffset = alignOffset(multipolesOffset + qt->nbMultipoles * sizeof(Multipole));
+	long particlesOffset = alignOffset(countsOffset + qt->nbMultipoles * sizeof(int));
+	sq->windowSize = particlesOffset + 5 * h.nbParticles * sizeof(double);
+	sq->nbParticles = h.nbParticles;
+
+	char *base;
+	MPI_Aint size;
+	int dispUnit;
+	MPI_Win_allocate_shared((nodeRank == 0) ? sq->windowSize : 0, 1, MPI_INFO_NULL, sq->nodeComm,
+							&base, &sq->win);
+	MPI_Win_shared_query(sq->win, 0, &size, &dispUnit, &base);
+	MPI_Win_lock_all(MPI_MODE_NOCHECK, sq->win);
+
+	MultipoleGroup *groups = (MultipoleGroup *) base;
+	Multipole *multipoles = (Multipole *) (base + multipolesOffset);
+	int *counts = (int *) (base + countsOffset);
+	double *m = (double *) (base + particlesOffset), *x = m + h.nbParticles, *y = x + h.nbParticles;
+	sq->fx = y + h.nbParticles;
+	sq->fy = sq->fx + h.nbParticles;
+
+	// the leader moves its copy to the window
+	if (nodeRank == 0)
+	{
+		memcpy(groups, qt->groups, nbGroups * sizeof(MultipoleGroup));
+		memcpy(multipoles, qt->multipoles, qt->nbMultipoles * sizeof(Multipole));
+		memcpy(counts, qt->counts, qt->nbMultipoles * sizeof(int));
+		free(qt->groups);
+		free(qt->multipoles);
+		free(qt->counts);
+
+		long o = 0;
+		for (int i = 0; i < qt->nbCells; i++)
+		{
+			Cell *c = qt->cells + i;
+			memcpy(m + o, c->m, c->nbParticles * sizeof(double));
+			memcpy(x + o, c->x, c->nbParticles * sizeof(double));
+			memcpy(y + o, c->y, c->nbParticles * sizeof(double));
+			memcpy(sq->fx + o, c->fx, c->nbParticles * sizeof(double));
+			memcpy(sq->fy + o, c->fy, c->nbParticles * sizeof(double));
+			freeCell(c);
+			o += c->nbParticles;
+		}
+	}
+	qt->groups = groups;
+	qt->multipoles = multipoles;
+	qt->counts = counts;
+
+	long o = 0;
+	for (int i = 0; i < qt->nbCells; i++)
+	{
+		Cell *c = qt->cells + i;
+		c->xMin = bounds[4*i]; c->xMax = bounds[4*i+1]; c->yMin = bounds[4*i+2]; c->yMax = bounds[4*i+3];
+		c->nbParticles = nbParticles[i];
+		c->m = m + o;
+		c->x = x + o;
+		c->y = y + o;
+		c->fx = sq->fx + o;
+		c->fy = sq->fy + o;
+		c->pot = NULL;
+		c->vir[0] = c->vir[1] = c->vir[2] = 0;
+		o += nbParticles[i];
+	}
+
+	free(bounds);
+	free(nbParticles);
+	nodeSync(sq);
+}
+
+// Compute the multipoles of the shared quadtree, by the leader of each node
+void computeMultipolesShared(Quadtree *qt, SharedQuadtree *sq)
+{
+	nodeSync(sq);
+	if (sq->leadersComm != MPI_COMM_NULL)
+		computeMultipoles(qt);
+	nodeSync(sq);
+}
+
+// Compute the gravitationnal force exerted on each particle of the shared quadtree: each rank
+// computes the forces on its cells as by computeForcesDistributed, then the leaders sum the
+// forces of their nodes so that every node has all the forces.
+// The forces are set, not added to the previous ones. The multipoles must have been computed
+void computeForcesShared(Quadtree *qt, SharedQuadtree *sq, double farFieldLimit)
+{
+	nodeSync(sq);
+	if (sq->leadersComm != MPI_COMM_NULL)
+		memset(sq->fx, 0, 2 * sq->nbParticles * sizeof(double));
+	nodeSync(sq);
+
+	computeForcesDistributed(qt, farFieldLimit);
+	nodeSync(sq);
+
+	// the forces of the cells of the other nodes are 0 in the window of a node
+	if (sq->leadersComm != MPI_COMM_NULL)
+		for (long i = 0; i < 2 * sq->nbParticles; i += INT_MAX / 2)
+		{
+			long n = 2 * sq->nbParticles - i;
+			MPI_Allreduce(MPI_IN_PLACE, sq->fx + i, (n < INT_MAX / 2) ? n : INT_MAX / 2, MPI_DOUBLE,
+						  MPI_SUM, sq->leadersComm);
+		}
+	nodeSync(sq);
+}
+
+// Release the ressources associated with the shared quadtree and its window
+void freeSharedQuadtree(Quadtree *qt, SharedQuadtree *sq)
+{
+	free(qt->cells);
+	MPI_Win_unlock_all(sq->win);
+	MPI_Win_free(&sq->win);
+	if (sq->leadersComm != MPI_COMM_NULL)
+		MPI_Comm_free(&sq->leadersComm);
+	MPI_Comm_free(&sq->nodeComm);
+}
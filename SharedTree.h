@@ -0,0 +1,45 @@
+#ifndef SHARED_TREE_H
+#define SHARED_TREE_H
+
+#include <mpi.h>
+
+#include "Quadtree.h"
+
+// Hybrid mode of the distributed force pass, with several ranks per node: the multipoles and
+// the particles of the quadtree are stored once per node, in an MPI-3 shared memory window
+// allocated by the rank 0 of the node, its leader. Each rank only keeps its own array of cells,
+// views on the window. The ranks of a node compute the forces on their cells as by
+// computeForcesDistributed, in the window, then only the leaders exchange them between nodes.
+
+typedef struct SharedQuadtree
+{
+	MPI_Comm nodeComm;         // ranks of the node
+	MPI_Comm leadersComm;      // leaders of the nodes, MPI_COMM_NULL on the other ranks
+	MPI_Win win;
+	long windowSize;           // bytes
+
+	// forces on all the particles, contiguous in the window
+	long nbParticles;
+	double *fx;
+	double *fy;
+} SharedQuadtree;
+
+// Move the quadtree qt built by the leader of each node to a window shared by the ranks of
+// the node, the other ranks getting a view on it in qt. The leader releases its own copy.
+// The nodes are the ones of nodeComm, which must share memory, or of MPI_COMM_TYPE_SHARED if
+// it is MPI_COMM_NULL. Collective over MPI_COMM_WORLD. Release it with freeSharedQuadtree
+extern void shareQuadtree(Quadtree *qt, SharedQuadtree *sq, MPI_Comm nodeComm);
+
+// Compute the multipoles of the shared quadtree, by the leader of each node
+extern void computeMultipolesShared(Quadtree *qt, SharedQuadtree *sq);
+
+// Compute the gravitationnal force exerted on each particle of the shared quadtree: each rank
+// computes the forces on its cells as by computeForcesDistributed, then the leaders sum the
+// forces of their nodes so that every node has all the forces.
+// The forces are set, not added to the previous ones. The multipoles must have been computed
+extern void computeForcesShared(Quadtree *qt, SharedQuadtree *sq, double farFieldLimit);
+
+// Release the ressources associated with the shared quadtree and its window
+extern void freeSharedQuadtree(Quadtree *qt, SharedQuadtree *sq);
+
+#endif
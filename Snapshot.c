@@ -0,0 +1,276 @@
+#define _DEFAULT_SOURCE
+
+#include "Snapshot.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <omp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define SNAPSHOT_MAGIC "BHSNAP1"
+
+// Private
+
+// Write size bytes, until done. Returns 0, or -1 with errno set
+static int writeAll(int fd, const void *buf, size_t size)
+{
+	for (size_t done = 0; done < size; )
+	{
+		ssize_t r = write(fd, (const char *)buf + done, size - done);
+		if (r < 0 && errno == EINTR)
+			continue;
+		if (r < 0)
+			return -1;
+		done += r;
+	}
+	return 0;
+}
+
+// Write size bytes of buf in path.tmp, then rename it path. Returns 0, or -1 with errno set
+static int writeFile(const char *path, const unsigned char *buf, size_t size)
+{
+	size_t length = strlen(path) + 5;
+	char *tmpPath = (char *) malloc(length);
+	snprintf(tmpPath, length, "%s.tmp", path);
+
+	int status = -1, fd = open(tmpPath, O_CREAT | O_TRUNC | O_WRONLY, 0644);
+	if (fd >= 0)
+	{
+		status = writeAll(fd, buf, size);
+		if (close(fd) != 0)
+			status = -1;
+		if (status == 0)
+			status = rename(tmpPath, path);
+		if (status != 0)
+		{
+			int e = errno;
+			unlink(tmpPath);
+			errno = e;
+		}
+	}
+	free(tmpPath);
+	return status;
+}
+
+// Write the pending buffers in order, until the writer stops
+static void *ioThread(void *arg)
+{
+	SnapshotWriter *sw = (SnapshotWriter *) arg;
+	pthread_mutex_lock(&sw->mutex);
+	for (;;)
+	{
+		while (sw->nbPending == 0 && !sw->stop)
+			pthread_cond_wait(&sw->cond, &sw->mutex);
+		if (sw->nbPending == 0)
+			break;
+
+		int b = (sw->next + 2 - sw->nbPending) % 2;
+		pthread_mutex_unlock(&sw->mutex);
+
+		double start = omp_get_wtime();
+		int status = writeFile(sw->paths[b], sw->buffers[b], sw->sizes[b]);
+		int e = errno;
+
+		pthread_mutex_lock(&sw->mutex);
+		sw->stats.writeSeconds += omp_get_wtime() - start;
+		if (status == 0)
+		{
+			sw->stats.nbSnapshots++;
+			sw->stats.bytes += sw->sizes[b];
+		}
+		else if (sw->error == 0)
+			sw->error = e;
+		sw->nbPending--;
+		pthread_cond_broadcast(&sw->cond);
+	}
+	pthread_mutex_unlock(&sw->mutex);
+	return NULL;
+}
+
+// Encode the cell c, of number cellNo, and its forces in buf of snapshotCellSize bytes
+static void encodeSnapshotCell(Cell *c, int cellNo, HaloEncoding encoding, unsigned char *buf)
+{
+	int n = c->nbParticles;
+	buf += encodeCell(c, cellNo, encoding, buf);
+	if (encoding == HALO_DOUBLE)
+	{
+		memcpy(buf, c->fx, n * sizeof(double));
+		memcpy(buf + n * sizeof(double), c->fy, n * sizeof(double));
+		return;
+	}
+
+	float *f = (float *) buf;
+	for (int i = 0; i < n; i++)
+	{
+		f[i] = (float) c->fx[i];
+		f[n + i] = (float) c->fy[i];
+	}
+}
+
+// Public
+
+// Returns the size of a cell of nbParticles particles and its forces in a snapshot
+size_t snapshotCellSize(int nbParticles, HaloEncoding encoding)
+{
+	size_t forceSize = (encoding == HALO_DOUBLE) ? sizeof(double) : sizeof(float);
+	return encodedCellSize(nbParticles, encoding) + ((2 * nbParticles * forceSize + 7) & ~(size_t)7);
+}
+
+// Decode the cell and its forces of a snapshot in buf in c, whose arrays are allocated as by
+// initCell, and its number in cellNo. Returns the number of bytes read
+size_t decodeSnapshotCell(const unsigned char *buf, HaloEncoding encoding, int *cellNo, Cell *c)
+{
+	const unsigned char *p = buf + decodeCell(buf, encoding, cellNo, c);
+	int n = c->nbParticles;
+	if (encoding == HALO_DOUBLE)
+	{
+		memcpy(c->fx, p, n * sizeof(double));
+		memcpy(c->fy, p + n * sizeof(double), n * sizeof(double));
+	}
+	else
+	{
+		const float *f = (const float *) p;
+		for (int i = 0; i < n; i++)
+		{
+			c->fx[i] = f[i];
+			c->fy[i] = f[n + i];
+		}
+	}
+	return snapshotCellSize(n, encoding);
+}
+
+// Start the I/O thread of a writer of snapshots with the specified encoding, of at most
+// maxBufferSize bytes each. Returns 0, or -1 with errno set
+int initSnapshotWriter(SnapshotWriter *sw, HaloEncoding encoding, size_t maxBufferSize)
+{
+	memset(sw, 0, sizeof(SnapshotWriter));
+	sw->encoding = encoding;
+	sw->maxBufferSize = maxBufferSize;
+	pthread_mutex_init(&sw->mutex, NULL);
+	pthread_cond_init(&sw->cond, NULL);
+
+	int e = pthread_create(&sw->thread, NULL, ioThread, sw);
+	if (e != 0)
+	{
+		pthread_mutex_destroy(&sw->mutex);
+		pthread_cond_destroy(&sw->cond);
+		errno = e;
+		return -1;
+	}
+	return 0;
+}
+
+// Encode the particles and forces of the quadtree, and queue them to be written in the file path.
+// The quadtree can be modified once it returns. Returns 0, or -1 with errno set: EFBIG if the
+// snapshot is larger than maxBufferSize, or the errno of a previous write that failed
+int writeSnapshot(SnapshotWriter *sw, Quadtree *qt, const char *path)
+{
+	// offsets of the cells in the snapshot
+	size_t *offsets = (size_t *) malloc((qt->nbCells + 1) * sizeof(size_t));
+	offsets[0] = sizeof(SnapshotHeader);
+	int64_t nbParticles = 0;
+	for (int i = 0; i < qt->nbCells; i++)
+	{
+		offsets[i+1] = offsets[i] + snapshotCellSize(qt->cells[i].nbParticles, sw->encoding);
+		nbParticles += qt->cells[i].nbParticles;
+	}
+	size_t size = offsets[qt->nbCells];
+	if (size > sw->maxBufferSize)
+	{
+		free(offsets);
+		errno = EFBIG;
+		return -1;
+	}
+
+	// back-pressure: wait for the buffer to fill to be written
+	double start = omp_get_wtime();
+	pthread_mutex_lock(&sw->mutex);
+	while (sw->nbPending == 2 && sw->error == 0)
+		pthread_cond_wait(&sw->cond, &sw->mutex);
+	int b = sw->next, e = sw->error;
+	sw->stats.waitSeconds += omp_get_wtime() - start;
+	pthread_mutex_unlock(&sw->mutex);
+	if (e != 0)
+	{
+		free(offsets);
+		errno = e;
+		return -1;
+	}
+
+	// the I/O thread does not touch the buffer b until it is pending
+	start = omp_get_wtime();
+	if (sw->capacities[b] < size)
+	{
+		unsigned char *buffer = (unsigned char *) realloc(sw->buffers[b], size);
+		if (buffer == NULL)
+		{
+			free(offsets);
+			errno = ENOMEM;
+			return -1;
+		}
+		sw->buffers[b] = buffer;
+		sw->capacities[b] = size;
+	}
+	free(sw->paths[b]);
+	sw->paths[b] = strdup(path);
+	sw->sizes[b] = size;
+
+	SnapshotHeader h = {SNAPSHOT_MAGIC, qt->curve, qt->height, sw->encoding, qt->nbCells,
+						qt->xMin, qt->xMax, qt->yMin, qt->yMax, nbParticles};
+	memcpy(sw->buffers[b], &h, sizeof(h));
+
+	#pragma omp parallel for schedule(dynamic, 16)
+	for (int i = 0; i < qt->nbCells; i++)
+		encodeSnapshotCell(qt->cells + i, i, sw->encoding, sw->buffers[b] + offsets[i]);
+	free(offsets);
+
+	pthread_mutex_lock(&sw->mutex);
+	sw->stats.encodeSeconds += omp_get_wtime() - start;
+	sw->next = 1 - b;
+	sw->nbPending++;
+	pthread_cond_broadcast(&sw->cond);
+	pthread_mutex_unlock(&sw->mutex);
+	return 0;
+}
+
+// Wait until the queued snapshots are written. Returns 0, or -1 with errno set if one of them failed
+int flushSnapshotWriter(SnapshotWriter *sw)
+{
+	pthread_mutex_lock(&sw->mutex);
+	while (sw->nbPending > 0)
+		pthread_cond_wait(&sw->cond, &sw->mutex);
+	int e = sw->error;
+	pthread_mutex_unlock(&sw->mutex);
+
+	if (e == 0)
+		return 0;
+	errno = e;
+	return -1;
+}
+
+// Write the queued snapshots, stop the I/O thread and release the ressources of the writer.
+// Returns as flushSnapshotWriter
+int freeSnapshotWriter(SnapshotWriter *sw)
+{
+	pthread_mutex_lock(&sw->mutex);
+	sw->stop = 1;
+	pthread_cond_broadcast(&sw->cond);
+	pthread_mutex_unlock(&sw->mutex);
+	pthread_join(sw->thread, NULL);
+
+	for (int b = 0; b < 2; b++)
+	{
+		free(sw->buffers[b]);
+		free(sw->paths[b]);
+	}
+	pthread_mutex_destroy(&sw->mutex);
+	pthread_cond_destroy(&sw->cond);
+
+	if (sw->error == 0)
+		return 0;
+	errno = sw->error;
+	return -1;
+}
@@ -0,0 +1,91 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "Halo.h"
+#include "Quadtree.h"
+
+// Asynchronous snapshots of the particles and forces of a quadtree, for checkpoints and outputs.
+// writeSnapshot encodes the quadtree in one of two buffers, in parallel over the cells, and
+// returns: a dedicated I/O thread writes the buffer while the next step is computed.
+// If both buffers are still waiting for the I/O thread, writeSnapshot waits for one of them,
+// so the extra memory is bounded by two snapshots, and the computation slows down to the pace
+// of the disk rather than queuing snapshots.
+//
+// A snapshot file holds a SnapshotHeader, then the cells in order, each one encoded by
+// encodeCell (see Halo.h) followed by its forces fx then fy, as doubles with HALO_DOUBLE and
+// as floats otherwise, padded to 8 bytes. HALO_DOUBLE snapshots are exact, for the checkpoints.
+// A file is written under a temporary name then renamed, so it is complete or absent
+
+typedef struct SnapshotHeader
+{
+	char magic[8];
+	int curve;                 // SpaceFillingCurve
+	int height;                // of the quadtree, on the area [xMin, xMax]*[yMin, yMax]
+	int encoding;              // HaloEncoding
+	int nbCells;
+	double xMin;
+	double xMax;
+	double yMin;
+	double yMax;
+	int64_t nbParticles;
+} SnapshotHeader;
+
+typedef struct SnapshotStats
+{
+	long nbSnapshots;          // written
+	long bytes;
+	double encodeSeconds;      // by writeSnapshot
+	double waitSeconds;        // of writeSnapshot for a free buffer
+	double writeSeconds;       // by the I/O thread
+} SnapshotStats;
+
+typedef struct SnapshotWriter
+{
+	HaloEncoding encoding;
+	size_t maxBufferSize;      // bytes of a snapshot
+
+	pthread_t thread;
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+
+	// buffers[next] is filled by writeSnapshot, the nbPending ones before it are written in order
+	unsigned char *buffers[2];
+	size_t capacities[2];
+	size_t sizes[2];
+	char *paths[2];
+	int next;
+	int nbPending;
+	int stop;
+	int error;                 // errno of the first failed write, 0 if none
+
+	SnapshotStats stats;
+} SnapshotWriter;
+
+// Returns the size of a cell of nbParticles particles and its forces in a snapshot
+extern size_t snapshotCellSize(int nbParticles, HaloEncoding encoding);
+
+// Decode the cell and its forces of a snapshot in buf in c, whose arrays are allocated as by
+// initCell, and its number in cellNo. Returns the number of bytes read
+extern size_t decodeSnapshotCell(const unsigned char *buf, HaloEncoding encoding, int *cellNo, Cell *c);
+
+// Start the I/O thread of a writer of snapshots with the specified encoding, of at most
+// maxBufferSize bytes each. Returns 0, or -1 with errno set
+extern int initSnapshotWriter(SnapshotWriter *sw, HaloEncoding encoding, size_t maxBufferSize);
+
+// Encode the particles and forces of the quadtree, and queue them to be written in the file path.
+// The quadtree can be modified once it returns. Returns 0, or -1 with errno set: EFBIG if the
+// snapshot is larger than maxBufferSize, or the errno of a previous write that failed
+extern int writeSnapshot(SnapshotWriter *sw, Quadtree *qt, const char *path);
+
+// Wait until the queued snapshots are written. Returns 0, or -1 with errno set if one of them failed
+extern int flushSnapshotWriter(SnapshotWriter *sw);
+
+// Write the queued snapshots, stop the I/O thread and release the ressources of the writer.
+// Returns as flushSnapshotWriter
+extern int freeSnapshotWriter(SnapshotWriter *sw);
+
+#endif
@@ -0,0 +1,329 @@
+#include "Timesteps.h"
+
+#include <malloc.h>
+#include <math.h>
+#include <string.h>
+
+// Private
+
+// Number of ticks of a step of level k
+static inline long period(BlockTimesteps *bt, int k)
+{
+	return 1L << (bt->maxLevel - k);
+}
+
+static inline double tickLength(BlockTimesteps *bt)
+{
+	return bt->dtMax / (double)(1L << bt->maxLevel);
+}
+
+// Level of the step of a particle of acceleration (ax, ay) at its level k.
+// A particle can only move to a coarser level at a tick shared with it
+static int chooseLevel(BlockTimesteps *bt, double ax, double ay, int k)
+{
+	double a = sqrt(ax*ax + ay*ay);
+	double dt = (a > 0) ? sqrt(2 * bt->eta * bt->eps / a) : bt->dtMax;
+
+	int level = 0;
+	while (level < bt->maxLevel && bt->dtMax / (double)(1L << level) > dt)
+		level++;
+	while (level < k && bt->tick % period(bt, level) != 0)
+		level++;
+	return level;
+}
+
+// Drift the particles of the cell cellNo and its boundaries to the current tick
+static void driftCell(Quadtree *qt, BlockTimesteps *bt, int cellNo)
+{
+	double dt = (bt->tick - bt->drifted[cellNo]) * tickLength(bt);
+	if (dt == 0)
+		return;
+
+	Cell *c = qt->cells + cellNo;
+	double *vx = bt->vx + bt->offsets[cellNo], *vy = bt->vy + bt->offsets[cellNo];
+	for (int i = 0; i < c->nbParticles; i++)
+	{
+		c->x[i] += vx[i] * dt;
+		c->y[i] += vy[i] * dt;
+	}
+
+	int leaf = qt->firstOuterCM + cellNo;
+	c->xMin += bt->mpVx[leaf] * dt; c->xMax += bt->mpVx[leaf] * dt;
+	c->yMin += bt->mpVy[leaf] * dt; c->yMax += bt->mpVy[leaf] * dt;
+	bt->drifted[cellNo] = bt->tick;
+}
+
+// Velocity of the center of mass of the cell cellNo
+static void refreshLeafVelocity(Quadtree *qt, BlockTimesteps *bt, int cellNo)
+{
+	Cell *c = qt->cells + cellNo;
+	double *vx = bt->vx + bt->offsets[cellNo], *vy = bt->vy + bt->offsets[cellNo];
+	double px = 0, py = 0, m = 0;
+	for (int i = 0; i < c->nbParticles; i++)
+	{
+		px += c->m[i] * vx[i];
+		py += c->m[i] * vy[i];
+		m += c->m[i];
+	}
+
+	int leaf = qt->firstOuterCM + cellNo;
+	bt->mpVx[leaf] = (m > 0) ? px / m : 0;
+	bt->mpVy[leaf] = (m > 0) ? py / m : 0;
+}
+
+// Velocity of the center of mass of the inner vertex cmNo, from its children
+static void refreshVertexVelocity(Quadtree *qt, BlockTimesteps *bt, int cmNo)
+{
+	double px = 0, py = 0, m = 0;
+	for (int i = 4*cmNo+1; i <= 4*cmNo+4; i++)
+	{
+		px += qt->multipoles[i].m * bt->mpVx[i];
+		py += qt->multipoles[i].m * bt->mpVy[i];
+		m += qt->multipoles[i].m;
+	}
+	bt->mpVx[cmNo] = (m > 0) ? px / m : 0;
+	bt->mpVy[cmNo] = (m > 0) ? py / m : 0;
+}
+
+// Kick the particles of the cell cellNo ending their step at the current tick: close their
+// step with the forces just computed, choose their new level, and open their new step.
+// Returns the number of particles kicked
+static long kickCell(Quadtree *qt, BlockTimesteps *bt, int cellNo)
+{
+	Cell *c = qt->cells + cellNo;
+	int o = bt->offsets[cellNo];
+	long nbKicked = 0;
+	int cellLevel = 0;
+
+	for (int i = 0; i < c->nbParticles; i++)
+	{
+		int k = bt->levels[o + i];
+		if (bt->tick % period(bt, k) == 0)
+		{
+			double ax = c->fx[i] / c->m[i], ay = c->fy[i] / c->m[i];
+			double dt = (bt->started) ? 0.5 * period(bt, k) * tickLength(bt) : 0;
+			k = chooseLevel(bt, ax, ay, k);
+			dt += 0.5 * period(bt, k) * tickLength(bt);
+
+			bt->vx[o + i] += ax * dt;
+			bt->vy[o + i] += ay * dt;
+			bt->levels[o + i] = k;
+			nbKicked++;
+		}
+		cellLevel = (k > cellLevel) ? k : cellLevel;
+	}
+
+	bt->cellLevels[cellNo] = cellLevel;
+	return nbKicked;
+}
+
+// Compute the forces on the active cells, drifting them and their near field first
+static void computeActiveForces(Quadtree *qt, BlockTimesteps *bt, int nbActiveCells, double farFieldLimit)
+{
+	memset(bt->marks, 0, qt->nbCells);
+
+	#pragma omp parallel
+	{
+		int *queue = (int *) malloc(qt->nbMultipoles * sizeof(int));
+
+		// the walk and the marks must see the same boxes of the targets
+		#pragma omp for schedule(dynamic, 16)
+		for (int i = 0; i < nbActiveCells; i++)
+			driftCell(qt, bt, bt->activeCells[i]);
+
+		#pragma omp for schedule(dynamic, 1)
+		for (int i = 0; i < nbActiveCells; i++)
+			markNearField(qt, bt->activeCells[i], farFieldLimit, queue, bt->marks);
+
+		free(queue);
+
+		#pragma omp for schedule(dynamic, 16)
+		for (int cellNo = 0; cellNo < qt->nbCells; cellNo++)
+			if (bt->marks[cellNo])
+				driftCell(qt, bt, cellNo);
+
+		#pragma omp for
+		for (int i = 0; i < nbActiveCells; i++)
+		{
+			Cell *c = qt->cells + bt->activeCells[i];
+			memset(c->fx, 0, c->nbParticles * sizeof(double));
+			memset(c->fy, 0, c->nbParticles * sizeof(double));
+		}
+	}
+
+	qt->nbActiveCells = nbActiveCells;
+	qt->activeCells = bt->activeCells;
+	computeForces(qt, farFieldLimit);
+	qt->activeCells = NULL;
+}
+
+// Refresh the multipoles of the active cells and of their ancestors
+static void refreshMultipoles(Quadtree *qt, BlockTimesteps *bt, int nbActiveCells)
+{
+	#pragma omp parallel for schedule(dynamic, 16)
+	for (int i = 0; i < nbActiveCells; i++)
+	{
+		int cellNo = bt->activeCells[i];
+		P2M(qt->multipoles + qt->firstOuterCM + cellNo, qt->cells + cellNo);
+		syncMultipole(qt, qt->firstOuterCM + cellNo);
+		refreshLeafVelocity(qt, bt, cellNo);
+	}
+
+	for (int i = 0; i < nbActiveCells; i++)
+		for (int cmNo = qt->firstOuterCM + bt->activeCells[i]; cmNo > 0 && !bt->mpMarks[(cmNo-1) / 4]; )
+		{
+			cmNo = (cmNo - 1) / 4;
+			bt->mpMarks[cmNo] = 1;
+		}
+
+	// the children of a vertex come after it
+	for (int cmNo = qt->firstOuterCM - 1; cmNo >= 0; cmNo--)
+		if (bt->mpMarks[cmNo])
+		{
+			M2M(qt->multipoles + cmNo, 4, qt->multipoles + 4*cmNo+1);
+			syncMultipole(qt, cmNo);
+			refreshVertexVelocity(qt, bt, cmNo);
+			bt->mpMarks[cmNo] = 0;
+		}
+}
+
+// Append the active cells to the lists of their levels
+static void listActiveCells(BlockTimesteps *bt, int nbActiveCells)
+{
+	for (int i = 0; i < nbActiveCells; i++)
+	{
+		int cellNo = bt->activeCells[i], k = bt->cellLevels[cellNo];
+		bt->nextCell[cellNo] = bt->levelFirst[k];
+		bt->levelFirst[k] = cellNo;
+	}
+}
+
+// First forces on all the particles, levels and half kicks
+static void startBlockTimesteps(Quadtree *qt, BlockTimesteps *bt, double farFieldLimit)
+{
+	int nbCells = qt->nbCells;
+	for (int cellNo = 0; cellNo < nbCells; cellNo++)
+		bt->activeCells[cellNo] = cellNo;
+
+	computeMultipoles(qt);
+	computeActiveForces(qt, bt, nbCells, farFieldLimit);
+
+	#pragma omp parallel for schedule(dynamic, 16)
+	for (int cellNo = 0; cellNo < nbCells; cellNo++)
+		kickCell(qt, bt, cellNo);
+
+	refreshMultipoles(qt, bt, nbCells);
+	listActiveCells(bt, nbCells);
+	bt->started = 1;
+}
+
+// Public
+
+// Initialize the block timesteps of the particles of the quadtree, with zero velocities
+void initBlockTimesteps(BlockTimesteps *bt, Quadtree *qt, double dtMax, int maxLevel,
+						double eta, double eps)
+{
+	bt->dtMax = dtMax;
+	bt->maxLevel = maxLevel;
+	bt->eta = eta;
+	bt->eps = eps;
+	bt->tick = 0;
+	bt->started = 0;
+
+	bt->offsets = (int *) malloc((qt->nbCells + 1) * sizeof(int));
+	bt->offsets[0] = 0;
+	for (int i = 0; i < qt->nbCells; i++)
+		bt->offsets[i+1] = bt->offsets[i] + qt->cells[i].nbParticles;
+	int nbParticles = bt->offsets[qt->nbCells];
+
+	bt->vx = (double *) calloc(2 * nbParticles, sizeof(double));
+	bt->vy = bt->vx + nbParticles;
+	bt->levels = (int *) calloc(nbParticles, sizeof(int));
+
+	bt->cellLevels = (int *) calloc(qt->nbCells, sizeof(int));
+	bt->drifted = (long *) calloc(qt->nbCells, sizeof(long));
+	bt->marks = (char *) calloc(qt->nbCells, sizeof(char));
+	bt->nbActiveCells = 0;
+	bt->activeCells = (int *) malloc(qt->nbCells * sizeof(int));
+	bt->levelFirst = (int *) malloc((maxLevel + 1) * sizeof(int));
+	for (int k = 0; k <= maxLevel; k++)
+		bt->levelFirst[k] = -1;
+	bt->nextCell = (int *) malloc(qt->nbCells * sizeof(int));
+	bt->mpDrifted = 0;
+
+	bt->mpVx = (double *) calloc(2 * qt->nbMultipoles, sizeof(double));
+	bt->mpVy = bt->mpVx + qt->nbMultipoles;
+	bt->mpMarks = (char *) calloc(qt->nbMultipoles, sizeof(char));
+}
+
+// Release the ressources associated with the block timesteps
+void freeBlockTimesteps(BlockTimesteps *bt)
+{
+	free(bt->offsets);
+	free(bt->vx);
+	free(bt->levels);
+	free(bt->cellLevels);
+	free(bt->drifted);
+	free(bt->marks);
+	free(bt->activeCells);
+	free(bt->levelFirst);
+	free(bt->nextCell);
+	free(bt->mpVx);
+	free(bt->mpMarks);
+}
+
+// Advance the particles of the quadtree by one tick. The first call computes the forces
+// on all the particles and opens their first steps.
+// Returns the number of particles kicked at the end of the tick
+long blockStep(Quadtree *qt, BlockTimesteps *bt, double farFieldLimit)
+{
+	if (!bt->started)
+		startBlockTimesteps(qt, bt, farFieldLimit);
+
+	bt->tick++;
+
+	// the levels whose steps end at this tick, their cells leaving their lists
+	int nbActiveCells = 0;
+	for (int k = bt->maxLevel; k >= 0 && bt->tick % period(bt, k) == 0; k--)
+	{
+		for (int cellNo = bt->levelFirst[k]; cellNo >= 0; cellNo = bt->nextCell[cellNo])
+			bt->activeCells[nbActiveCells++] = cellNo;
+		bt->levelFirst[k] = -1;
+	}
+	bt->nbActiveCells = nbActiveCells;
+
+	if (nbActiveCells == 0)
+		return 0;
+
+	// the velocities of the vertices only change at the ticks with active cells
+	double h = (bt->tick - bt->mpDrifted) * tickLength(bt);
+	#pragma omp parallel for
+	for (int cmNo = 0; cmNo < qt->nbMultipoles; cmNo++)
+	{
+		Multipole *mp = qt->multipoles + cmNo;
+		double dx = bt->mpVx[cmNo] * h, dy = bt->mpVy[cmNo] * h;
+		mp->x += dx; mp->xMin += dx; mp->xMax += dx;
+		mp->y += dy; mp->yMin += dy; mp->yMax += dy;
+		syncMultipole(qt, cmNo);
+	}
+	bt->mpDrifted = bt->tick;
+
+	computeActiveForces(qt, bt, nbActiveCells, farFieldLimit);
+
+	long nbKicked = 0;
+	#pragma omp parallel for schedule(dynamic, 1) reduction(+:nbKicked)
+	for (int i = 0; i < nbActiveCells; i++)
+		nbKicked += kickCell(qt, bt, bt->activeCells[i]);
+
+	refreshMultipoles(qt, bt, nbActiveCells);
+	listActiveCells(bt, nbActiveCells);
+	return nbKicked;
+}
+
+// Drift all the particles to the current tick
+void synchronizeBlockTimesteps(Quadtree *qt, BlockTimesteps *bt)
+{
+	#pragma omp parallel for schedule(dynamic, 16)
+	for (int cellNo = 0; cellNo < qt->nbCells; cellNo++)
+		driftCell(qt, bt, cellNo);
+}
@@ -0,0 +1,69 @@
+#ifndef TIMESTEPS_H
+#define TIMESTEPS_H
+
+#include "Quadtree.h"
+
+// Hierarchical block timesteps: each particle is integrated by kick-drift-kick leapfrog
+// with its own step dtMax / 2^level, the levels being chosen by the criterion
+//
+// 		dt = sqrt(2 * eta * eps / |a|)
+//
+// The time advances by the smallest step dtMax / 2^maxLevel, the tick. At each tick,
+// only the particles whose step ends are active: the cells containing one of them are the
+// targets of computeForces, and their particles are kicked. The others are not touched:
+// - the particles are drifted lazily, only the active cells and their near field
+//   are brought to the current tick before the forces are computed
+// - the multipoles are drifted with the velocity of their center of mass, and refreshed
+//   by P2M and M2M only along the branches of the kicked cells
+// so that the cost of a tick scales with the number of active cells, the cells being listed
+// by level, besides a sweep over the vertices at the ticks with active cells: the walks of
+// the active cells read vertices anywhere in the tree. The geometry of the tree is kept: it must be rebuilt once the
+// particles have moved a fraction of a cell.
+
+typedef struct BlockTimesteps
+{
+	double dtMax;              // step of the level 0
+	int maxLevel;              // finest level, the tick is dtMax / 2^maxLevel
+	double eta;                // parameters of the step criterion
+	double eps;
+	long tick;                 // current time, in ticks
+	int started;               // set once the first forces and half kicks are done
+
+	// per particle, in the order of the cells of the quadtree
+	int *offsets;              // index of the first particle of each cell, nbCells+1 values
+	double *vx;                // velocities, set them before the first step
+	double *vy;
+	int *levels;
+
+	// per cell
+	int *cellLevels;           // finest level of the particles of the cell
+	long *drifted;             // tick the particles of the cell were drifted to
+	char *marks;
+	int nbActiveCells;         // active cells of the last tick
+	int *activeCells;
+	int *levelFirst;           // first cell of each level, the next ones in nextCell, -1 at the end
+	int *nextCell;
+
+	// per vertex, velocity of the center of mass
+	double *mpVx;
+	double *mpVy;
+	char *mpMarks;
+	long mpDrifted;            // tick the vertices were drifted to
+} BlockTimesteps;
+
+// Initialize the block timesteps of the particles of the quadtree, with zero velocities
+extern void initBlockTimesteps(BlockTimesteps *bt, Quadtree *qt, double dtMax, int maxLevel,
+							   double eta, double eps);
+
+// Release the ressources associated with the block timesteps
+extern void freeBlockTimesteps(BlockTimesteps *bt);
+
+// Advance the particles of the quadtree by one tick. The first call computes the forces
+// on all the particles and opens their first steps.
+// Returns the number of particles kicked at the end of the tick
+extern long blockStep(Quadtree *qt, BlockTimesteps *bt, double farFieldLimit);
+
+// Drift all the particles to the current tick
+extern void synchronizeBlockTimesteps(Quadtree *qt, BlockTimesteps *bt);
+
+#endif
@@ -0,0 +1,250 @@
+#include "FFT.h"
+#include "TreePM.h"
+
+#include <malloc.h>
+#include <math.h>
+#include <omp.h>
+#include <string.h>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+#define RS_NODES 1.25   // default split scale, in node spacings
+#define RCUT_RS 6.0     // default cutoff, in split scales
+
+// Private
+
+// Fraction of the force kept in the short-range part at distance r
+static inline double shortRangeFactor(double r, double rs)
+{
+	double u = r / (2 * rs);
+	return erfc(u) + (r / (rs * sqrt(M_PI))) * exp(-u * u);
+}
+
+static inline double sinc(double x)
+{
+	return (x == 0) ? 1 : sin(x) / x;
+}
+
+// Nodes and weights of the mass assignment of the point (x, y) on the mesh: 
+// the first nodes are (ix, iy), the weights of the next ones are in wx and wy.
+// Returns the number of nodes per dimension
+static int assignmentWeights(TreePM *pm, double x, double y, int *ix, int *iy, double *wx, double *wy)
+{
+	double u = (x - pm->xOrigin) / pm->dX;
+	double v = (y - pm->yOrigin) / pm->dY;
+
+	if (pm->assignment == CIC)
+	{
+		*ix = (int)floor(u);
+		*iy = (int)floor(v);
+		double fu = u - *ix, fv = v - *iy;
+		wx[0] = 1 - fu; wx[1] = fu;
+		wy[0] = 1 - fv; wy[1] = fv;
+		return 2;
+	}
+
+	int cx = (int)floor(u + 0.5), cy = (int)floor(v + 0.5);
+	double du = u - cx, dv = v - cy;
+	*ix = cx - 1;
+	*iy = cy - 1;
+	wx[0] = 0.5 * (0.5 - du) * (0.5 - du); wx[1] = 0.75 - du * du; wx[2] = 0.5 * (0.5 + du) * (0.5 + du);
+	wy[0] = 0.5 * (0.5 - dv) * (0.5 - dv); wy[1] = 0.75 - dv * dv; wy[2] = 0.5 * (0.5 + dv) * (0.5 + dv);
+	return 3;
+}
+
+// Public
+
+// Initialize a TreePM solver for the area of the quadtree qt, with a mesh of gridSize² nodes
+// (power of 2). rs defaults to 1.25 node spacing and rcut to 6 rs
+void initTreePM(TreePM *pm, Quadtree *qt, int gridSize, MassAssignment assignment)
+{
+	int n = 2 * gridSize;
+	pm->gridSize = gridSize;
+	pm->assignment = assignment;
+
+	// the particles map to nodes [1, gridSize-2], the TSC stencil stays in the mesh
+	pm->dX = (qt->xMax - qt->xMin) / (gridSize - 3);
+	pm->dY = (qt->yMax - qt->yMin) / (gridSize - 3);
+	pm->xOrigin = qt->xMin - pm->dX;
+	pm->yOrigin = qt->yMin - pm->dY;
+	pm->rs = RS_NODES * fmax(pm->dX, pm->dY);
+	pm->rcut = RCUT_RS * pm->rs;
+	for (int i = 0; i <= SHORT_RANGE_TABLE + 1; i++)
+		pm->shortRange[i] = shortRangeFactor(pm->rcut * sqrt((double)i / SHORT_RANGE_TABLE), pm->rs);
+
+	pm->kernelX = (double *) malloc(5 * 2 * n * n * sizeof(double));
+	pm->kernelY = pm->kernelX + 2 * n * n;
+	pm->rho = pm->kernelY + 2 * n * n;
+	pm->fieldX = pm->rho + 2 * n * n;
+	pm->fieldY = pm->fieldX + 2 * n * n;
+	pm->pmTime = pm->treeTime = 0;
+
+	// long-range force on a unit mass exerted by a unit mass at offset (ox, oy), 
+	// the padded offsets wrap around
+	#pragma omp parallel for
+	for (int row = 0; row < n; row++)
+		for (int col = 0; col < n; col++)
+		{
+			double ox = ((col < gridSize) ? col : col - n) * pm->dX;
+			double oy = ((row < gridSize) ? row : row - n) * pm->dY;
+			double r = sqrt(ox * ox + oy * oy);
+			double k = (r > 0) ? -G * (1 - shortRangeFactor(r, pm->rs)) / (r * r * r) : 0;
+			int idx = 2 * (row * n + col);
+			pm->kernelX[idx] = k * ox;
+			pm->kernelY[idx] = k * oy;
+			pm->kernelX[idx + 1] = pm->kernelY[idx + 1] = 0;
+		}
+
+	fft2d(pm->kernelX, n, -1);
+	fft2d(pm->kernelY, n, -1);
+
+	// deconvolve the kernels by the assignment window, applied once to deposit and once to interpolate
+	int p = (assignment == CIC) ? 2 : 3;
+	#pragma omp parallel for
+	for (int row = 0; row < n; row++)
+		for (int col = 0; col < n; col++)
+		{
+			double kx = M_PI * ((col < gridSize) ? col : col - n) / n;
+			double ky = M_PI * ((row < gridSize) ? row : row - n) / n;
+			double w = pow(sinc(kx) * sinc(ky), p);
+			int idx = 2 * (row * n + col);
+			pm->kernelX[idx] /= w * w; pm->kernelX[idx + 1] /= w * w;
+			pm->kernelY[idx] /= w * w; pm->kernelY[idx + 1] /= w * w;
+		}
+}
+
+// Release the ressources associated with the TreePM solver
+void freeTreePM(TreePM *pm)
+{
+	free(pm->kernelX);
+}
+
+// Add the long-range mesh forces to the particles of the quadtree
+void computeLongRangeForces(Quadtree *qt, TreePM *pm)
+{
+	int n = 2 * pm->gridSize;
+	memset(pm->rho, 0, 2 * n * n * sizeof(double));
+
+	// Deposit the masses, the cells are compact so the atomics rarely collide
+	#pragma omp parallel for schedule(dynamic, 1)
+	for (int cellNo = 0; cellNo < qt->nbCells; cellNo++)
+	{
+		Cell *c = qt->cells + cellNo;
+		for (int i = 0; i < c->nbParticles; i++)
+		{
+			int ix, iy;
+			double wx[3], wy[3];
+			int s = assignmentWeights(pm, c->x[i], c->y[i], &ix, &iy, wx, wy);
+			for (int b = 0; b < s; b++)
+				for (int a = 0; a < s; a++)
+				{
+					#pragma omp atomic
+					pm->rho[2 * ((iy + b) * n + ix + a)] += c->m[i] * wx[a] * wy[b];
+				}
+		}
+	}
+
+	// Convolve with the long-range force kernels
+	fft2d(pm->rho, n, -1);
+
+	#pragma omp parallel for
+	for (int k = 0; k < n * n; k++)
+	{
+		double re = pm->rho[2*k], im = pm->rho[2*k + 1];
+		pm->fieldX[2*k] = re * pm->kernelX[2*k] - im * pm->kernelX[2*k + 1];
+		pm->fieldX[2*k + 1] = re * pm->kernelX[2*k + 1] + im * pm->kernelX[2*k];
+		pm->fieldY[2*k] = re * pm->kernelY[2*k] - im * pm->kernelY[2*k + 1];
+		pm->fieldY[2*k + 1] = re * pm->kernelY[2*k + 1] + im * pm->kernelY[2*k];
+	}
+
+	fft2d(pm->fieldX, n, 1);
+	fft2d(pm->fieldY, n, 1);
+
+	// Interpolate the fields back to the particles
+	#pragma omp parallel for schedule(dynamic, 1)
+	for (int cellNo = 0; cellNo < qt->nbCells; cellNo++)
+	{
+		Cell *c = qt->cells + cellNo;
+		for (int i = 0; i < c->nbParticles; i++)
+		{
+			int ix, iy;
+			double wx[3], wy[3], ax = 0, ay = 0;
+			int s = assignmentWeights(pm, c->x[i], c->y[i], &ix, &iy, wx, wy);
+			for (int b = 0; b < s; b++)
+				for (int a = 0; a < s; a++)
+				{
+					int idx = 2 * ((iy + b) * n + ix + a);
+					ax += wx[a] * wy[b] * pm->fieldX[idx];
+					ay += wx[a] * wy[b] * pm->fieldY[idx];
+				}
+			c->fx[i] += c->m[i] * ax;
+			c->fy[i] += c->m[i] * ay;
+		}
+	}
+}
+
+// Compute the gravitationnal force exerted on each particule of the quadtree as the sum 
+// of the long-range mesh forces and of the short-range tree forces, timing both parts.
+// The multipoles must have been computed
+void computeForcesTreePM(Quadtree *qt, TreePM *pm, double farFieldLimit)
+{
+	double start = omp_get_wtime();
+	computeLongRangeForces(qt, pm);
+	pm->pmTime = omp_get_wtime() - start;
+
+	start = omp_get_wtime();
+	qt->pm = pm;
+	computeForces(qt, farFieldLimit);
+	qt->pm = NULL;
+	pm->treeTime = omp_get_wtime() - start;
+}
+
+// Short-range versions of the operators of Cell.h: the force is multiplied by fs(r), 
+// and is zero beyond rcut
+void ponPshort(TreePM *pm, double mC, double xC, double yC, int nbParticles, double *m, 
+			   double *x, double *y, double *fx, double *fy)
+{
+	double rcut2 = pm->rcut * pm->rcut;
+	double scale = SHORT_RANGE_TABLE / rcut2;
+	double gmC = G * mC;
+
+	#pragma omp simd
+	for (int i = 0; i < nbParticles; i++)
+	{
+		double dx = xC - x[i];
+		double dy = yC - y[i];
+		double d2 = dx*dx + dy*dy;
+
+		// linear interpolation of fs in the table, zero beyond rcut
+		double t = fmin(d2, rcut2) * scale;
+		int k = (int)t;
+		double fs = (d2 < rcut2) ? pm->shortRange[k] + (t - k) * (pm->shortRange[k+1] - pm->shortRange[k]) : 0;
+
+		double r = gmC * m[i] * fs / (d2 * sqrt(d2));
+		fx[i] += r * dx;
+		fy[i] += r * dy;
+	}
+}
+
+void P2P_inShort(TreePM *pm, Cell *c)
+{
+	for (int i = 0; i < c->nbParticles; i++)
+	{
+		ponPshort(pm, c->m[i], c->x[i], c->y[i], i, c->m, c->x, c->y, c->fx, c->fy);
+		ponPshort(pm, c->m[i], c->x[i], c->y[i], c->nbParticles - (i+1), 
+				  c->m + (i+1), c->x + (i+1), c->y + (i+1), c->fx + (i+1), c->fy + (i+1));
+	}
+}
+
+void P2P_extShort(TreePM *pm, Cell *c1, Cell *c2)
+{
+	for (int i = 0; i < c1->nbParticles; i++)
+		ponPshort(pm, c1->m[i], c1->x[i], c1->y[i], c2->nbParticles, c2->m, c2->x, c2->y, c2->fx, c2->fy);
+}
+
+void M2Pshort(TreePM *pm, Multipole *m, Cell *c)
+{
+	ponPshort(pm, m->m, m->x, m->y, c->nbParticles, c->m, c->x, c->y, c->fx, c->fy);
+}
@@ -0,0 +1,79 @@
+#ifndef TREEPM_H
+#define TREEPM_H
+
+#include "Cell.h"
+#include "Multipole.h"
+#include "Quadtree.h"
+
+// TreePM hybrid solver: the force is split at the scale rs into
+//
+// 		F = F * (1 - fs(r)) + F * fs(r)     where fs(r) = erfc(r/2rs) + r/(rs*sqrt(pi)) * exp(-r²/4rs²)
+//
+// The long-range part is computed on a mesh: the masses are deposited with CIC or TSC, 
+// convolved with the long-range force kernel by FFT (zero padded, isolated boundaries), 
+// and the forces interpolated back to the particles with the same scheme. 
+// The short-range part is computed by the tree walk and P2P kernels, only within rcut.
+//
+// The potential energy and the virial are not computed in this mode: the short-range operators
+// leave the potentials and virials of the cells untouched, and computeEnergy fails afterwards
+
+typedef enum MassAssignment
+{
+	CIC, // Cloud In Cell, 2x2 nodes
+	TSC  // Triangular Shaped Cloud, 3x3 nodes
+} MassAssignment;
+
+#define SHORT_RANGE_TABLE 4096
+
+typedef struct TreePM
+{
+	int gridSize;              // number of nodes of the mesh per dimension (power of 2)
+	MassAssignment assignment;
+	double rs;                 // scale of the split
+	double rcut;               // short-range cutoff
+
+	// fs tabulated on [0, rcut²] by steps of rcut²/SHORT_RANGE_TABLE in r²
+	double shortRange[SHORT_RANGE_TABLE + 2];
+
+	// mesh covering the quadtree area, with a margin of one node
+	double xOrigin;
+	double yOrigin;
+	double dX;
+	double dY;
+
+	// FFT grids of (2*gridSize)² complex values
+	double *kernelX;           // transforms of the long-range force kernels
+	double *kernelY;
+	double *rho;
+	double *fieldX;
+	double *fieldY;
+
+	// timings of the last computeForcesTreePM (seconds)
+	double pmTime;
+	double treeTime;
+} TreePM;
+
+// Initialize a TreePM solver for the area of the quadtree qt, with a mesh of gridSize² nodes
+// (power of 2). rs defaults to 1.25 node spacing and rcut to 6 rs
+extern void initTreePM(TreePM *pm, Quadtree *qt, int gridSize, MassAssignment assignment);
+
+// Release the ressources associated with the TreePM solver
+extern void freeTreePM(TreePM *pm);
+
+// Compute the gravitationnal force exerted on each particule of the quadtree as the sum 
+// of the long-range mesh forces and of the short-range tree forces, timing both parts.
+// The multipoles must have been computed
+extern void computeForcesTreePM(Quadtree *qt, TreePM *pm, double farFieldLimit);
+
+// Add the long-range mesh forces to the particles of the quadtree
+extern void computeLongRangeForces(Quadtree *qt, TreePM *pm);
+
+// Short-range versions of the operators of Cell.h: the force is multiplied by fs(r), 
+// and is zero beyond rcut
+extern void ponPshort(TreePM *pm, double mC, double xC, double yC, int nbParticles, double *m, 
+					  double *x, double *y, double *fx, double *fy);
+extern void P2P_inShort(TreePM *pm, Cell *c);
+extern void P2P_extShort(TreePM *pm, Cell *c1, Cell *c2);
+extern void M2Pshort(TreePM *pm, Multipole *m, Cell *c);
+
+#endif
@@ -0,0 +1,71 @@
+#include <mpi.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+
+#include "Analysis.h"
+#include "Generator.h"
+#include "Quadtree.h"
+
+#define FAR_FIELD_LIMIT 0.707
+
+int main(int argc, char const *argv[])
+{
+	MPI_Init(NULL, NULL);
+	int rank, size;
+	MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+	MPI_Comm_size(MPI_COMM_WORLD, &size);
+
+	if (argc != 4)
+	{
+		if (rank == 0)
+			printf("Usage: %s nbParticles treeHeight outputPath\n", argv[0]);
+		MPI_Finalize();
+		return EXIT_FAILURE;
+	}
+
+	int nbParticles = atoi(argv[1]);
+	int height = atoi(argv[2]);
+	Quadtree qt;
+	Generator gen;
+
+	initGenerator(&gen, PLUMMER_DISTRIBUTION, 42, 1e30, 1e32, 0, 1e17, 0, 1e17);
+	initQuadtreeGenerator(&qt, HILBERT_CURVE, height, nbParticles, &gen);
+	computeMultipoles(&qt);
+
+	double start = MPI_Wtime();
+	computeForcesDistributed(&qt, FAR_FIELD_LIMIT);
+	MPI_Barrier(MPI_COMM_WORLD);
+	double forcesTime = MPI_Wtime() - start;
+
+	Analysis a;
+	initAnalysis(&a, &qt, 256, 64, 5e16, 5e16, 5e16, 64, 1e20, 1e30);
+	start = MPI_Wtime();
+	analyzeDistributed(&a, &qt);
+	double analysisTime = MPI_Wtime() - start;
+
+	if (rank == 0)
+	{
+		start = MPI_Wtime();
+		if (writeAnalysis(&a, argv[3]) != 0)
+		{
+			perror("writeAnalysis");
+			MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+		}
+		double writeTime = MPI_Wtime() - start;
+
+		struct stat st;
+		stat(argv[3], &st);
+		printf("# Benching the in-situ analysis after the distributed force pass, Plummer particles\n"
+			   "%d particles, tree of height %d, %d nodes, 256x256 pixels\n"
+			   "# Interaction computation time, analysis and reduction time, writing time (seconds), "
+			   "bytes of the summaries, bytes of a full dump (m, x, y, fx, fy)\n"
+			   "%e %e %e %ld %ld\n\n", nbParticles, height, size, forcesTime, analysisTime, writeTime,
+			   (long)st.st_size, 5L * nbParticles * sizeof(double));
+	}
+
+	freeAnalysis(&a);
+	freeQuadtree(&qt);
+	MPI_Finalize();
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,69 @@
+#include <mpi.h>
+#include <sys/time.h>
+#include <stdlib.h>
+
+#include "Cell.h"
+#include "Direct.h"
+#include "Quadtree.h"
+#include "utils.h"
+
+#define FAR_FIELD_LIMIT 0.707
+
+int main(int argc, char const *argv[])
+{
+	MPI_Init(NULL, NULL);
+	int rank, size;
+	MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+	MPI_Comm_size(MPI_COMM_WORLD, &size);
+
+	if (argc != 3)
+	{
+		if (rank == 0)
+			printf("Usage: %s nbParticles treeHeight\n", argv[0]);
+		MPI_Finalize();
+		return EXIT_FAILURE;
+	}
+
+	int nbParticles = atoi(argv[1]);
+	int height = atoi(argv[2]);
+	Quadtree qt;
+	Cell cMerged;
+	struct timeval start, stop;
+
+	if (rank == 0)
+		printf("# Validating the barnes-hut like method against the blocked direct summation, "
+			   "distributed over %d nodes\n%d particles, tree of height %d\n", size, nbParticles, height);
+
+	srand(42);
+	initQuadtree(&qt, height, nbParticles, nbParticles, 1e30, 1e32, 0, 1e17, 0, 1e17);
+	mergeCell(&cMerged, qt.nbCells, qt.cells);
+
+	MPI_Barrier(MPI_COMM_WORLD);
+	gettimeofday(&start, NULL);
+	directSumDistributed(&cMerged);
+	gettimeofday(&stop, NULL);
+	double directTime = stop.tv_sec - start.tv_sec + 0.000001 * (stop.tv_usec - start.tv_usec);
+
+	if (rank == 0)
+	{
+		gettimeofday(&start, NULL);
+		computeMultipoles(&qt);
+		computeForces(&qt, FAR_FIELD_LIMIT);
+		gettimeofday(&stop, NULL);
+		double treeTime = stop.tv_sec - start.tv_sec + 0.000001 * (stop.tv_usec - start.tv_usec);
+
+		double minRE, maxRE, firstQRE, medianRE, thirdQRE;
+		computeRelativeErrors(&cMerged, qt.nbCells, qt.cells, &minRE, &maxRE, &firstQRE, &medianRE, &thirdQRE);
+
+		printf("# Nb of particles, Quadtree height, direct summation time, tree time (seconds), "
+			   "relative errors (min, 1st quartile, median, 3rd quartile, max)\n"
+			   "%d %d %e %e %e %e %e %e %e\n\n", nbParticles, height, directTime, treeTime, 
+			   minRE, firstQRE, medianRE, thirdQRE, maxRE);
+	}
+
+	freeCell(&cMerged);
+	freeQuadtree(&qt);
+
+	MPI_Finalize();
+	return EXIT_SUCCESS;
+}
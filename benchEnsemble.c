@@ -0,0 +1,78 @@
+#include <sys/time.h>
+#include <stdlib.h>
+
+#include "Generator.h"
+#include "Quadtree.h"
+
+#define FAR_FIELD_LIMIT 0.707
+
+static double elapsed(struct timeval *start, struct timeval *stop)
+{
+	return stop->tv_sec - start->tv_sec + 0.000001 * (stop->tv_usec - start->tv_usec);
+}
+
+int main(int argc, char const *argv[])
+{
+	if (argc != 4)
+	{
+		printf("Usage: %s nbSystems nbParticles treeHeight\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	int nbSystems = atoi(argv[1]);
+	int nbParticles = atoi(argv[2]);
+	int height = atoi(argv[3]);
+	Quadtree *qts = (Quadtree *) malloc(nbSystems * sizeof(Quadtree));
+	Generator gen;
+	struct timeval start, stop;
+
+	printf("# Benching the ensemble mode vs one call per system, Plummer systems\n"
+		   "%d systems of %d particles, trees of height %d\n", nbSystems, nbParticles, height);
+
+	initGenerator(&gen, PLUMMER_DISTRIBUTION, 42, 1e30, 1e32, 0, 1e17, 0, 1e17);
+
+	// one system after the other, each call in parallel
+	gettimeofday(&start, NULL);
+	for (int s = 0; s < nbSystems; s++)
+	{
+		Generator g = gen;
+		g.stream = s;
+		initQuadtreeGenerator(qts + s, MORTON_CURVE, height, nbParticles, &g);
+	}
+	gettimeofday(&stop, NULL);
+	double buildTime = elapsed(&start, &stop);
+
+	gettimeofday(&start, NULL);
+	for (int s = 0; s < nbSystems; s++)
+	{
+		computeMultipoles(qts + s);
+		computeForces(qts + s, FAR_FIELD_LIMIT);
+	}
+	gettimeofday(&stop, NULL);
+	double forcesTime = elapsed(&start, &stop);
+
+	for (int s = 0; s < nbSystems; s++)
+		freeQuadtree(qts + s);
+
+	// all the systems at once
+	gettimeofday(&start, NULL);
+	initQuadtreeEnsemble(nbSystems, qts, MORTON_CURVE, height, nbParticles, &gen);
+	gettimeofday(&stop, NULL);
+	double ensembleBuildTime = elapsed(&start, &stop);
+
+	gettimeofday(&start, NULL);
+	computeMultipolesEnsemble(nbSystems, qts);
+	computeForcesEnsemble(nbSystems, qts, FAR_FIELD_LIMIT);
+	gettimeofday(&stop, NULL);
+	double ensembleForcesTime = elapsed(&start, &stop);
+
+	printf("# Nb of systems, nb of particles, Quadtree height, building time, multipoles and forces time, "
+		   "ensemble building time, ensemble multipoles and forces time (seconds)\n"
+		   "%d %d %d %e %e %e %e\n\n", nbSystems, nbParticles, height, 
+		   buildTime, forcesTime, ensembleBuildTime, ensembleForcesTime);
+
+	for (int s = 0; s < nbSystems; s++)
+		freeQuadtree(qts + s);
+	free(qts);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,60 @@
+#include <sys/time.h>
+#include <stdlib.h>
+
+#include "Quadtree.h"
+#include "utils.h"
+
+#define FAR_FIELD_LIMIT 0.707
+
+int main(int argc, char const *argv[])
+{
+	if (argc != 4)
+	{
+		printf("Usage: %s nbParticles treeHeight nbProbes\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	int nbParticles = atoi(argv[1]);
+	int height = atoi(argv[2]);
+	int nbProbes = atoi(argv[3]);
+	Quadtree qt;
+	struct timeval start, stop;
+
+	printf("# Benching the field at probe points vs the forces on the particles, groups in parallel\n"
+		   "%d particles, tree of height %d, %d probes\n", nbParticles, height, nbProbes);
+
+	srand(42);
+	initQuadtree(&qt, height, nbParticles, nbParticles, 1e30, 1e32, 0, 1e17, 0, 1e17);
+	computeMultipoles(&qt);
+
+	double *probes = (double *) malloc(5 * nbProbes * sizeof(double));
+	double *x = probes, *y = x + nbProbes, *gx = y + nbProbes, *gy = gx + nbProbes, *pot = gy + nbProbes;
+	for (int i = 0; i < nbProbes; i++)
+	{
+		x[i] = randDouble(0, 1e17);
+		y[i] = randDouble(0, 1e17);
+	}
+
+	gettimeofday(&start, NULL);
+	computeForces(&qt, FAR_FIELD_LIMIT);
+	gettimeofday(&stop, NULL);
+	double forcesTime = stop.tv_sec - start.tv_sec + 0.000001 * (stop.tv_usec - start.tv_usec);
+
+	gettimeofday(&start, NULL);
+	computeField(&qt, nbProbes, x, y, gx, gy, NULL, FAR_FIELD_LIMIT);
+	gettimeofday(&stop, NULL);
+	double fieldTime = stop.tv_sec - start.tv_sec + 0.000001 * (stop.tv_usec - start.tv_usec);
+
+	gettimeofday(&start, NULL);
+	computeField(&qt, nbProbes, x, y, gx, gy, pot, FAR_FIELD_LIMIT);
+	gettimeofday(&stop, NULL);
+	double potTime = stop.tv_sec - start.tv_sec + 0.000001 * (stop.tv_usec - start.tv_usec);
+
+	printf("# Nb of particles, Quadtree height, nb of probes, forces time, field time, "
+		   "field and potential time (seconds)\n%d %d %d %e %e %e\n\n", 
+		   nbParticles, height, nbProbes, forcesTime, fieldTime, potTime);
+
+	free(probes);
+	freeQuadtree(&qt);
+	return EXIT_SUCCESS;
+}
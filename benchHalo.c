@@ -0,0 +1,83 @@
+#include <math.h>
+#include <mpi.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Halo.h"
+#include "Quadtree.h"
+#include "utils.h"
+
+#define FAR_FIELD_LIMIT 0.707
+
+static const char *encodingNames[] = {"double", "quantized32", "quantized16"};
+
+int main(int argc, char const *argv[])
+{
+	MPI_Init(NULL, NULL);
+	int rank, size;
+	MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+	MPI_Comm_size(MPI_COMM_WORLD, &size);
+
+	if (argc != 3)
+	{
+		if (rank == 0)
+			printf("Usage: %s nbParticles treeHeight\n", argv[0]);
+		MPI_Finalize();
+		return EXIT_FAILURE;
+	}
+
+	int nbParticles = atoi(argv[1]);
+	int height = atoi(argv[2]);
+	Quadtree qt;
+
+	srand(42);
+	initQuadtree(&qt, height, nbParticles, nbParticles, 1e30, 1e32, 0, 1e17, 0, 1e17);
+	computeMultipoles(&qt);
+
+	int firstCell, lastCell;
+	distributedCells(&qt, rank, size, &firstCell, &lastCell);
+	int nbOwnCells = lastCell - firstCell;
+	Cell *own = qt.cells + firstCell, reference;
+
+	if (rank == 0)
+		printf("# Benching the encodings of the halo exchange of the distributed force pass\n"
+			   "%d particles, tree of height %d, %d nodes\n"
+			   "# Encoding, bytes received, bytes as doubles, exchange time (seconds, max over the nodes), "
+			   "relative errors of the forces on the cells of the node 0 vs double: min, max, median\n", 
+			   nbParticles, height, size);
+
+	for (int encoding = HALO_DOUBLE; encoding <= HALO_QUANTIZED_16; encoding++)
+	{
+		for (int i = 0; i < nbOwnCells; i++)
+		{
+			memset(own[i].fx, 0, own[i].nbParticles * sizeof(double));
+			memset(own[i].fy, 0, own[i].nbParticles * sizeof(double));
+		}
+
+		HaloStats stats;
+		computeForcesDistributedHalo(&qt, FAR_FIELD_LIMIT, encoding, &stats);
+
+		long bytes[2] = {stats.bytes, stats.doubleBytes}, totalBytes[2];
+		double seconds;
+		MPI_Reduce(bytes, totalBytes, 2, MPI_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
+		MPI_Reduce(&stats.seconds, &seconds, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+
+		double minRE = 0, maxRE = 0, firstQRE, medianRE = 0, thirdQRE;
+		if (encoding == HALO_DOUBLE)
+			mergeCell(&reference, nbOwnCells, own);
+		else
+			computeRelativeErrors(&reference, nbOwnCells, own, &minRE, &maxRE, &firstQRE, &medianRE, &thirdQRE);
+
+		if (rank == 0)
+			printf("%s %ld %ld %e %e %e %e\n", encodingNames[encoding], totalBytes[0], totalBytes[1], 
+				   seconds, minRE, maxRE, medianRE);
+	}
+	if (rank == 0)
+		printf("\n");
+
+	freeCell(&reference);
+	freeQuadtree(&qt);
+	MPI_Finalize();
+	return EXIT_SUCCESS;
+}
@@ -2,15 +2,16 @@
 #include <stdlib.h>
 
 #include "Cell.h"
+#include "Direct.h"
 #include "Quadtree.h"
 
 #define FAR_FIELD_LIMIT 0.707
 
 int main(int argc, char const *argv[])
 {
-	if (argc != 3)
+	if (argc != 3 && argc != 4)
 	{
-		printf("Usage: %s nbParticles treeHeight\n", argv[0]);
+		printf("Usage: %s nbParticles treeHeight [nbErrorSamples]\n", argv[0]);
 		return EXIT_FAILURE;
 	}
 
@@ -28,6 +29,11 @@ int main(int argc, char const *argv[])
 	gettimeofday(&stop, NULL);
 	double buildTime = stop.tv_sec - start.tv_sec + 0.000001 * (stop.tv_usec - start.tv_usec);
 
+	gettimeofday(&start, NULL);
+	placeQuadtree(&qt);
+	gettimeofday(&stop, NULL);
+	double placementTime = stop.tv_sec - start.tv_sec + 0.000001 * (stop.tv_usec - start.tv_usec);
+
 	gettimeofday(&start, NULL);
 	computeMultipoles(&qt);
 	gettimeofday(&stop, NULL);
@@ -38,8 +44,23 @@ int main(int argc, char const *argv[])
   	gettimeofday(&stop, NULL);
   	double interactionTime = stop.tv_sec - start.tv_sec + 0.000001 * (stop.tv_usec - start.tv_usec);
 
-	printf("#Nb of particles, Quadtree height, Quadtree building time, multipole computation time, interaction computation time (seconds)\n"
-		   "%d %d %e %e %e\n\n", nbParticles, height, buildTime, multipoleTime, interactionTime);
+	printf("#Nb of particles, Quadtree height, Quadtree building time, placement time, multipole computation time, interaction computation time (seconds)\n"
+		   "%d %d %e %e %e %e\n\n", nbParticles, height, buildTime, placementTime, multipoleTime, interactionTime);
+
+	if (argc == 4)
+	{
+		ErrorEstimate est;
+		gettimeofday(&start, NULL);
+		sampleRelativeErrors(qt.nbCells, qt.cells, atoi(argv[3]), 42, &est);
+		gettimeofday(&stop, NULL);
+		double samplingTime = stop.tv_sec - start.tv_sec + 0.000001 * (stop.tv_usec - start.tv_usec);
+
+		printf("# Nb of samples, sampling time (seconds), sampled relative errors [95%% confidence interval]: "
+			   "1st quartile, median, 3rd quartile\n"
+			   "%d %e %e %e %e %e %e %e %e %e %e\n\n", est.nbSamples, samplingTime, 
+			   est.quantiles[1], est.lower[1], est.upper[1], est.quantiles[2], est.lower[2], est.upper[2], 
+			   est.quantiles[3], est.lower[3], est.upper[3]);
+	}
 
 	freeQuadtree(&qt);
 	return EXIT_SUCCESS;
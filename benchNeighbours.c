@@ -0,0 +1,79 @@
+#include <math.h>
+#include <omp.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "Generator.h"
+#include "Neighbours.h"
+#include "Quadtree.h"
+
+// Number of particles within radius of each particle, by brute force
+static long countBruteForce(int n, const double *x, const double *y, double radius)
+{
+	long count = 0;
+	#pragma omp parallel for schedule(dynamic, 64) reduction(+:count)
+	for (int q = 0; q < n; q++)
+		for (int p = 0; p < n; p++)
+		{
+			double dx = x[p] - x[q], dy = y[p] - y[q];
+			count += (dx*dx + dy*dy <= radius * radius);
+		}
+	return count;
+}
+
+int main(int argc, char const *argv[])
+{
+	if (argc != 5)
+	{
+		printf("Usage: %s nbParticles treeHeight radius k\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	int nbParticles = atoi(argv[1]);
+	int height = atoi(argv[2]);
+	double radius = atof(argv[3]);
+	int k = atoi(argv[4]);
+	Quadtree qt;
+	Generator gen;
+
+	initGenerator(&gen, PLUMMER_DISTRIBUTION, 42, 1e30, 1e32, 0, 1e17, 0, 1e17);
+	initQuadtreeGenerator(&qt, HILBERT_CURVE, height, nbParticles, &gen);
+
+	// the particles are the queries
+	double *x = (double *) malloc(2 * nbParticles * sizeof(double)), *y = x + nbParticles;
+	for (int i = 0, p = 0; i < qt.nbCells; i++)
+		for (int j = 0; j < qt.cells[i].nbParticles; j++, p++)
+		{
+			x[p] = qt.cells[i].x[j];
+			y[p] = qt.cells[i].y[j];
+		}
+
+	NeighbourLists nl;
+	double start = omp_get_wtime();
+	findNeighboursRadius(&qt, nbParticles, x, y, radius, &nl);
+	double radiusTime = omp_get_wtime() - start;
+	long nbRadius = nl.offsets[nbParticles];
+	freeNeighbourLists(&nl);
+
+	start = omp_get_wtime();
+	findNearestNeighbours(&qt, nbParticles, x, y, k, &nl);
+	double knnTime = omp_get_wtime() - start;
+	freeNeighbourLists(&nl);
+
+	start = omp_get_wtime();
+	long nbBruteForce = countBruteForce(nbParticles, x, y, radius);
+	double bruteForceTime = omp_get_wtime() - start;
+
+	printf("# Benching the neighbour queries on the quadtree, one per particle, Plummer particles\n"
+		   "%d particles, tree of height %d, radius %e, k %d, %d threads\n"
+		   "# Neighbours per particle within radius, radius search time, kNN time, "
+		   "brute force radius time (seconds)\n"
+		   "%.1f %e %e %e\n\n", nbParticles, height, radius, k, omp_get_max_threads(),
+		   (double)nbRadius / nbParticles, radiusTime, knnTime, bruteForceTime);
+	if (nbRadius != nbBruteForce)
+		printf("Mismatch: %ld neighbours by brute force\n", nbBruteForce);
+
+	free(x);
+	freeQuadtree(&qt);
+	return EXIT_SUCCESS;
+}
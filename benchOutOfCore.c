@@ -0,0 +1,62 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+
+#include "Generator.h"
+#include "OutOfCore.h"
+
+#define FAR_FIELD_LIMIT 0.707
+#define CHUNK_SIZE 1000000
+
+static double elapsed(struct timeval *start, struct timeval *stop)
+{
+	return stop->tv_sec - start->tv_sec + 0.000001 * (stop->tv_usec - start->tv_usec);
+}
+
+int main(int argc, char const *argv[])
+{
+	if (argc != 5)
+	{
+		printf("Usage: %s file nbParticles treeHeight maxResidentParticles\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	const char *path = argv[1];
+	long nbParticles = atol(argv[2]);
+	int height = atoi(argv[3]);
+	long maxResident = atol(argv[4]);
+	Generator gen;
+	ParticleFile pf;
+	OutOfCoreStats stats;
+	struct timeval start, stop;
+
+	printf("# Benching the out-of-core mode, Plummer particles\n"
+		   "%ld particles in %s, tree of height %d, at most %ld particles in memory\n", 
+		   nbParticles, path, height, maxResident);
+
+	initGenerator(&gen, PLUMMER_DISTRIBUTION, 42, 1e30, 1e32, 0, 1e17, 0, 1e17);
+	gettimeofday(&start, NULL);
+	if (writeParticleFile(path, HILBERT_CURVE, height, nbParticles, &gen, CHUNK_SIZE) < 0)
+	{
+		perror("writeParticleFile");
+		return EXIT_FAILURE;
+	}
+	gettimeofday(&stop, NULL);
+	double writeTime = elapsed(&start, &stop);
+
+	gettimeofday(&start, NULL);
+	if (openParticleFile(&pf, path) < 0 || computeForcesOutOfCore(&pf, maxResident, FAR_FIELD_LIMIT, &stats) < 0)
+	{
+		perror("computeForcesOutOfCore");
+		return EXIT_FAILURE;
+	}
+	gettimeofday(&stop, NULL);
+	double forcesTime = elapsed(&start, &stop);
+	closeParticleFile(&pf);
+
+	printf("# Nb of particles, Quadtree height, writing time, multipoles and forces time (seconds), "
+		   "nb of windows, max particles in memory, particles read by the forces pass\n"
+		   "%ld %d %e %e %d %ld %ld\n\n", nbParticles, height, writeTime, forcesTime, 
+		   stats.nbWindows, (long)stats.maxResident, (long)(stats.bytesRead / (3 * sizeof(double))));
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,107 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "Generator.h"
+#include "Quadtree.h"
+#include "Service.h"
+
+#define FAR_FIELD_LIMIT 0.707
+
+static double elapsed(struct timeval *start, struct timeval *stop)
+{
+	return stop->tv_sec - start->tv_sec + 0.000001 * (stop->tv_usec - start->tv_usec);
+}
+
+int main(int argc, char const *argv[])
+{
+	if (argc != 4)
+	{
+		printf("Usage: %s nbParticles treeHeight nbRequests\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	int nbParticles = atoi(argv[1]);
+	int height = atoi(argv[2]);
+	int nbRequests = atoi(argv[3]);
+	char socketPath[64], segmentName[64];
+	snprintf(socketPath, sizeof(socketPath), "/tmp/benchService.%d", (int)getpid());
+	snprintf(segmentName, sizeof(segmentName), "/benchService.%d", (int)getpid());
+
+	// the service is forked before the first parallel region of the client
+	Service sv;
+	if (initService(&sv, socketPath, segmentName, nbParticles) < 0)
+	{
+		perror("initService");
+		return EXIT_FAILURE;
+	}
+	pid_t pid = fork();
+	if (pid == 0)
+	{
+		int status = runService(&sv);
+		freeService(&sv);
+		exit((status < 0) ? EXIT_FAILURE : EXIT_SUCCESS);
+	}
+
+	ServiceClient cl;
+	if (openServiceClient(&cl, socketPath, segmentName) < 0)
+	{
+		perror("openServiceClient");
+		return EXIT_FAILURE;
+	}
+
+	printf("# Benching the resident service vs one fresh solver per request, Plummer systems\n"
+		   "%d requests of %d particles, trees of height %d\n", nbRequests, nbParticles, height);
+
+	Generator gen;
+	initGenerator(&gen, PLUMMER_DISTRIBUTION, 42, 1e30, 1e32, 0, 1e17, 0, 1e17);
+	struct timeval start, stop;
+
+	// a fresh solver per request: particles, tree and buffers
+	gettimeofday(&start, NULL);
+	for (int r = 0; r < nbRequests; r++)
+	{
+		Quadtree qt;
+		gen.stream = r;
+		initQuadtreeGenerator(&qt, MORTON_CURVE, height, nbParticles, &gen);
+		computeMultipoles(&qt);
+		computeForces(&qt, FAR_FIELD_LIMIT);
+		freeQuadtree(&qt);
+	}
+	gettimeofday(&stop, NULL);
+	double freshTime = elapsed(&start, &stop) / nbRequests;
+
+	// the same requests to the service, the particles being generated in the segment
+	double serviceTime = 0, generationTime = 0;
+	for (int r = 0; r < nbRequests; r++)
+	{
+		gen.stream = r;
+		gettimeofday(&start, NULL);
+		generateParticles(&gen, 0, nbParticles, cl.m, cl.x, cl.y);
+		gettimeofday(&stop, NULL);
+		generationTime += elapsed(&start, &stop);
+
+		gettimeofday(&start, NULL);
+		ServiceReply reply = requestForces(&cl, nbParticles, MORTON_CURVE, height, 
+										   gen.xMin, gen.xMax, gen.yMin, gen.yMax, FAR_FIELD_LIMIT);
+		gettimeofday(&stop, NULL);
+		if (reply.status < 0)
+		{
+			printf("Request %d failed\n", r);
+			return EXIT_FAILURE;
+		}
+		serviceTime += elapsed(&start, &stop);
+	}
+
+	stopService(&cl);
+	closeServiceClient(&cl);
+	waitpid(pid, NULL, 0);
+
+	printf("# Nb of particles, Quadtree height, time per fresh request, time per service request "
+		   "(generation excluded), generation time per request (seconds)\n"
+		   "%d %d %e %e %e\n\n", nbParticles, height, freshTime, 
+		   serviceTime / nbRequests, generationTime / nbRequests);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,94 @@
+#include <math.h>
+#include <mpi.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "Quadtree.h"
+#include "SharedTree.h"
+
+#define FAR_FIELD_LIMIT 0.707
+
+int main(int argc, char const *argv[])
+{
+	MPI_Init(NULL, NULL);
+	int rank, size;
+	MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+	MPI_Comm_size(MPI_COMM_WORLD, &size);
+
+	if (argc != 3 && argc != 4)
+	{
+		if (rank == 0)
+			printf("Usage: %s nbParticles treeHeight [ranksPerNode]\n", argv[0]);
+		MPI_Finalize();
+		return EXIT_FAILURE;
+	}
+
+	int nbParticles = atoi(argv[1]);
+	int height = atoi(argv[2]);
+
+	// only the leader of each node builds the quadtree. With ranksPerNode, the ranks of a node
+	// are split into several simulated nodes
+	Quadtree qt;
+	SharedQuadtree sq;
+	int nodeRank;
+	MPI_Comm nodeComm;
+	MPI_Comm_split_type(MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, 0, MPI_INFO_NULL, &nodeComm);
+	MPI_Comm_rank(nodeComm, &nodeRank);
+	if (argc == 4)
+	{
+		MPI_Comm sharedComm = nodeComm;
+		MPI_Comm_split(sharedComm, nodeRank / atoi(argv[3]), 0, &nodeComm);
+		MPI_Comm_free(&sharedComm);
+		MPI_Comm_rank(nodeComm, &nodeRank);
+	}
+	if (nodeRank == 0)
+	{
+		srand(42);
+		initQuadtree(&qt, height, nbParticles, nbParticles, 1e30, 1e32, 0, 1e17, 0, 1e17);
+	}
+
+	double start = MPI_Wtime();
+	shareQuadtree(&qt, &sq, nodeComm);
+	double shareTime = MPI_Wtime() - start;
+
+	start = MPI_Wtime();
+	computeMultipolesShared(&qt, &sq);
+	double multipoleTime = MPI_Wtime() - start;
+
+	start = MPI_Wtime();
+	computeForcesShared(&qt, &sq, FAR_FIELD_LIMIT);
+	double interactionTime = MPI_Wtime() - start;
+
+	int nbNodes = 0;
+	if (sq.leadersComm != MPI_COMM_NULL)
+		MPI_Comm_size(sq.leadersComm, &nbNodes);
+	MPI_Bcast(&nbNodes, 1, MPI_INT, 0, MPI_COMM_WORLD);
+
+	// the forces must be the ones of computeForces on a private copy
+	double maxDiff = 0;
+	if (rank == 0)
+	{
+		Quadtree reference;
+		srand(42);
+		initQuadtree(&reference, height, nbParticles, nbParticles, 1e30, 1e32, 0, 1e17, 0, 1e17);
+		computeMultipoles(&reference);
+		computeForces(&reference, FAR_FIELD_LIMIT);
+		for (int i = 0; i < qt.nbCells; i++)
+			for (int j = 0; j < qt.cells[i].nbParticles; j++)
+				maxDiff = fmax(maxDiff, fmax(fabs(qt.cells[i].fx[j] - reference.cells[i].fx[j]),
+											 fabs(qt.cells[i].fy[j] - reference.cells[i].fy[j])));
+		freeQuadtree(&reference);
+
+		printf("# Benching the distributed force pass with the quadtree shared by the ranks of each node\n"
+			   "%d particles, tree of height %d, %d ranks on %d nodes\n"
+			   "# Window bytes per node, private bytes per rank, sharing time, multipole computation time, "
+			   "interaction computation time (seconds), max difference vs computeForces\n"
+			   "%ld %ld %e %e %e %e\n\n", nbParticles, height, size, nbNodes, sq.windowSize,
+			   (long)(qt.nbCells * sizeof(Cell)), shareTime, multipoleTime, interactionTime, maxDiff);
+	}
+
+	freeSharedQuadtree(&qt, &sq);
+	MPI_Comm_free(&nodeComm);
+	MPI_Finalize();
+	return EXIT_SUCCESS;
+}
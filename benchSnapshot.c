@@ -0,0 +1,89 @@
+#include <omp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "Quadtree.h"
+#include "Snapshot.h"
+
+#define FAR_FIELD_LIMIT 0.707
+
+static const char *encodingNames[] = {"double", "quantized32", "quantized16"};
+
+// Run nbSteps steps, each one writing a snapshot of the previous one in dir, and flushing it
+// before the next step if synchronous. Returns the time of the steps
+static double runSteps(Quadtree *qt, int nbSteps, const char *dir, HaloEncoding encoding,
+					   int synchronous, SnapshotStats *stats)
+{
+	SnapshotWriter sw;
+	char path[4096];
+	if (initSnapshotWriter(&sw, encoding, (size_t)1 << 40) != 0)
+	{
+		perror("initSnapshotWriter");
+		exit(EXIT_FAILURE);
+	}
+
+	double start = omp_get_wtime();
+	for (int step = 0; step < nbSteps; step++)
+	{
+		computeMultipoles(qt);
+		computeForces(qt, FAR_FIELD_LIMIT);
+
+		snprintf(path, sizeof(path), "%s/snapshot.%d", dir, step % 2);
+		if (writeSnapshot(&sw, qt, path) != 0 || (synchronous && flushSnapshotWriter(&sw) != 0))
+		{
+			perror("writeSnapshot");
+			exit(EXIT_FAILURE);
+		}
+	}
+	if (freeSnapshotWriter(&sw) != 0)
+	{
+		perror("freeSnapshotWriter");
+		exit(EXIT_FAILURE);
+	}
+	*stats = sw.stats;
+
+	for (int i = 0; i < 2; i++)
+	{
+		snprintf(path, sizeof(path), "%s/snapshot.%d", dir, i);
+		unlink(path);
+	}
+	return omp_get_wtime() - start;
+}
+
+int main(int argc, char const *argv[])
+{
+	if (argc != 5)
+	{
+		printf("Usage: %s nbParticles treeHeight nbSteps directory\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	int nbParticles = atoi(argv[1]);
+	int height = atoi(argv[2]);
+	int nbSteps = atoi(argv[3]);
+	Quadtree qt;
+
+	srand(42);
+	initQuadtree(&qt, height, nbParticles, nbParticles, 1e30, 1e32, 0, 1e17, 0, 1e17);
+
+	printf("# Benching the snapshots of each step, written asynchronously VS synchronously\n"
+		   "%d particles, tree of height %d, %d steps, in %s\n"
+		   "# Encoding, mode, bytes per snapshot, time of the steps, encoding time, "
+		   "waiting time for a buffer, writing time (seconds)\n", nbParticles, height, nbSteps, argv[4]);
+
+	for (int encoding = HALO_DOUBLE; encoding <= HALO_QUANTIZED_16; encoding++)
+		for (int synchronous = 1; synchronous >= 0; synchronous--)
+		{
+			SnapshotStats stats;
+			double seconds = runSteps(&qt, nbSteps, argv[4], encoding, synchronous, &stats);
+			printf("%s %s %ld %e %e %e %e\n", encodingNames[encoding], synchronous ? "sync" : "async",
+				   stats.bytes / stats.nbSnapshots, seconds, stats.encodeSeconds, stats.waitSeconds,
+				   stats.writeSeconds);
+		}
+	printf("\n");
+
+	freeQuadtree(&qt);
+	return EXIT_SUCCESS;
+}
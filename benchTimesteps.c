@@ -0,0 +1,53 @@
+#include <sys/time.h>
+#include <stdlib.h>
+
+#include "Quadtree.h"
+#include "Timesteps.h"
+
+#define FAR_FIELD_LIMIT 0.707
+
+int main(int argc, char const *argv[])
+{
+	if (argc != 5 && argc != 6)
+	{
+		printf("Usage: %s nbParticles treeHeight maxLevel nbTicks [eps]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	int nbParticles = atoi(argv[1]);
+	int height = atoi(argv[2]);
+	int maxLevel = atoi(argv[3]);
+	int nbTicks = atoi(argv[4]);
+	double eps = (argc == 6) ? atof(argv[5]) : 1e18;
+	Quadtree qt;
+	BlockTimesteps bt;
+	struct timeval start, stop;
+
+	printf("# Benching hierarchical block timesteps, active cells in parallel\n"
+		   "%d particles, tree of height %d, %d levels\n", nbParticles, height, maxLevel + 1);
+
+	srand(42);
+	initQuadtree(&qt, height, nbParticles, nbParticles, 1e30, 1e32, 0, 1e17, 0, 1e17);
+	initBlockTimesteps(&bt, &qt, 1e12, maxLevel, 0.025, eps);
+
+	gettimeofday(&start, NULL);
+	blockStep(&qt, &bt, FAR_FIELD_LIMIT);
+	gettimeofday(&stop, NULL);
+	double firstTime = stop.tv_sec - start.tv_sec + 0.000001 * (stop.tv_usec - start.tv_usec);
+	printf("# First tick, all the particles (seconds)\n%e\n", firstTime);
+
+	printf("# Tick, active cells, kicked particles, time (seconds)\n");
+	for (int t = 1; t < nbTicks; t++)
+	{
+		gettimeofday(&start, NULL);
+		long nbKicked = blockStep(&qt, &bt, FAR_FIELD_LIMIT);
+		gettimeofday(&stop, NULL);
+		double time = stop.tv_sec - start.tv_sec + 0.000001 * (stop.tv_usec - start.tv_usec);
+		printf("%ld %d %ld %e\n", bt.tick, bt.nbActiveCells, nbKicked, time);
+	}
+	printf("\n");
+
+	freeBlockTimesteps(&bt);
+	freeQuadtree(&qt);
+	return EXIT_SUCCESS;
+}
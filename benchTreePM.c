@@ -0,0 +1,69 @@
+#include <string.h>
+#include <sys/time.h>
+#include <stdlib.h>
+
+#include "Cell.h"
+#include "Direct.h"
+#include "Quadtree.h"
+#include "TreePM.h"
+
+#define FAR_FIELD_LIMIT 0.707
+#define NB_ERROR_SAMPLES 400
+
+// private
+
+static void clearForces(Quadtree *qt)
+{
+	for (int cellNo = 0; cellNo < qt->nbCells; cellNo++)
+	{
+		Cell *c = qt->cells + cellNo;
+		memset(c->fx, 0, c->nbParticles * sizeof(double));
+		memset(c->fy, 0, c->nbParticles * sizeof(double));
+	}
+}
+
+int main(int argc, char const *argv[])
+{
+	if (argc != 4 && argc != 5)
+	{
+		printf("Usage: %s nbParticles treeHeight gridSize [cic|tsc]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	int nbParticles = atoi(argv[1]);
+	int height = atoi(argv[2]);
+	int gridSize = atoi(argv[3]);
+	MassAssignment assignment = (argc == 5 && strcmp(argv[4], "tsc") == 0) ? TSC : CIC;
+	Quadtree qt;
+	TreePM pm;
+	ErrorEstimate treeErr, treePMErr;
+	struct timeval start, stop;
+
+	printf("# Benching TreePM (%s mesh of %d²) vs barnes-hut like method, cells in parallel\n"
+		   "%d particles, tree of height %d\n", (assignment == CIC) ? "CIC" : "TSC", gridSize, 
+		   nbParticles, height);
+
+	srand(42);
+	initQuadtree(&qt, height, nbParticles, nbParticles, 1e30, 1e32, 0, 1e17, 0, 1e17);
+	computeMultipoles(&qt);
+
+	gettimeofday(&start, NULL);
+	computeForces(&qt, FAR_FIELD_LIMIT);
+	gettimeofday(&stop, NULL);
+	double treeTime = stop.tv_sec - start.tv_sec + 0.000001 * (stop.tv_usec - start.tv_usec);
+	sampleRelativeErrors(qt.nbCells, qt.cells, NB_ERROR_SAMPLES, 42, &treeErr);
+
+	clearForces(&qt);
+	initTreePM(&pm, &qt, gridSize, assignment);
+	computeForcesTreePM(&qt, &pm, FAR_FIELD_LIMIT);
+	sampleRelativeErrors(qt.nbCells, qt.cells, NB_ERROR_SAMPLES, 42, &treePMErr);
+
+	printf("# Nb of particles, Quadtree height, grid size, tree time, TreePM mesh time, TreePM short-range tree time (seconds), "
+		   "sampled median relative errors of tree and TreePM\n"
+		   "%d %d %d %e %e %e %e %e\n\n", nbParticles, height, gridSize, treeTime, pm.pmTime, pm.treeTime,
+		   treeErr.quantiles[2], treePMErr.quantiles[2]);
+
+	freeTreePM(&pm);
+	freeQuadtree(&qt);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,468 @@
+// Python binding of the solver: the quadtree, its multipoles, forces and field, and the kernels,
+// on any contiguous float64 buffer (NumPy arrays, array.array('d'), memoryviews...).
+// The particle data is never copied: the quadtree is a view on the arrays of the caller, sorted
+// by cell beforehand by sort_particles, and the forces are added to its arrays.
+// The GIL is released during the computations. See python/example.py
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+#include <string.h>
+
+#include "../Cell.h"
+#include "../Quadtree.h"
+
+#define FAR_FIELD_LIMIT 0.707
+
+// Private
+
+// Whether the buffer format is the single native type t ('d' or 'i'): "t", "@t", "=t", or "<t"
+// (">t") on little-endian (big-endian) hosts, as exported by NumPy, array, ctypes or struct
+static int isNativeFormat(const char *format, char t)
+{
+#if PY_LITTLE_ENDIAN
+	const char order = '<';
+#else
+	const char order = '>';
+#endif
+	if (format[0] == '@' || format[0] == '=' || format[0] == order)
+		format++;
+	return format[0] == t && format[1] == '\0';
+}
+
+// Get the contiguous buffer of doubles obj, writable if specified. Returns 0, or -1 with an exception
+static int getDoubles(PyObject *obj, Py_buffer *view, int writable, const char *name)
+{
+	int flags = PyBUF_C_CONTIGUOUS | PyBUF_FORMAT | (writable ? PyBUF_WRITABLE : 0);
+	if (PyObject_GetBuffer(obj, view, flags) < 0)
+		return -1;
+	if (view->ndim != 1 || view->itemsize != sizeof(double) || !isNativeFormat(view->format, 'd'))
+	{
+		PyBuffer_Release(view);
+		PyErr_Format(PyExc_TypeError, "%s must be a 1D contiguous float64 array", name);
+		return -1;
+	}
+	return 0;
+}
+
+// Get nbArrays buffers of doubles of the same length, the last nbWritable ones writable.
+// Returns their length, or -1 with an exception, the buffers being released
+static Py_ssize_t getParticles(int nbArrays, int nbWritable, PyObject **objs, Py_buffer *views,
+							   const char **names)
+{
+	for (int i = 0; i < nbArrays; i++)
+	{
+		if (getDoubles(objs[i], views + i, i >= nbArrays - nbWritable, names[i]) < 0
+			|| (i > 0 && views[i].shape[0] != views[0].shape[0]))
+		{
+			if (!PyErr_Occurred())
+				PyErr_Format(PyExc_ValueError, "%s must have the length of %s", names[i], names[0]);
+			else
+				i--;
+			for (int k = 0; k <= i; k++)
+				PyBuffer_Release(views + k);
+			return -1;
+		}
+	}
+	if (views[0].shape[0] > INT_MAX)
+	{
+		for (int k = 0; k < nbArrays; k++)
+			PyBuffer_Release(views + k);
+		PyErr_SetString(PyExc_OverflowError, "too many particles");
+		return -1;
+	}
+	return views[0].shape[0];
+}
+
+static void releaseParticles(int nbArrays, Py_buffer *views)
+{
+	for (int k = 0; k < nbArrays; k++)
+		PyBuffer_Release(views + k);
+}
+
+static int parseCurve(const char *name, SpaceFillingCurve *curve)
+{
+	if (strcmp(name, "morton") == 0)
+		*curve = MORTON_CURVE;
+	else if (strcmp(name, "hilbert") == 0)
+		*curve = HILBERT_CURVE;
+	else
+	{
+		PyErr_Format(PyExc_ValueError, "unknown curve '%s', 'morton' or 'hilbert'", name);
+		return -1;
+	}
+	return 0;
+}
+
+static int checkHeight(int height)
+{
+	if (height < 1 || height > 15)
+	{
+		PyErr_SetString(PyExc_ValueError, "height must be in [1, 15]");
+		return -1;
+	}
+	return 0;
+}
+
+// Quadtree type: a Quadtree on the buffers m, x, y, fx and fy it holds
+
+typedef struct
+{
+	PyObject_HEAD
+	Quadtree qt;
+	int built;
+	int nbParticles;
+	Py_buffer views[5];
+} QuadtreeObject;
+
+static int Quadtree_init(QuadtreeObject *self, PyObject *args, PyObject *kwds)
+{
+	static char *keywords[] = {"m", "x", "y", "fx", "fy", "height", "x_min", "x_max", "y_min", "y_max",
+							   "curve", NULL};
+	static const char *names[] = {"m", "x", "y", "fx", "fy"};
+	PyObject *objs[5];
+	int height;
+	double xMin, xMax, yMin, yMax;
+	const char *curveName = "morton";
+	SpaceFillingCurve curve;
+
+	if (self->built)
+	{
+		PyErr_SetString(PyExc_RuntimeError, "Quadtree already initialised");
+		return -1;
+	}
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "OOOOOidddd|s", keywords, objs, objs+1, objs+2, objs+3,
+									 objs+4, &height, &xMin, &xMax, &yMin, &yMax, &curveName)
+		|| parseCurve(curveName, &curve) < 0 || checkHeight(height) < 0)
+		return -1;
+
+	Py_ssize_t n = getParticles(5, 2, objs, self->views, names);
+	if (n < 0)
+		return -1;
+
+	int status;
+	Py_BEGIN_ALLOW_THREADS
+	status = initQuadtreeArrays(&self->qt, curve, height, n, self->views[0].buf, self->views[1].buf,
+								self->views[2].buf, self->views[3].buf, self->views[4].buf,
+								xMin, xMax, yMin, yMax);
+	Py_END_ALLOW_THREADS
+	if (status < 0)
+	{
+		releaseParticles(5, self->views);
+		PyErr_SetString(PyExc_ValueError, "the particles are not sorted by cell, see sort_particles");
+		return -1;
+	}
+
+	self->nbParticles = n;
+	self->built = 1;
+	return 0;
+}
+
+static void Quadtree_dealloc(QuadtreeObject *self)
+{
+	if (self->built)
+	{
+		freeQuadtree(&self->qt);
+		releaseParticles(5, self->views);
+	}
+	Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+static int checkBuilt(QuadtreeObject *self)
+{
+	if (!self->built)
+	{
+		PyErr_SetString(PyExc_RuntimeError, "Quadtree not initialised");
+		return -1;
+	}
+	return 0;
+}
+
+static PyObject *Quadtree_computeMultipoles(QuadtreeObject *self, PyObject *unused)
+{
+	if (checkBuilt(self) < 0)
+		return NULL;
+
+	Py_BEGIN_ALLOW_THREADS
+	computeMultipoles(&self->qt);
+	Py_END_ALLOW_THREADS
+	Py_RETURN_NONE;
+}
+
+static PyObject *Quadtree_computeForces(QuadtreeObject *self, PyObject *args, PyObject *kwds)
+{
+	static char *keywords[] = {"far_field_limit", NULL};
+	double farFieldLimit = FAR_FIELD_LIMIT;
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "|d", keywords, &farFieldLimit) || checkBuilt(self) < 0)
+		return NULL;
+
+	Py_BEGIN_ALLOW_THREADS
+	computeForces(&self->qt, farFieldLimit);
+	Py_END_ALLOW_THREADS
+	Py_RETURN_NONE;
+}
+
+static PyObject *Quadtree_computeField(QuadtreeObject *self, PyObject *args, PyObject *kwds)
+{
+	static char *keywords[] = {"x", "y", "gx", "gy", "pot", "far_field_limit", NULL};
+	static const char *names[] = {"x", "y", "gx", "gy", "pot"};
+	PyObject *objs[5] = {NULL, NULL, NULL, NULL, Py_None};
+	Py_buffer views[5];
+	double farFieldLimit = FAR_FIELD_LIMIT;
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "OOOO|Od", keywords, objs, objs+1, objs+2, objs+3,
+									 objs+4, &farFieldLimit) || checkBuilt(self) < 0)
+		return NULL;
+
+	int nbArrays = (objs[4] == Py_None) ? 4 : 5;
+	Py_ssize_t n = getParticles(nbArrays, nbArrays - 2, objs, views, names);
+	if (n < 0)
+		return NULL;
+
+	Py_BEGIN_ALLOW_THREADS
+	computeField(&self->qt, n, views[0].buf, views[1].buf, views[2].buf, views[3].buf,
+				 (nbArrays == 5) ? views[4].buf : NULL, farFieldLimit);
+	Py_END_ALLOW_THREADS
+
+	releaseParticles(nbArrays, views);
+	Py_RETURN_NONE;
+}
+
+static PyObject *Quadtree_getHeight(QuadtreeObject *self, void *closure)
+{
+	return checkBuilt(self) < 0 ? NULL : PyLong_FromLong(self->qt.height);
+}
+
+static PyObject *Quadtree_getNbCells(QuadtreeObject *self, void *closure)
+{
+	return checkBuilt(self) < 0 ? NULL : PyLong_FromLong(self->qt.nbCells);
+}
+
+static PyObject *Quadtree_getNbParticles(QuadtreeObject *self, void *closure)
+{
+	return checkBuilt(self) < 0 ? NULL : PyLong_FromLong(self->nbParticles);
+}
+
+static PyMethodDef Quadtree_methods[] = {
+	{"compute_multipoles", (PyCFunction)Quadtree_computeMultipoles, METH_NOARGS,
+	 "Compute the multipoles of the quadtree, after each change of the particles."},
+	{"compute_forces", (PyCFunction)Quadtree_computeForces, METH_VARARGS | METH_KEYWORDS,
+	 "compute_forces(far_field_limit=0.707)\n\n"
+	 "Add the gravitational forces on the particles to fx and fy. The multipoles must have been computed."},
+	{"compute_field", (PyCFunction)Quadtree_computeField, METH_VARARGS | METH_KEYWORDS,
+	 "compute_field(x, y, gx, gy, pot=None, far_field_limit=0.707)\n\n"
+	 "Write the gravitational field of the particles at the probes (x, y) in gx and gy, "
+	 "and the potential per unit mass in pot if given. The multipoles must have been computed."},
+	{NULL}
+};
+
+static PyGetSetDef Quadtree_getset[] = {
+	{"height", (getter)Quadtree_getHeight, NULL, "height of the quadtree", NULL},
+	{"nb_cells", (getter)Quadtree_getNbCells, NULL, "number of cells", NULL},
+	{"nb_particles", (getter)Quadtree_getNbParticles, NULL, "number of particles", NULL},
+	{NULL}
+};
+
+static PyTypeObject QuadtreeType = {
+	PyVarObject_HEAD_INIT(NULL, 0)
+	.tp_name = "barneshut.Quadtree",
+	.tp_doc = "Quadtree(m, x, y, fx, fy, height, x_min, x_max, y_min, y_max, curve='morton')\n\n"
+			  "Quadtree on the particles (m, x, y), sorted by cell by sort_particles, without copying them.\n"
+			  "The arrays are held by the quadtree, and the forces are added to fx and fy.",
+	.tp_basicsize = sizeof(QuadtreeObject),
+	.tp_flags = Py_TPFLAGS_DEFAULT,
+	.tp_new = PyType_GenericNew,
+	.tp_init = (initproc)Quadtree_init,
+	.tp_dealloc = (destructor)Quadtree_dealloc,
+	.tp_methods = Quadtree_methods,
+	.tp_getset = Quadtree_getset,
+};
+
+// Module functions
+
+static PyObject *sortParticlesPy(PyObject *module, PyObject *args, PyObject *kwds)
+{
+	static char *keywords[] = {"m", "x", "y", "height", "x_min", "x_max", "y_min", "y_max", "curve",
+							   "order", NULL};
+	static const char *names[] = {"m", "x", "y"};
+	PyObject *objs[3], *orderObj = Py_None;
+	Py_buffer views[3], orderView;
+	int height;
+	double xMin, xMax, yMin, yMax;
+	const char *curveName = "morton";
+	SpaceFillingCurve curve;
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "OOOidddd|sO", keywords, objs, objs+1, objs+2, &height,
+									 &xMin, &xMax, &yMin, &yMax, &curveName, &orderObj)
+		|| parseCurve(curveName, &curve) < 0 || checkHeight(height) < 0)
+		return NULL;
+
+	Py_ssize_t n = getParticles(3, 3, objs, views, names);
+	if (n < 0)
+		return NULL;
+
+	int *order = NULL;
+	if (orderObj != Py_None)
+	{
+		if (PyObject_GetBuffer(orderObj, &orderView, PyBUF_C_CONTIGUOUS | PyBUF_FORMAT | PyBUF_WRITABLE) < 0)
+		{
+			releaseParticles(3, views);
+			return NULL;
+		}
+		if (orderView.ndim != 1 || orderView.itemsize != sizeof(int) || orderView.shape[0] != n
+			|| !isNativeFormat(orderView.format, 'i'))
+		{
+			PyBuffer_Release(&orderView);
+			releaseParticles(3, views);
+			PyErr_SetString(PyExc_TypeError, "order must be a 1D contiguous int32 array of the length of m");
+			return NULL;
+		}
+		order = orderView.buf;
+	}
+
+	Py_BEGIN_ALLOW_THREADS
+	sortParticles(curve, height, xMin, xMax, yMin, yMax, n, views[0].buf, views[1].buf, views[2].buf, order);
+	Py_END_ALLOW_THREADS
+
+	if (order != NULL)
+		PyBuffer_Release(&orderView);
+	releaseParticles(3, views);
+	Py_RETURN_NONE;
+}
+
+static PyObject *P2PinPy(PyObject *module, PyObject *args)
+{
+	static const char *names[] = {"m", "x", "y", "fx", "fy"};
+	PyObject *objs[5];
+	Py_buffer views[5];
+	if (!PyArg_ParseTuple(args, "OOOOO", objs, objs+1, objs+2, objs+3, objs+4))
+		return NULL;
+	Py_ssize_t n = getParticles(5, 2, objs, views, names);
+	if (n < 0)
+		return NULL;
+
+	Py_BEGIN_ALLOW_THREADS
+	Cell c;
+	WorkingVecs wv;
+	initWorkingVecs(&wv);
+	c.nbParticles = n;
+	c.m = views[0].buf; c.x = views[1].buf; c.y = views[2].buf;
+	c.fx = views[3].buf; c.fy = views[4].buf;
+	c.pot = NULL;
+	P2P_in(&c, &wv);
+	freeWorkingVecs(&wv);
+	Py_END_ALLOW_THREADS
+
+	releaseParticles(5, views);
+	Py_RETURN_NONE;
+}
+
+static PyObject *P2PextPy(PyObject *module, PyObject *args)
+{
+	static const char *names1[] = {"m1", "x1", "y1"}, *names2[] = {"m2", "x2", "y2", "fx2", "fy2"};
+	PyObject *objs[8];
+	Py_buffer views[8];
+	if (!PyArg_ParseTuple(args, "OOOOOOOO", objs, objs+1, objs+2, objs+3, objs+4, objs+5, objs+6, objs+7))
+		return NULL;
+	Py_ssize_t n1 = getParticles(3, 0, objs, views, names1);
+	if (n1 < 0)
+		return NULL;
+	Py_ssize_t n2 = getParticles(5, 2, objs + 3, views + 3, names2);
+	if (n2 < 0)
+	{
+		releaseParticles(3, views);
+		return NULL;
+	}
+
+	Py_BEGIN_ALLOW_THREADS
+	Cell c1, c2;
+	WorkingVecs wv;
+	initWorkingVecs(&wv);
+	c1.nbParticles = n1;
+	c1.m = views[0].buf; c1.x = views[1].buf; c1.y = views[2].buf;
+	c1.pot = NULL;
+	c2.nbParticles = n2;
+	c2.m = views[3].buf; c2.x = views[4].buf; c2.y = views[5].buf;
+	c2.fx = views[6].buf; c2.fy = views[7].buf;
+	c2.pot = NULL;
+	P2P_ext(&c1, &c2, &wv);
+	freeWorkingVecs(&wv);
+	Py_END_ALLOW_THREADS
+
+	releaseParticles(8, views);
+	Py_RETURN_NONE;
+}
+
+static PyObject *M2PPy(PyObject *module, PyObject *args)
+{
+	static const char *names[] = {"m", "x", "y", "fx", "fy"};
+	PyObject *objs[5];
+	Py_buffer views[5];
+	double mass, xC, yC;
+	if (!PyArg_ParseTuple(args, "dddOOOOO", &mass, &xC, &yC, objs, objs+1, objs+2, objs+3, objs+4))
+		return NULL;
+	Py_ssize_t n = getParticles(5, 2, objs, views, names);
+	if (n < 0)
+		return NULL;
+
+	Py_BEGIN_ALLOW_THREADS
+	Cell c;
+	Multipole mp;
+	WorkingVecs wv;
+	initWorkingVecs(&wv);
+	initMultipole(&mp, mass, xC, yC, xC, xC, yC, yC);
+	c.nbParticles = n;
+	c.m = views[0].buf; c.x = views[1].buf; c.y = views[2].buf;
+	c.fx = views[3].buf; c.fy = views[4].buf;
+	c.pot = NULL;
+	M2P(&mp, &c, &wv);
+	freeWorkingVecs(&wv);
+	Py_END_ALLOW_THREADS
+
+	releaseParticles(5, views);
+	Py_RETURN_NONE;
+}
+
+static PyMethodDef barneshutMethods[] = {
+	{"sort_particles", (PyCFunction)sortParticlesPy, METH_VARARGS | METH_KEYWORDS,
+	 "sort_particles(m, x, y, height, x_min, x_max, y_min, y_max, curve='morton', order=None)\n\n"
+	 "Sort in place the particles (m, x, y) by cell of a quadtree, as expected by Quadtree. "
+	 "order, an int32 array, receives the initial index of each particle."},
+	{"p2p_in", P2PinPy, METH_VARARGS,
+	 "p2p_in(m, x, y, fx, fy)\n\nAdd the forces of the particles on each other to fx and fy."},
+	{"p2p_ext", P2PextPy, METH_VARARGS,
+	 "p2p_ext(m1, x1, y1, m2, x2, y2, fx2, fy2)\n\n"
+	 "Add the forces of the particles 1 on the particles 2 to fx2 and fy2."},
+	{"m2p", M2PPy, METH_VARARGS,
+	 "m2p(mass, x_c, y_c, m, x, y, fx, fy)\n\n"
+	 "Add the forces of a center of mass at (x_c, y_c) on the particles to fx and fy."},
+	{NULL}
+};
+
+static struct PyModuleDef barneshutModule = {
+	PyModuleDef_HEAD_INIT,
+	.m_name = "barneshut",
+	.m_doc = "Barnes-Hut solver on float64 buffers, without copies.",
+	.m_size = -1,
+	.m_methods = barneshutMethods,
+};
+
+PyMODINIT_FUNC PyInit_barneshut(void)
+{
+	if (PyType_Ready(&QuadtreeType) < 0)
+		return NULL;
+
+	PyObject *module = PyModule_Create(&barneshutModule);
+	if (module == NULL)
+		return NULL;
+
+	Py_INCREF(&QuadtreeType);
+	if (PyModule_AddObject(module, "Quadtree", (PyObject *)&QuadtreeType) < 0
+		|| PyModule_AddObject(module, "G", PyFloat_FromDouble(G)) < 0)
+	{
+		Py_DECREF(&QuadtreeType);
+		Py_DECREF(module);
+		return NULL;
+	}
+	return module;
+}
@@ -0,0 +1,31 @@
+# Forces on uniform particles with the binding, against the direct sum of p2p_in.
+# Build it first with make python, then run python3 python/example.py
+import numpy as np
+
+import barneshut as bh
+
+n, height, side = 100000, 7, 1e17
+rng = np.random.default_rng(42)
+m = rng.uniform(1e30, 1e32, n)
+x = rng.uniform(0, side, n)
+y = rng.uniform(0, side, n)
+vx = rng.normal(0, 1e3, n)
+
+# sort the particles by cell in place, and the other arrays with them
+order = np.empty(n, dtype=np.int32)
+bh.sort_particles(m, x, y, height, 0, side, 0, side, order=order)
+vx = vx[order]
+
+fx, fy = np.zeros(n), np.zeros(n)
+tree = bh.Quadtree(m, x, y, fx, fy, height, 0, side, 0, side)
+tree.compute_multipoles()
+tree.compute_forces(far_field_limit=0.707)
+
+# direct sum on the first 1000 particles: the slices are views, not copies
+k = 1000
+dfx, dfy = np.zeros(k), np.zeros(k)
+bh.p2p_ext(m[k:], x[k:], y[k:], m[:k], x[:k], y[:k], dfx, dfy)
+bh.p2p_in(m[:k], x[:k], y[:k], dfx, dfy)
+err = np.hypot(fx[:k] - dfx, fy[:k] - dfy) / np.hypot(dfx, dfy)
+print("median relative error on %d particles: %e" % (k, np.median(err)))
+assert np.median(err) < 1e-2
@@ -0,0 +1,49 @@
+# Check of the binding, run by make python: the forces of the quadtree against the direct sum
+# of p2p_in, on array.array ("d") and ctypes ("<d", "<i") buffers. Needs no NumPy
+import array
+import ctypes
+import random
+import statistics
+
+import barneshut as bh
+
+n, height, side = 2000, 4, 1e17
+rnd = random.Random(42)
+m = array.array("d", (rnd.uniform(1e30, 1e32) for _ in range(n)))
+x = array.array("d", (rnd.uniform(0, side) for _ in range(n)))
+y = array.array("d", (rnd.uniform(0, side) for _ in range(n)))
+x0 = list(x)
+
+# sort the particles by cell, order being an explicit little-endian int32 buffer
+order = (ctypes.c_int32 * n)()
+bh.sort_particles(m, x, y, height, 0, side, 0, side, curve="hilbert", order=order)
+assert sorted(order) == list(range(n))
+assert all(x[i] == x0[order[i]] for i in range(n))
+
+# the forces of the tree in explicit little-endian float64 buffers
+fx, fy = (ctypes.c_double * n)(), (ctypes.c_double * n)()
+tree = bh.Quadtree(m, x, y, fx, fy, height, 0, side, 0, side, curve="hilbert")
+assert tree.nb_particles == n and tree.nb_cells == 4 ** (height - 1)
+tree.compute_multipoles()
+tree.compute_forces(far_field_limit=0.707)
+
+dfx, dfy = array.array("d", bytes(8 * n)), array.array("d", bytes(8 * n))
+bh.p2p_in(m, x, y, dfx, dfy)
+err = [abs(complex(fx[i] - dfx[i], fy[i] - dfy[i])) / abs(complex(dfx[i], dfy[i])) for i in range(n)]
+median = statistics.median(err)
+print("median relative error on %d particles: %e" % (n, median))
+assert median < 1e-2
+
+# without far field, the tree is the direct sum
+fx[:], fy[:] = [0.0] * n, [0.0] * n
+tree.compute_forces(far_field_limit=0)
+assert all(abs(fx[i] - dfx[i]) <= 1e-10 * abs(dfx[i]) for i in range(n))
+assert all(abs(fy[i] - dfy[i]) <= 1e-10 * abs(dfy[i]) for i in range(n))
+
+# big-endian buffers are rejected
+try:
+    bh.p2p_in(m, x, y, (ctypes.c_double.__ctype_be__ * n)(), dfy)
+    assert False
+except TypeError:
+    pass
+print("# Binding OK")
@@ -0,0 +1,31 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "Service.h"
+
+// Resident solver, see Service.h
+int main(int argc, char const *argv[])
+{
+	if (argc != 4)
+	{
+		printf("Usage: %s socketPath segmentName capacity\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	Service sv;
+	if (initService(&sv, argv[1], argv[2], atoi(argv[3])) < 0)
+	{
+		perror("initService");
+		return EXIT_FAILURE;
+	}
+
+	printf("# Serving on %s, segment %s of %d particles\n", argv[1], argv[2], atoi(argv[3]));
+	fflush(stdout);
+	int status = runService(&sv);
+	if (status < 0)
+		perror("runService");
+	printf("# %ld requests served\n", sv.nbRequests);
+
+	freeService(&sv);
+	return (status < 0) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -1,10 +1,32 @@
+#include "Analysis.h"
+#include "Backend.h"
 #include "Cell.h"
+#include "Direct.h"
+#include "Ewald.h"
+#include "Generator.h"
+#include "Halo.h"
+#include "Hilbert.h"
+#include "Morton.h"
+#include "Neighbours.h"
+#include "OutOfCore.h"
 #include "Quadtree.h"
+#include "Service.h"
+#include "SharedTree.h"
+#include "Snapshot.h"
+#include "Timesteps.h"
+#include "TreePM.h"
 #include "utils.h"
 
 #include <assert.h>
+#include <errno.h>
 #include <math.h>
+#include <mpi.h>
+#include <omp.h>
+#include <pthread.h>
+#include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
 
 #define EPS 1e-15
 #define FAR_FIELD_LIMIT 0.707
@@ -96,6 +118,113 @@ void testDistance()
 	printf("OK\n\n");
 }
 
+void testMorton()
+{
+	printf("Testing Morton batch encoding/decoding and neighbours: ");
+
+	int n = 1000;
+	uint32_t x[n], y[n], xDec[n], yDec[n];
+	uint64_t keys[n];
+	srand(42);
+	for (int i = 0; i < n; i++)
+	{
+		x[i] = ((uint32_t)rand() << 16) ^ rand();
+		y[i] = ((uint32_t)rand() << 16) ^ rand();
+	}
+
+	for (int b = 0; b < getNbBackends(); b++)
+	{
+		if (setBackend(getBackendNo(b)->name) != 0)
+			continue;
+
+		xy_to_morton_batch(n, x, y, keys);
+		morton_to_xy_batch(n, keys, xDec, yDec);
+		for (int i = 0; i < n; i++)
+		{
+			assert(keys[i] == xy_to_morton(x[i], y[i]) && keys[i] == xy_to_morton_generic(x[i], y[i]));
+			assert(xDec[i] == x[i] && yDec[i] == y[i]);
+			morton_to_xy(keys[i], xDec + i, yDec + i);
+			assert(xDec[i] == x[i] && yDec[i] == y[i]);
+		}
+	}
+	setBackend(NULL);
+
+	int level = 4, dim = 1 << level;
+	for (int cx = 0; cx < dim; cx++)
+		for (int cy = 0; cy < dim; cy++)
+			for (int dx = -2; dx <= 2; dx++)
+				for (int dy = -2; dy <= 2; dy++)
+				{
+					int nx = cx + dx, ny = cy + dy;
+					uint64_t expected = (nx < 0 || ny < 0 || nx >= dim || ny >= dim) ? NO_NEIGHBOUR 
+										: xy_to_morton(nx, ny);
+					assert(mortonNeighbour(xy_to_morton(cx, cy), dx, dy, level) == expected);
+				}
+
+	printf("OK\n\n");
+}
+
+void testHilbert()
+{
+	printf("Testing Hilbert encoding/decoding, neighbours and quadtree numbering: ");
+
+	int order = 5, dim = 1 << order, n = dim * dim;
+	uint32_t x[n], y[n], xDec[n], yDec[n];
+	uint64_t keys[n];
+	for (int i = 0; i < n; i++)
+	{
+		x[i] = i / dim;
+		y[i] = i % dim;
+	}
+	xy_to_hilbert_batch(n, x, y, order, keys);
+
+	int seen[n];
+	for (int i = 0; i < n; i++)
+		seen[i] = 0;
+	for (int i = 0; i < n; i++)
+	{
+		assert(keys[i] == xy_to_hilbert(x[i], y[i], order) && keys[i] < n);
+		seen[keys[i]]++;
+	}
+	for (int i = 0; i < n; i++)
+		assert(seen[i] == 1);
+
+	// consecutive keys are adjacent cells
+	for (int i = 0; i < n; i++)
+		keys[i] = i;
+	hilbert_to_xy_batch(n, keys, order, xDec, yDec);
+	for (int i = 1; i < n; i++)
+		assert(abs((int)xDec[i] - (int)xDec[i-1]) + abs((int)yDec[i] - (int)yDec[i-1]) == 1);
+
+	for (int i = 0; i < n; i++)
+		for (int dx = -1; dx <= 1; dx++)
+			for (int dy = -1; dy <= 1; dy++)
+			{
+				int nx = xDec[i] + dx, ny = yDec[i] + dy;
+				uint64_t expected = (nx < 0 || ny < 0 || nx >= dim || ny >= dim) ? NO_NEIGHBOUR 
+									: xy_to_hilbert(nx, ny, order);
+				assert(hilbertNeighbour(i, dx, dy, order) == expected);
+			}
+
+	// the 4 children of a vertex are consecutive cells
+	Quadtree qt;
+	srand(42);
+	initQuadtreeCurve(&qt, HILBERT_CURVE, 4, 640, 640, 1.0, 2.0, 0.0, 1.0, 0.0, 1.0);
+	for (int i = 0; i < qt.nbCells; i += 4)
+	{
+		Cell merged;
+		mergeCell(&merged, 4, qt.cells + i);
+		assert(fabs(merged.xMax - merged.xMin - 0.25) < EPS && fabs(merged.yMax - merged.yMin - 0.25) < EPS);
+		freeCell(&merged);
+	}
+	assert(quadtreeNeighbour(&qt, 0, -1, 0) == -1);
+	int right = quadtreeNeighbour(&qt, 0, 1, 0);
+	checkCell(qt.cells + right, 0.125, 0.25, 0.0, 0.125, EPS);
+	freeQuadtree(&qt);
+
+	printf("OK\n\n");
+}
+
 
 // REGRESSION TESTS
 
@@ -208,17 +337,1381 @@ void testBarnesHut()
 	freeQuadtree(&qt);
 }
 
+void testDirectSum()
+{
+	printf("Regression test 6, blocked parallel directSum vs P2P_inRef (10k particles):\n");
+
+	Cell c1, c2;
+	srand(42);
+	initCell(&c1, 10000, 10000, 1e30, 1e32, 0, 1e17, 0, 1e17);
+	srand(42);
+	initCell(&c2, 10000, 10000, 1e30, 1e32, 0, 1e17, 0, 1e17);
+
+	P2P_inRef(&c1);
+	directSum(&c2);
+
+	double minRE, maxRE, firstQRE, medianRE, thirdQRE;
+	computeRelativeErrors(&c1, 1, &c2, &minRE, &maxRE, &firstQRE, &medianRE, &thirdQRE);
+
+	printf("# Relative errors : min, 1st quartile, median, 3rd quartile, max\n");
+	printf("%e %e %e %e %e\n\n", minRE, firstQRE, medianRE, thirdQRE, maxRE);
+	assert(medianRE < 1e-14);
+
+	freeCell(&c1);
+	freeCell(&c2);
+}
+
+void testSampledErrors()
+{
+	srand(42);
+	printf("Regression test 7, sampled relative errors (1k samples) VS full comparison with "
+		   "P2P_inRef, Barnes-Hut like method on a 8x8 grid (10k particles):\n");
+
+	Cell cMerged;
+	Quadtree qt;
+	initQuadtree(&qt, 4, 10000, 10000, 1e30, 1e32, 0, 1e17, 0, 1e17);
+	mergeCell(&cMerged, qt.nbCells, qt.cells);
+
+	P2P_inRef(&cMerged);
+	computeMultipoles(&qt);
+	computeForces(&qt, FAR_FIELD_LIMIT);	
+
+	double minRE, maxRE, firstQRE, medianRE, thirdQRE;
+	computeRelativeErrors(&cMerged, qt.nbCells, qt.cells, &minRE, &maxRE, &firstQRE, &medianRE, &thirdQRE);
+
+	ErrorEstimate est;
+	sampleRelativeErrors(qt.nbCells, qt.cells, 1000, 42, &est);
+
+	printf("# Relative errors : min, 1st quartile, median, 3rd quartile, max\n");
+	printf("%e %e %e %e %e\n", minRE, firstQRE, medianRE, thirdQRE, maxRE);
+	printf("# Sampled relative errors [95%% confidence interval] : 1st quartile, median, 3rd quartile\n");
+	printf("%e [%e %e] %e [%e %e] %e [%e %e]\n\n", est.quantiles[1], est.lower[1], est.upper[1], 
+		   est.quantiles[2], est.lower[2], est.upper[2], est.quantiles[3], est.lower[3], est.upper[3]);
+
+	assert(est.lower[1] <= firstQRE && firstQRE <= est.upper[1]);
+	assert(est.lower[2] <= medianRE && medianRE <= est.upper[2]);
+	assert(est.lower[3] <= thirdQRE && thirdQRE <= est.upper[3]);
+
+	// no sample, then no particle: no estimate
+	sampleRelativeErrors(qt.nbCells, qt.cells, 0, 42, &est);
+	assert(est.nbSamples == 0 && isnan(est.quantiles[2]));
+	Cell empty;
+	initCell(&empty, 0, 0, 0, 0, 0, 0, 0, 0);
+	sampleRelativeErrors(1, &empty, 1000, 42, &est);
+	assert(est.nbSamples == 0 && isnan(est.lower[2]) && isnan(est.upper[2]));
+	freeCell(&empty);
+
+	freeCell(&cMerged);
+	freeQuadtree(&qt);
+}
+
+void testEnergy()
+{
+	srand(42);
+	printf("Regression test 8, potential energy and virial fused in the kernels, "
+		   "Barnes-Hut like method on a 4x4 grid VS directSum (10k particles):\n");
+
+	Cell cMerged;
+	Quadtree qt;
+	initQuadtree(&qt, 3, 10000, 10000, 1e30, 1e32, 0, 1e17, 0, 1e17);
+	mergeCell(&cMerged, qt.nbCells, qt.cells);
+
+	initPotential(&cMerged);
+	directSum(&cMerged);
+	double uRef = 0;
+	for (int i = 0; i < cMerged.nbParticles; i++)
+		uRef += 0.5 * cMerged.pot[i];
+
+	// exact pairwise virial: its trace is the potential energy
+	Cell cRef;
+	mergeCell(&cRef, qt.nbCells, qt.cells);
+	initPotential(&cRef);
+	P2P_inRef(&cRef);
+	assert(fabs(0.5 * (cRef.vir[0] + cRef.vir[2]) - uRef) < 1e-10 * fabs(uRef));
+
+	initQuadtreePotential(&qt);
+	computeMultipoles(&qt);
+	computeForces(&qt, FAR_FIELD_LIMIT);
+
+	double u, w[3];
+	int status = computeEnergy(&qt, &u, w);
+	assert(status == 0);
+
+	printf("# Potential energy: direct, tree, relative error; tree virial trace\n");
+	printf("%e %e %e %e\n\n", uRef, u, fabs(u - uRef) / fabs(uRef), w[0] + w[2]);
+	assert(fabs(u - uRef) < 1e-2 * fabs(uRef));
+
+	freeCell(&cMerged);
+	freeCell(&cRef);
+	freeQuadtree(&qt);
+}
+
+void testTreePM()
+{
+	srand(42);
+	printf("Regression test 9, TreePM (64x64 mesh, CIC and TSC) with a tree on a 8x8 grid "
+		   "VS P2P_inRef on one global cell (10k particles):\n");
+
+	Cell cMerged;
+	Quadtree qt;
+	initQuadtree(&qt, 4, 10000, 10000, 1e30, 1e32, 0, 1e17, 0, 1e17);
+	mergeCell(&cMerged, qt.nbCells, qt.cells);
+
+	P2P_inRef(&cMerged);
+	computeMultipoles(&qt);
+
+	printf("# Relative errors : min, 1st quartile, median, 3rd quartile, max\n");
+	for (MassAssignment a = CIC; a <= TSC; a++)
+	{
+		// the operators accumulate into the forces
+		for (int i = 0; i < qt.nbCells; i++)
+		{
+			memset(qt.cells[i].fx, 0, qt.cells[i].nbParticles * sizeof(double));
+			memset(qt.cells[i].fy, 0, qt.cells[i].nbParticles * sizeof(double));
+		}
+
+		TreePM pm;
+		initTreePM(&pm, &qt, 64, a);
+		computeForcesTreePM(&qt, &pm, FAR_FIELD_LIMIT);
+
+		double minRE, maxRE, firstQRE, medianRE, thirdQRE;
+		computeRelativeErrors(&cMerged, qt.nbCells, qt.cells, &minRE, &maxRE, &firstQRE, &medianRE, &thirdQRE);
+		printf("%e %e %e %e %e\n", minRE, firstQRE, medianRE, thirdQRE, maxRE);
+		assert(medianRE < 1e-2);
+
+		freeTreePM(&pm);
+	}
+	printf("\n");
+
+	// the short-range operators do not compute the potential
+	TreePM pm;
+	double u, w[3];
+	initTreePM(&pm, &qt, 64, CIC);
+	initQuadtreePotential(&qt);
+	computeForcesTreePM(&qt, &pm, FAR_FIELD_LIMIT);
+	int status = computeEnergy(&qt, &u, w);
+	assert(status == -1 && errno == EINVAL);
+	freeTreePM(&pm);
+
+	freeCell(&cMerged);
+	freeQuadtree(&qt);
+}
+
+void testPeriodic()
+{
+	srand(42);
+	printf("Regression test 10, periodic boundaries, Barnes-Hut like method with Ewald tables on a "
+		   "4x4 grid VS direct Ewald summation on one global cell (1k particles):\n");
+
+	Cell cMerged;
+	Quadtree qt;
+	initQuadtree(&qt, 3, 1000, 1000, 1e30, 1e32, 0, 1e17, 0, 1e17);
+	mergeCell(&cMerged, qt.nbCells, qt.cells);
+
+	Ewald ew;
+	initEwald(&ew, &qt, 64);
+	ewaldDirectSum(&ew, &cMerged);
+
+	computeMultipoles(&qt);
+	computeForcesPeriodic(&qt, &ew, FAR_FIELD_LIMIT);
+
+	double minRE, maxRE, firstQRE, medianRE, thirdQRE;
+	computeRelativeErrors(&cMerged, qt.nbCells, qt.cells, &minRE, &maxRE, &firstQRE, &medianRE, &thirdQRE);
+
+	printf("# Relative errors : min, 1st quartile, median, 3rd quartile, max\n");
+	printf("%e %e %e %e %e\n\n", minRE, firstQRE, medianRE, thirdQRE, maxRE);
+	assert(medianRE < 1e-2);
+
+	freeEwald(&ew);
+	freeCell(&cMerged);
+	freeQuadtree(&qt);
+}
+
+// Check that the cells in the near field of the active cells of the last tick were drifted to it
+static void checkDriftedNearField(Quadtree *qt, BlockTimesteps *bt)
+{
+	char *marks = (char *) calloc(qt->nbCells, sizeof(char));
+	int *queue = (int *) malloc(qt->nbMultipoles * sizeof(int));
+	for (int i = 0; i < bt->nbActiveCells; i++)
+		markNearField(qt, bt->activeCells[i], FAR_FIELD_LIMIT, queue, marks);
+	for (int i = 0; i < qt->nbCells; i++)
+		assert(!marks[i] || bt->drifted[i] == bt->tick);
+	free(marks);
+	free(queue);
+}
+
+void testBlockTimesteps()
+{
+	printf("Regression test 11, hierarchical block timesteps, 4 levels on a 4x4 grid (1k particles):\n");
+
+	// Reference: one step of the level 0 from rest, x = x0 + a0 dt²/2
+	Quadtree qt, qtRef;
+	srand(42);
+	initQuadtree(&qtRef, 3, 1000, 1000, 1e30, 1e32, 0, 1e17, 0, 1e17);
+	computeMultipoles(&qtRef);
+	computeForces(&qtRef, FAR_FIELD_LIMIT);
+
+	srand(42);
+	initQuadtree(&qt, 3, 1000, 1000, 1e30, 1e32, 0, 1e17, 0, 1e17);
+	BlockTimesteps bt;
+	double dtMax = 1e11;
+	initBlockTimesteps(&bt, &qt, dtMax, 3, 1e30, 1e15);
+	for (int t = 1; t < 8; t++)
+	{
+		long nbUpdated = blockStep(&qt, &bt, FAR_FIELD_LIMIT);
+		assert(nbUpdated == 0);
+	}
+	int nbParticles = bt.offsets[qt.nbCells];
+	long nbUpdated = blockStep(&qt, &bt, FAR_FIELD_LIMIT);
+	assert(nbUpdated == nbParticles);
+	synchronizeBlockTimesteps(&qt, &bt);
+
+	double maxDiff = 0, maxMove = 0;
+	for (int i = 0; i < qt.nbCells; i++)
+	{
+		Cell *c = qt.cells + i, *cRef = qtRef.cells + i;
+		for (int j = 0; j < c->nbParticles; j++)
+		{
+			double x = cRef->x[j] + 0.5 * cRef->fx[j] / cRef->m[j] * dtMax * dtMax;
+			double y = cRef->y[j] + 0.5 * cRef->fy[j] / cRef->m[j] * dtMax * dtMax;
+			maxDiff = max(maxDiff, dist(c->x[j], c->y[j], x, y));
+			maxMove = max(maxMove, dist(c->x[j], c->y[j], cRef->x[j], cRef->y[j]));
+		}
+	}
+	printf("# Single level: max relative difference with the leapfrog step\n%e\n", maxDiff / maxMove);
+	assert(maxDiff < 1e-12 * maxMove);
+	freeBlockTimesteps(&bt);
+
+	freeQuadtree(&qt);
+	freeQuadtree(&qtRef);
+
+	// Mixed levels VS all the particles on the finest level, displacements from the same start
+	Quadtree qtInit;
+	srand(42);
+	initQuadtree(&qtInit, 3, 1000, 1000, 1e30, 1e32, 0, 1e17, 0, 1e17);
+	srand(42);
+	initQuadtree(&qtRef, 3, 1000, 1000, 1e30, 1e32, 0, 1e17, 0, 1e17);
+	srand(42);
+	initQuadtree(&qt, 3, 1000, 1000, 1e30, 1e32, 0, 1e17, 0, 1e17);
+
+	initBlockTimesteps(&bt, &qtRef, dtMax, 3, 0, 1e15);
+	for (int t = 0; t < 8; t++)
+		blockStep(&qtRef, &bt, FAR_FIELD_LIMIT);
+	synchronizeBlockTimesteps(&qtRef, &bt);
+	freeBlockTimesteps(&bt);
+
+	initBlockTimesteps(&bt, &qt, dtMax, 3, 0.025, 1e14);
+	long nbKicked = 0;
+	for (int t = 0; t < 8; t++)
+		nbKicked += blockStep(&qt, &bt, FAR_FIELD_LIMIT);
+	synchronizeBlockTimesteps(&qt, &bt);
+
+	// compare the displacements, stored in the forces
+	for (int i = 0; i < qt.nbCells; i++)
+	{
+		Cell *c = qt.cells + i, *cRef = qtRef.cells + i, *cInit = qtInit.cells + i;
+		for (int j = 0; j < c->nbParticles; j++)
+		{
+			c->fx[j] = c->x[j] - cInit->x[j];
+			c->fy[j] = c->y[j] - cInit->y[j];
+			cRef->fx[j] = cRef->x[j] - cInit->x[j];
+			cRef->fy[j] = cRef->y[j] - cInit->y[j];
+		}
+	}
+	Cell cMerged;
+	mergeCell(&cMerged, qtRef.nbCells, qtRef.cells);
+
+	double minRE, maxRE, firstQRE, medianRE, thirdQRE;
+	computeRelativeErrors(&cMerged, qt.nbCells, qt.cells, &minRE, &maxRE, &firstQRE, &medianRE, &thirdQRE);
+
+	printf("# Mixed levels VS finest level: kicks per particle, relative errors of the displacements "
+		   "(min, 1st quartile, median, 3rd quartile, max)\n%f %e %e %e %e %e\n", 
+		   nbKicked / (double)nbParticles, minRE, firstQRE, medianRE, thirdQRE, maxRE);
+	assert(nbParticles <= nbKicked && nbKicked < 8 * nbParticles);
+	assert(medianRE < 1e-2);
+
+	freeCell(&cMerged);
+	freeQuadtree(&qtInit);
+	freeBlockTimesteps(&bt);
+	freeQuadtree(&qt);
+	freeQuadtree(&qtRef);
+
+	// Particles crossing a cell in a few ticks, on a 16x16 grid (4k particles): the walks of the active cells must only apply
+	// P2P on cells drifted to the tick
+	srand(42);
+	initQuadtree(&qt, 5, 4000, 4000, 1e30, 1e32, 0, 1e17, 0, 1e17);
+	initBlockTimesteps(&bt, &qt, dtMax, 3, 0.025, 1e16);
+	for (int i = 0; i < bt.offsets[qt.nbCells]; i++)
+		bt.vx[i] = 1e6;
+	for (int t = 0; t < 8; t++)
+	{
+		blockStep(&qt, &bt, FAR_FIELD_LIMIT);
+		checkDriftedNearField(&qt, &bt);
+	}
+	printf("# Fast particles: near field of the active cells drifted\n\n");
+	freeBlockTimesteps(&bt);
+	freeQuadtree(&qt);
+}
+
+void testField()
+{
+	srand(42);
+	printf("Regression test 12, field and potential at 1k probe points, Barnes-Hut like method on "
+		   "a 8x8 grid (10k particles) VS direct summation:\n");
+
+	Cell cMerged;
+	Quadtree qt;
+	initQuadtree(&qt, 4, 10000, 10000, 1e30, 1e32, 0, 1e17, 0, 1e17);
+	mergeCell(&cMerged, qt.nbCells, qt.cells);
+	computeMultipoles(&qt);
+
+	// probes of unit mass, exact field from each particle
+	Cell probes, probesRef;
+	initCell(&probes, 1000, 1000, 1, 1, 0, 1e17, 0, 1e17);
+	initCell(&probesRef, 1000, 1000, 1, 1, 0, 1e17, 0, 1e17);
+	memcpy(probesRef.x, probes.x, 2 * probes.nbParticles * sizeof(double));
+	initPotential(&probes);
+	initPotential(&probesRef);
+	for (int i = 0; i < cMerged.nbParticles; i++)
+		ponPpot_ref(cMerged.m[i], cMerged.x[i], cMerged.y[i], probesRef.nbParticles, probesRef.m, 
+					probesRef.x, probesRef.y, probesRef.fx, probesRef.fy, probesRef.pot, probesRef.vir);
+
+	computeField(&qt, probes.nbParticles, probes.x, probes.y, probes.fx, probes.fy, probes.pot, 
+				 FAR_FIELD_LIMIT);
+
+	double minRE, maxRE, firstQRE, medianRE, thirdQRE;
+	computeRelativeErrors(&probesRef, 1, &probes, &minRE, &maxRE, &firstQRE, &medianRE, &thirdQRE);
+	printf("# Relative errors of the field : min, 1st quartile, median, 3rd quartile, max\n");
+	printf("%e %e %e %e %e\n", minRE, firstQRE, medianRE, thirdQRE, maxRE);
+	assert(medianRE < 2e-2);
+
+	double maxPotRE = 0;
+	for (int i = 0; i < probes.nbParticles; i++)
+		maxPotRE = max(maxPotRE, fabs(probes.pot[i] - probesRef.pot[i]) / fabs(probesRef.pot[i]));
+	printf("# Max relative error of the potential\n%e\n\n", maxPotRE);
+	assert(maxPotRE < 1e-2);
+
+	// the tree is left untouched
+	for (int i = 0; i < qt.nbCells; i++)
+		for (int j = 0; j < qt.cells[i].nbParticles; j++)
+			assert(qt.cells[i].fx[j] == 0 && qt.cells[i].fy[j] == 0);
+
+	freeCell(&probes);
+	freeCell(&probesRef);
+	freeCell(&cMerged);
+	freeQuadtree(&qt);
+}
+
+void testGroupWalk()
+{
+	srand(42);
+	printf("Regression test 13, group walk over 1 and 2 levels VS one walk per cell, Barnes-Hut like "
+		   "method on a 32x32 grid (10k particles), and VS P2P_inRef on one global cell:\n"
+		   "# Group levels, relative errors VS P2P_inRef : min, 1st quartile, median, 3rd quartile, max, "
+		   "max relative difference VS one walk per cell\n");
+
+	Cell cMerged;
+	Quadtree qt, qtRef;
+	initQuadtree(&qt, 6, 10000, 10000, 1e30, 1e32, 0, 1e17, 0, 1e17);
+	srand(42);
+	initQuadtree(&qtRef, 6, 10000, 10000, 1e30, 1e32, 0, 1e17, 0, 1e17);
+	mergeCell(&cMerged, qt.nbCells, qt.cells);
+	P2P_inRef(&cMerged);
+	computeMultipoles(&qt);
+	computeMultipoles(&qtRef);
+	computeForces(&qtRef, FAR_FIELD_LIMIT);
+
+	for (int groupLevels = 0; groupLevels <= 2; groupLevels++)
+	{
+		for (int i = 0; i < qt.nbCells; i++)
+		{
+			memset(qt.cells[i].fx, 0, qt.cells[i].nbParticles * sizeof(double));
+			memset(qt.cells[i].fy, 0, qt.cells[i].nbParticles * sizeof(double));
+		}
+		qt.groupLevels = groupLevels;
+		computeForces(&qt, FAR_FIELD_LIMIT);
+
+		// the same vertices are accepted, only the order of the sums differs
+		double maxDiff = 0;
+		for (int i = 0; i < qt.nbCells; i++)
+		{
+			Cell *c = qt.cells + i, *cRef = qtRef.cells + i;
+			for (int j = 0; j < c->nbParticles; j++)
+				maxDiff = max(maxDiff, dist(c->fx[j], c->fy[j], cRef->fx[j], cRef->fy[j])
+										/ sqrt(cRef->fx[j] * cRef->fx[j] + cRef->fy[j] * cRef->fy[j]));
+		}
+
+		double minRE, maxRE, firstQRE, medianRE, thirdQRE;
+		computeRelativeErrors(&cMerged, qt.nbCells, qt.cells, &minRE, &maxRE, &firstQRE, &medianRE, &thirdQRE);
+		printf("%d %e %e %e %e %e %e\n", groupLevels, minRE, firstQRE, medianRE, thirdQRE, maxRE, maxDiff);
+		assert(medianRE < 2e-2 && maxDiff < 1e-12);
+	}
+	printf("\n");
+
+	freeCell(&cMerged);
+	freeQuadtree(&qt);
+	freeQuadtree(&qtRef);
+}
+
+void testSparseCells()
+{
+	srand(42);
+	printf("Regression test 14, cost-based choice of M2P and P2P, Barnes-Hut like method on a 16x16 "
+		   "grid of 0 to 4 particles per cell VS P2P_inRef on one global cell:\n");
+
+	Cell cMerged;
+	Quadtree qt;
+	initQuadtree(&qt, 5, 0, 1024, 1e30, 1e32, 0, 1e17, 0, 1e17);
+	mergeCell(&cMerged, qt.nbCells, qt.cells);
+	P2P_inRef(&cMerged);
+
+	int nbEmpty = 0;
+	for (int i = 0; i < qt.nbCells; i++)
+		nbEmpty += (qt.cells[i].nbParticles == 0);
+	assert(nbEmpty > 0);
+
+	computeMultipoles(&qt);
+	assert(qt.counts[0] == cMerged.nbParticles);
+	computeForces(&qt, FAR_FIELD_LIMIT);
+
+	double minRE, maxRE, firstQRE, medianRE, thirdQRE;
+	computeRelativeErrors(&cMerged, qt.nbCells, qt.cells, &minRE, &maxRE, &firstQRE, &medianRE, &thirdQRE);
+	printf("# Nb of particles, nb of empty cells, relative errors : min, 1st quartile, median, 3rd quartile, max\n");
+	printf("%d %d %e %e %e %e %e\n\n", cMerged.nbParticles, nbEmpty, minRE, firstQRE, medianRE, thirdQRE, maxRE);
+	assert(medianRE < 2e-2 && maxRE == maxRE);
+
+	freeCell(&cMerged);
+	freeQuadtree(&qt);
+}
+
+void testMAC()
+{
+	srand(42);
+	printf("Regression test 15, b_max and error bound MACs, Barnes-Hut like method on a 8x8 grid "
+		   "(10k particles) VS P2P_inRef on one global cell:\n"
+		   "# MAC, relative errors : min, 1st quartile, median, 3rd quartile, max\n");
+
+	Cell cMerged;
+	Quadtree qt;
+	initQuadtree(&qt, 4, 10000, 10000, 1e30, 1e32, 0, 1e17, 0, 1e17);
+	mergeCell(&cMerged, qt.nbCells, qt.cells);
+	P2P_inRef(&cMerged);
+
+	MultipoleAcceptance macs[2] = {BMAX_MAC, ERROR_MAC};
+	double farFieldLimits[2] = {0.5, 1};
+	for (int k = 0; k < 2; k++)
+	{
+		for (int i = 0; i < qt.nbCells; i++)
+		{
+			memset(qt.cells[i].fx, 0, qt.cells[i].nbParticles * sizeof(double));
+			memset(qt.cells[i].fy, 0, qt.cells[i].nbParticles * sizeof(double));
+		}
+		qt.mac = macs[k];
+		qt.macTolerance = 1e-9;
+		computeMultipoles(&qt);
+		computeForces(&qt, farFieldLimits[k]);
+
+		double minRE, maxRE, firstQRE, medianRE, thirdQRE;
+		computeRelativeErrors(&cMerged, qt.nbCells, qt.cells, &minRE, &maxRE, &firstQRE, &medianRE, &thirdQRE);
+		printf("%s %e %e %e %e %e\n", (macs[k] == BMAX_MAC) ? "bmax" : "error", 
+			   minRE, firstQRE, medianRE, thirdQRE, maxRE);
+		assert(medianRE < 1e-2);
+	}
+	printf("\n");
+
+	freeCell(&cMerged);
+	freeQuadtree(&qt);
+}
+
+static int cmpDouble(const void *p1, const void *p2)
+{
+	double a = *(const double *)p1, b = *(const double *)p2;
+	return (a > b) - (a < b);
+}
+
+void testGenerator()
+{
+	printf("Regression test 16, parallel Philox generator (100k particles), reproducibility and "
+		   "half-mass radii:\n");
+
+	int n = 100000;
+	double *m = (double *) malloc(6 * n * sizeof(double));
+	double *x = m + n, *y = x + n, *m2 = y + n, *x2 = m2 + n, *y2 = x2 + n;
+
+	// Philox4x32-10 known answer (Random123)
+	uint32_t ctr[4] = {0, 0, 0, 0}, key[2] = {0, 0}, out[4];
+	philox4x32(ctr, key, out);
+	assert(out[0] == 0x6627e8d5 && out[1] == 0xe169c58d && out[2] == 0xbc57ac4c && out[3] == 0x9b00dbd8);
+
+	printf("# Distribution, half-mass radius / scale\n");
+	const char *names[4] = {"uniform", "plummer", "disk", "clusters"};
+	for (int d = UNIFORM_DISTRIBUTION; d <= GAUSSIAN_MIXTURE_DISTRIBUTION; d++)
+	{
+		Generator gen;
+		initGenerator(&gen, d, 42, 1e30, 1e32, 0, 1e17, 0, 1e17);
+
+		// the same particles, whatever the split of the range
+		generateParticles(&gen, 0, n, m, x, y);
+		generateParticles(&gen, 0, n/3, m2, x2, y2);
+		generateParticles(&gen, n/3, n - n/3, m2 + n/3, x2 + n/3, y2 + n/3);
+		assert(memcmp(m, m2, n * sizeof(double)) == 0 && memcmp(x, x2, n * sizeof(double)) == 0 
+			   && memcmp(y, y2, n * sizeof(double)) == 0);
+
+		// median distance to the center of the area
+		for (int i = 0; i < n; i++)
+		{
+			assert(m[i] >= 1e30 && m[i] <= 1e32);
+			assert(x[i] >= 0 && x[i] < 1e17 && y[i] >= 0 && y[i] < 1e17);
+			x2[i] = dist(x[i], y[i], 0.5e17, 0.5e17);
+		}
+		qsort(x2, n, sizeof(double), cmpDouble);
+		printf("%s %f\n", names[d], x2[n/2] / gen.scale);
+
+		// projected Plummer: R² / (R² + a²) of the mass inside R, truncated at 4 a: 
+		// half of 16/17 at sqrt(8/9) a
+		if (d == PLUMMER_DISTRIBUTION)
+			assert(fabs(x2[n/2] / gen.scale - sqrt(8.0/9.0)) < 0.02);
+		// exponential disk: 1 - (1 + R/h) exp(-R/h), 1/2 at 1.678 h, 1.575 h in the area of side 8 h
+		if (d == EXPONENTIAL_DISK_DISTRIBUTION)
+			assert(fabs(x2[n/2] / gen.scale - 1.575) < 0.02);
+	}
+
+	// the quadtree holds all the particles, each one in its cell
+	Generator gen;
+	Quadtree qt;
+	initGenerator(&gen, PLUMMER_DISTRIBUTION, 42, 1e30, 1e32, 0, 1e17, 0, 1e17);
+	initQuadtreeGenerator(&qt, HILBERT_CURVE, 5, n, &gen);
+	int nbParticles = 0;
+	for (int i = 0; i < qt.nbCells; i++)
+	{
+		Cell *c = qt.cells + i;
+		nbParticles += c->nbParticles;
+		for (int k = 0; k < c->nbParticles; k++)
+			assert(c->x[k] >= c->xMin && c->x[k] < c->xMax && c->y[k] >= c->yMin && c->y[k] < c->yMax);
+	}
+	assert(nbParticles == n);
+	printf("\n");
+
+	freeQuadtree(&qt);
+	free(m);
+}
+
+void testPlacement()
+{
+	srand(42);
+	printf("Regression test 17, cells placed on 4 threads with the owned schedule VS dynamic "
+		   "schedule, on a 8x8 grid (10k particles):\n");
+
+	Quadtree qt, qtPlaced;
+	initQuadtree(&qt, 4, 10000, 10000, 1e30, 1e32, 0, 1e17, 0, 1e17);
+	srand(42);
+	initQuadtree(&qtPlaced, 4, 10000, 10000, 1e30, 1e32, 0, 1e17, 0, 1e17);
+
+	int nbThreads = omp_get_max_threads();
+	omp_set_num_threads(4);
+	placeQuadtree(&qtPlaced);
+	assert(qtPlaced.placed);
+
+	// the same forces, per cell and with the group walk
+	for (int groupLevels = 0; groupLevels <= 1; groupLevels++)
+	{
+		qt.groupLevels = qtPlaced.groupLevels = groupLevels;
+		computeMultipoles(&qt);
+		computeMultipoles(&qtPlaced);
+		computeForces(&qt, FAR_FIELD_LIMIT);
+		computeForces(&qtPlaced, FAR_FIELD_LIMIT);
+
+		for (int i = 0; i < qt.nbCells; i++)
+		{
+			Cell *c = qt.cells + i, *cPlaced = qtPlaced.cells + i;
+			assert(c->nbParticles == cPlaced->nbParticles);
+			assert(memcmp(c->fx, cPlaced->fx, c->nbParticles * sizeof(double)) == 0);
+			assert(memcmp(c->fy, cPlaced->fy, c->nbParticles * sizeof(double)) == 0);
+		}
+	}
+	omp_set_num_threads(nbThreads);
+	printf("# Identical forces\n\n");
+
+	freeQuadtree(&qt);
+	freeQuadtree(&qtPlaced);
+}
+
+void testEnsemble()
+{
+	printf("Regression test 18, ensemble of 8 Plummer systems on 8x8 grids (2k particles each) "
+		   "VS one call per system:\n");
+
+	Quadtree qts[8], qt;
+	Generator gen;
+	initGenerator(&gen, PLUMMER_DISTRIBUTION, 42, 1e30, 1e32, 0, 1e17, 0, 1e17);
+	initQuadtreeEnsemble(8, qts, MORTON_CURVE, 4, 2000, &gen);
+	computeMultipolesEnsemble(8, qts);
+	computeForcesEnsemble(8, qts, FAR_FIELD_LIMIT);
+
+	for (int s = 0; s < 8; s++)
+	{
+		Generator g = gen;
+		g.stream = s;
+		initQuadtreeGenerator(&qt, MORTON_CURVE, 4, 2000, &g);
+		computeMultipoles(&qt);
+		computeForces(&qt, FAR_FIELD_LIMIT);
+
+		for (int i = 0; i < qt.nbCells; i++)
+		{
+			Cell *c = qt.cells + i, *cEnsemble = qts[s].cells + i;
+			assert(c->nbParticles == cEnsemble->nbParticles);
+			assert(memcmp(c->x, cEnsemble->x, c->nbParticles * sizeof(double)) == 0);
+			assert(memcmp(c->fx, cEnsemble->fx, c->nbParticles * sizeof(double)) == 0);
+			assert(memcmp(c->fy, cEnsemble->fy, c->nbParticles * sizeof(double)) == 0);
+		}
+		freeQuadtree(&qt);
+		freeQuadtree(qts + s);
+	}
+	printf("# Identical particles and forces\n\n");
+}
+
+static void *serviceThread(void *sv)
+{
+	int status = runService((Service *)sv);
+	assert(status == 0);
+	return NULL;
+}
+
+// Check the forces of the service on the particles of gen against the quadtree built from them
+static void checkServiceForces(ServiceClient *cl, Generator *gen, int nbParticles, int height)
+{
+	generateParticles(gen, 0, nbParticles, cl->m, cl->x, cl->y);
+	ServiceReply reply = requestForces(cl, nbParticles, MORTON_CURVE, height, 
+									   gen->xMin, gen->xMax, gen->yMin, gen->yMax, FAR_FIELD_LIMIT);
+	assert(reply.status == 0);
+
+	Quadtree qt;
+	initQuadtreeGenerator(&qt, MORTON_CURVE, height, nbParticles, gen);
+	computeMultipoles(&qt);
+	computeForces(&qt, FAR_FIELD_LIMIT);
+
+	int *first = (int *) malloc((qt.nbCells + 1) * sizeof(int));
+	int *order = (int *) malloc(nbParticles * sizeof(int));
+	sortByLeaf(&qt, nbParticles, cl->x, cl->y, first, order);
+	for (int i = 0; i < qt.nbCells; i++)
+	{
+		Cell *c = qt.cells + i;
+		assert(c->nbParticles == first[i+1] - first[i]);
+		for (int k = 0; k < c->nbParticles; k++)
+			assert(cl->fx[order[first[i] + k]] == c->fx[k] && cl->fy[order[first[i] + k]] == c->fy[k]);
+	}
+
+	free(first);
+	free(order);
+	freeQuadtree(&qt);
+}
+
+void testService()
+{
+	printf("Regression test 19, resident service VS computeForces, Plummer then disk particles "
+		   "(4k and 3k particles) on 8x8 grids, then 16x16 grids:\n");
+
+	char socketPath[64], segmentName[64];
+	snprintf(socketPath, sizeof(socketPath), "/tmp/testService.%d", (int)getpid());
+	snprintf(segmentName, sizeof(segmentName), "/testService.%d", (int)getpid());
+
+	// names beyond the buffers of the service
+	Service sv;
+	char longName[300];
+	memset(longName, 'a', sizeof(longName) - 1);
+	longName[0] = '/';
+	longName[sizeof(longName) - 1] = 0;
+	int status = initService(&sv, longName, segmentName, 4000);
+	assert(status == -1 && errno == ENAMETOOLONG);
+	status = initService(&sv, socketPath, longName, 4000);
+	assert(status == -1 && errno == ENAMETOOLONG);
+
+	pthread_t thread;
+	status = initService(&sv, socketPath, segmentName, 4000);
+	assert(status == 0);
+	status = pthread_create(&thread, NULL, serviceThread, &sv);
+	assert(status == 0);
+
+	ServiceClient cl;
+	Generator gen;
+	status = openServiceClient(&cl, socketPath, segmentName);
+	assert(status == 0 && cl.capacity == 4000);
+	initGenerator(&gen, PLUMMER_DISTRIBUTION, 42, 1e30, 1e32, 0, 1e17, 0, 1e17);
+	checkServiceForces(&cl, &gen, 4000, 4);
+	initGenerator(&gen, EXPONENTIAL_DISK_DISTRIBUTION, 43, 1e30, 1e32, 0, 1e17, 0, 1e17);
+	checkServiceForces(&cl, &gen, 3000, 4);
+	checkServiceForces(&cl, &gen, 3000, 5);
+
+	// beyond the capacity of the segment, even if the client overwrites it
+	ServiceReply reply = requestForces(&cl, 4001, MORTON_CURVE, 4, 0, 1e17, 0, 1e17, FAR_FIELD_LIMIT);
+	assert(reply.status == -1);
+	cl.segment->capacity = 1 << 30;
+	reply = requestForces(&cl, 4001, MORTON_CURVE, 4, 0, 1e17, 0, 1e17, FAR_FIELD_LIMIT);
+	assert(reply.status == -1);
+
+	status = stopService(&cl);
+	assert(status == 0);
+	closeServiceClient(&cl);
+	status = pthread_join(thread, NULL);
+	assert(status == 0);
+	assert(sv.nbRequests == 3);
+	freeService(&sv);
+	printf("# Identical forces, 3 requests served\n\n");
+}
+
+void testArrays()
+{
+	printf("Regression test 20, quadtree on the arrays of the caller VS initQuadtreeGenerator, "
+		   "disk particles (5k particles) on 8x8 grids:\n");
+
+	int n = 5000;
+	Quadtree qt, qtArrays;
+	Generator gen;
+	initGenerator(&gen, EXPONENTIAL_DISK_DISTRIBUTION, 42, 1e30, 1e32, 0, 1e17, 0, 1e17);
+	initQuadtreeGenerator(&qt, HILBERT_CURVE, 4, n, &gen);
+	computeMultipoles(&qt);
+	computeForces(&qt, FAR_FIELD_LIMIT);
+
+	double *m = (double *) malloc(5 * n * sizeof(double));
+	double *x = m + n, *y = x + n, *fx = y + n, *fy = fx + n;
+	int *order = (int *) malloc(n * sizeof(int));
+	generateParticles(&gen, 0, n, m, x, y);
+	memset(fx, 0, 2 * n * sizeof(double));
+	int status = initQuadtreeArrays(&qtArrays, HILBERT_CURVE, 4, n, m, x, y, fx, fy, 0, 1e17, 0, 1e17);
+	assert(status == -1);
+
+	double x7 = x[7];
+	sortParticles(HILBERT_CURVE, 4, 0, 1e17, 0, 1e17, n, m, x, y, order);
+	status = initQuadtreeArrays(&qtArrays, HILBERT_CURVE, 4, n, m, x, y, fx, fy, 0, 1e17, 0, 1e17);
+	assert(status == 0);
+	computeMultipoles(&qtArrays);
+	computeForces(&qtArrays, FAR_FIELD_LIMIT);
+
+	// the cells are views on the sorted arrays
+	for (int i = 0, o = 0; i < qt.nbCells; o += qt.cells[i].nbParticles, i++)
+	{
+		Cell *c = qt.cells + i, *cArrays = qtArrays.cells + i;
+		assert(c->nbParticles == cArrays->nbParticles && cArrays->x == x + o && cArrays->fx == fx + o);
+		assert(memcmp(c->x, x + o, c->nbParticles * sizeof(double)) == 0);
+		assert(memcmp(c->fx, fx + o, c->nbParticles * sizeof(double)) == 0);
+		assert(memcmp(c->fy, fy + o, c->nbParticles * sizeof(double)) == 0);
+	}
+	for (int i = 0; i < n; i++)
+		if (order[i] == 7)
+			assert(x[i] == x7);
+
+	freeQuadtree(&qt);
+	freeQuadtree(&qtArrays);
+	free(m);
+	free(order);
+	printf("# Identical forces, without copies\n\n");
+}
+
+void testOutOfCore()
+{
+	printf("Regression test 21, out-of-core VS in-memory forces, Plummer particles (20k particles) "
+		   "on 16x16 grids, at most 10k particles in memory:\n");
+
+	char path[64];
+	snprintf(path, sizeof(path), "/tmp/testOutOfCore.%d", (int)getpid());
+
+	int n = 20000;
+	Quadtree qt;
+	Generator gen;
+	ParticleFile pf;
+	OutOfCoreStats stats;
+	initGenerator(&gen, PLUMMER_DISTRIBUTION, 42, 1e30, 1e32, 0, 1e17, 0, 1e17);
+	int status = writeParticleFile(path, HILBERT_CURVE, 5, n, &gen, 3000);
+	assert(status == 0);
+	status = openParticleFile(&pf, path);
+	assert(status == 0 && pf.header.nbParticles == n);
+	status = computeForcesOutOfCore(&pf, 1000, FAR_FIELD_LIMIT, NULL);
+	assert(status == -1 && errno == ENOMEM);
+	status = computeForcesOutOfCore(&pf, 10000, FAR_FIELD_LIMIT, &stats);
+	assert(status == 0);
+	assert(stats.maxResident <= 10000 && stats.nbWindows > 1);
+
+	initQuadtreeGenerator(&qt, HILBERT_CURVE, 5, n, &gen);
+	computeMultipoles(&qt);
+	computeForces(&qt, FAR_FIELD_LIMIT);
+
+	double *m = (double *) malloc(5 * n * sizeof(double));
+	double *x = m + n, *y = x + n, *fx = y + n, *fy = fx + n;
+	for (int i = 0; i < qt.nbCells; i++)
+	{
+		Cell *c = qt.cells + i;
+		assert(c->nbParticles == pf.first[i+1] - pf.first[i]);
+		status = readParticleCell(&pf, i, m, x, y, fx, fy);
+		assert(status == 0);
+		assert(memcmp(c->x, x, c->nbParticles * sizeof(double)) == 0);
+		assert(memcmp(c->fx, fx, c->nbParticles * sizeof(double)) == 0);
+		assert(memcmp(c->fy, fy, c->nbParticles * sizeof(double)) == 0);
+	}
+	printf("# Identical forces in %d windows, at most %ld particles in memory\n\n", 
+		   stats.nbWindows, (long)stats.maxResident);
+
+	closeParticleFile(&pf);
+	unlink(path);
+	freeQuadtree(&qt);
+	free(m);
+}
+
+void testHaloEncoding()
+{
+	printf("Regression test 22, forces of a neighbour cell encoded for the halo exchange VS "
+		   "the cell itself (2k particles on 2k particles):\n"
+		   "# Encoding, bytes per particle, min, max and median relative errors\n");
+
+	const char *names[] = {"double", "quantized32", "quantized16"};
+	Cell c1, c2, c2Ref, decoded;
+	initCell(&c1, 2000, 2000, 1e30, 1e32, 0, 1e16, 0, 1e16);
+	srand(42);
+	initCell(&c2, 2000, 2000, 1e30, 1e32, 1e16, 2e16, 0, 1e16);
+	srand(42);
+	initCell(&c2Ref, 2000, 2000, 1e30, 1e32, 1e16, 2e16, 0, 1e16);
+	P2P_extRef(&c1, &c2Ref);
+
+	unsigned char *buf = (unsigned char *) malloc(encodedCellSize(2000, HALO_DOUBLE));
+	for (int encoding = HALO_DOUBLE; encoding <= HALO_QUANTIZED_16; encoding++)
+	{
+		int cellNo;
+		size_t size = encodeCell(&c1, 7, encoding, buf);
+		assert(size == encodedCellSize(2000, encoding) && size % 8 == 0);
+		size_t decodedSize = decodeCell(buf, encoding, &cellNo, &decoded);
+		assert(decodedSize == size && cellNo == 7);
+		assert(decoded.nbParticles == 2000 && decoded.xMax == c1.xMax && decoded.fx[0] == 0);
+
+		// half a step of the grid of the cell, and the precision of a float
+		double step = (encoding == HALO_QUANTIZED_32) ? 1e16 / UINT32_MAX 
+					: (encoding == HALO_QUANTIZED_16) ? 1e16 / UINT16_MAX : 0;
+		for (int i = 0; i < 2000; i++)
+		{
+			assert(fabs(decoded.x[i] - c1.x[i]) <= 0.5 * step * (1 + 1e-9) + 2 * EPS * 1e16);
+			assert(fabs(decoded.y[i] - c1.y[i]) <= 0.5 * step * (1 + 1e-9) + 2 * EPS * 1e16);
+			assert(fabs(decoded.m[i] - c1.m[i]) <= ((encoding == HALO_DOUBLE) ? 0 : 0x1p-24 * c1.m[i]));
+		}
+
+		memset(c2.fx, 0, 2000 * sizeof(double));
+		memset(c2.fy, 0, 2000 * sizeof(double));
+		P2P_extRef(&decoded, &c2);
+		double minRE, maxRE, firstQRE, medianRE, thirdQRE;
+		computeRelativeErrors(&c2Ref, 1, &c2, &minRE, &maxRE, &firstQRE, &medianRE, &thirdQRE);
+		printf("%s %.1f %e %e %e\n", names[encoding], (size - 40) / 2000.0, minRE, maxRE, medianRE);
+		assert((encoding == HALO_DOUBLE) ? maxRE == 0 : medianRE < 1e-4);
+		freeCell(&decoded);
+	}
+	printf("\n");
+
+	free(buf);
+	freeCell(&c1);
+	freeCell(&c2);
+	freeCell(&c2Ref);
+}
+
+void testSnapshots()
+{
+	printf("Regression test 23, asynchronous snapshots VS the quadtree when they were taken "
+		   "(6.4k particles on 8x8 grids):\n"
+		   "# Encoding, bytes, max relative error of the forces\n");
+
+	const char *names[] = {"double", "quantized32", "quantized16"};
+	char paths[3][64];
+	for (int i = 0; i < 3; i++)
+		snprintf(paths[i], sizeof(paths[i]), "/tmp/testSnapshot.%d.%d", (int)getpid(), i);
+
+	Quadtree qt, ref;
+	srand(42);
+	initQuadtree(&qt, 4, 6400, 6400, 1e30, 1e32, 0, 1e17, 0, 1e17);
+	srand(42);
+	initQuadtree(&ref, 4, 6400, 6400, 1e30, 1e32, 0, 1e17, 0, 1e17);
+	computeMultipoles(&ref);
+	computeForces(&ref, FAR_FIELD_LIMIT);
+
+	// the forces are reset once each snapshot is queued, both buffers being pending at the third one
+	SnapshotWriter sw;
+	for (int encoding = HALO_DOUBLE; encoding <= HALO_QUANTIZED_16; encoding++)
+	{
+		int status = initSnapshotWriter(&sw, encoding, 1 << 20);
+		assert(status == 0);
+		for (int i = 0; i < 3; i++)
+		{
+			for (int j = 0; j < qt.nbCells; j++)
+			{
+				memcpy(qt.cells[j].fx, ref.cells[j].fx, qt.cells[j].nbParticles * sizeof(double));
+				memcpy(qt.cells[j].fy, ref.cells[j].fy, qt.cells[j].nbParticles * sizeof(double));
+			}
+			status = writeSnapshot(&sw, &qt, paths[i]);
+			assert(status == 0);
+			for (int j = 0; j < qt.nbCells; j++)
+				memset(qt.cells[j].fx, 0, qt.cells[j].nbParticles * sizeof(double));
+		}
+		status = freeSnapshotWriter(&sw);
+		assert(status == 0 && sw.stats.nbSnapshots == 3);
+
+		size_t size = sw.stats.bytes / 3;
+		unsigned char *buf = (unsigned char *) malloc(size);
+		FILE *f = fopen(paths[2], "rb");
+		assert(f != NULL);
+		size_t nbRead = fread(buf, 1, size, f);
+		assert(nbRead == size && fgetc(f) == EOF);
+		fclose(f);
+
+		SnapshotHeader h;
+		memcpy(&h, buf, sizeof(h));
+		assert(h.nbCells == qt.nbCells && h.nbParticles == 6400 && h.encoding == encoding);
+
+		double maxRE = 0;
+		size_t offset = sizeof(h);
+		for (int j = 0; j < qt.nbCells; j++)
+		{
+			int cellNo;
+			Cell c, *cRef = ref.cells + j;
+			offset += decodeSnapshotCell(buf + offset, encoding, &cellNo, &c);
+			assert(cellNo == j && c.nbParticles == cRef->nbParticles);
+
+			// half a step of the grid of the cell, and the precision of a float
+			double levels = (encoding == HALO_QUANTIZED_32) ? UINT32_MAX
+						  : (encoding == HALO_QUANTIZED_16) ? UINT16_MAX : INFINITY;
+			double stepX = (cRef->xMax - cRef->xMin) / levels, stepY = (cRef->yMax - cRef->yMin) / levels;
+			for (int k = 0; k < c.nbParticles; k++)
+			{
+				assert(fabs(c.x[k] - cRef->x[k]) <= 0.5 * stepX * (1 + 1e-9) + 2 * EPS * cRef->xMax);
+				assert(fabs(c.y[k] - cRef->y[k]) <= 0.5 * stepY * (1 + 1e-9) + 2 * EPS * cRef->yMax);
+				assert(fabs(c.m[k] - cRef->m[k]) <= ((encoding == HALO_DOUBLE) ? 0 : 0x1p-24 * cRef->m[k]));
+				maxRE = fmax(maxRE, fabs(c.fx[k] - ref.cells[j].fx[k]) / fabs(ref.cells[j].fx[k]));
+				maxRE = fmax(maxRE, fabs(c.fy[k] - ref.cells[j].fy[k]) / fabs(ref.cells[j].fy[k]));
+			}
+			freeCell(&c);
+		}
+		assert(offset == size);
+		assert((encoding == HALO_DOUBLE) ? maxRE == 0 : maxRE <= 0x1p-24);
+		printf("%s %ld %e\n", names[encoding], (long)size, maxRE);
+		free(buf);
+	}
+	printf("\n");
+
+	// too large a snapshot, and a failed write reported by the next calls
+	int status = initSnapshotWriter(&sw, HALO_DOUBLE, 1000);
+	assert(status == 0);
+	status = writeSnapshot(&sw, &qt, paths[0]);
+	assert(status == -1 && errno == EFBIG);
+	status = freeSnapshotWriter(&sw);
+	assert(status == 0);
+	status = initSnapshotWriter(&sw, HALO_DOUBLE, 1 << 20);
+	assert(status == 0);
+	status = writeSnapshot(&sw, &qt, "/nonexistent/snapshot");
+	assert(status == 0);
+	status = flushSnapshotWriter(&sw);
+	assert(status == -1 && errno == ENOENT);
+	status = writeSnapshot(&sw, &qt, paths[0]);
+	assert(status == -1 && errno == ENOENT);
+	status = freeSnapshotWriter(&sw);
+	assert(status == -1);
+
+	for (int i = 0; i < 3; i++)
+		unlink(paths[i]);
+	freeQuadtree(&qt);
+	freeQuadtree(&ref);
+}
+
+void testAnalysis()
+{
+	printf("Regression test 24, in-situ analysis of the cells VS a loop over the particles, Plummer "
+		   "particles (20k particles) on 16x16 grids, 8x8 pixels:\n");
+
+	Quadtree qt;
+	Generator gen;
+	initGenerator(&gen, PLUMMER_DISTRIBUTION, 42, 1e30, 1e32, 0, 1e17, 0, 1e17);
+	initQuadtreeGenerator(&qt, HILBERT_CURVE, 5, 20000, &gen);
+	computeMultipoles(&qt);
+	computeForces(&qt, FAR_FIELD_LIMIT);
+
+	// the halves of the cells in two analyses, as two nodes
+	Analysis a, halves;
+	initAnalysis(&a, &qt, 8, 20, 5e16, 5e16, 5e16, 30, 1e20, 1e30);
+	initAnalysis(&halves, &qt, 8, 20, 5e16, 5e16, 5e16, 30, 1e20, 1e30);
+	analyzeQuadtree(&a, &qt);
+	analyzeCells(&halves, &qt, 0, qt.nbCells / 2);
+	analyzeCells(&halves, &qt, qt.nbCells / 2, qt.nbCells);
+
+	double *density = (double *) calloc(8 * 8, sizeof(double)), mass = 0;
+	long radialCounts[20] = {0}, forceCounts[30] = {0}, nbForceCounts = 0;
+	for (int i = 0; i < qt.nbCells; i++)
+	{
+		Cell *c = qt.cells + i;
+		for (int j = 0; j < c->nbParticles; j++)
+		{
+			double px = floor(c->x[j] / 1e17 * 8), py = floor(c->y[j] / 1e17 * 8);
+			px = (px < 0) ? 0 : (px > 7) ? 7 : px;
+			py = (py < 0) ? 0 : (py > 7) ? 7 : py;
+			density[(int)py * 8 + (int)px] += c->m[j];
+			mass += c->m[j];
+
+			double r = hypot(c->x[j] - 5e16, c->y[j] - 5e16) / 5e16 * 20;
+			if (r < 20)
+				radialCounts[(int)r]++;
+
+			int b = (int) floor(log10(hypot(c->fx[j], c->fy[j]) / 1e20) * 3);
+			forceCounts[(b < 0) ? 0 : (b > 29) ? 29 : b]++;
+		}
+	}
+
+	double maxRE = 0;
+	for (int p = 0; p < 8 * 8; p++)
+	{
+		maxRE = fmax(maxRE, fabs(a.density[p] - density[p]) / fmax(density[p], 1e-300));
+		assert(fabs(halves.density[p] - a.density[p]) <= 1e-12 * a.density[p]);
+	}
+	for (int b = 0; b < 30; b++)
+		nbForceCounts += abs((int)(a.forceCounts[b] - forceCounts[b]));
+	assert(a.nbParticles == 20000 && halves.nbParticles == 20000);
+	assert(fabs(a.mass - mass) <= 1e-12 * mass && maxRE <= 1e-12);
+	assert(memcmp(a.radialCounts, radialCounts, sizeof(radialCounts)) == 0);
+	assert(memcmp(a.radialCounts, halves.radialCounts, sizeof(radialCounts)) == 0);
+	assert(memcmp(a.forceCounts, halves.forceCounts, sizeof(forceCounts)) == 0);
+	// the bounds of the bins may round differently
+	assert(nbForceCounts <= 10);
+	printf("# Max relative error of the density %e, %ld particles in other force bins\n\n", 
+		   maxRE, nbForceCounts);
+
+	// rings so thin that the radii of the particles are beyond the range of an int
+	freeAnalysis(&halves);
+	initAnalysis(&halves, &qt, 8, 20, 5e16, 5e16, 1e-290, 30, 1e20, 1e30);
+	analyzeQuadtree(&halves, &qt);
+	for (int r = 0; r < 20; r++)
+		assert(halves.radialCounts[r] == 0 && halves.radialMass[r] == 0);
+	assert(halves.nbParticles == 20000);
+
+	freeAnalysis(&a);
+	freeAnalysis(&halves);
+	free(density);
+	freeQuadtree(&qt);
+}
+
+void testNeighbours()
+{
+	printf("Regression test 25, radius and kNN queries on the quadtree VS brute force, Plummer "
+		   "particles (5k particles) on 16x16 grids, 5k particles and 1k random points as queries:\n");
+
+	int n = 5000, nbQueries = 6000, k = 16;
+	double radius = 2e15;
+	Quadtree qt;
+	Generator gen;
+	initGenerator(&gen, PLUMMER_DISTRIBUTION, 42, 1e30, 1e32, 0, 1e17, 0, 1e17);
+	initQuadtreeGenerator(&qt, HILBERT_CURVE, 5, n, &gen);
+
+	// the particles numbered along the cells, then random points
+	double *px = (double *) malloc(2 * n * sizeof(double)), *py = px + n;
+	double *qx = (double *) malloc(2 * nbQueries * sizeof(double)), *qy = qx + nbQueries;
+	for (int i = 0, p = 0; i < qt.nbCells; i++)
+		for (int j = 0; j < qt.cells[i].nbParticles; j++, p++)
+		{
+			px[p] = qx[p] = qt.cells[i].x[j];
+			py[p] = qy[p] = qt.cells[i].y[j];
+		}
+	srand(42);
+	for (int q = n; q < nbQueries; q++)
+	{
+		qx[q] = 1e17 * rand() / RAND_MAX;
+		qy[q] = 1e17 * rand() / RAND_MAX;
+	}
+
+	NeighbourLists radiusLists, knnLists;
+	findNeighboursRadius(&qt, nbQueries, qx, qy, radius, &radiusLists);
+	findNearestNeighbours(&qt, nbQueries, qx, qy, k, &knnLists);
+	assert(radiusLists.nbQueries == nbQueries && knnLists.offsets[nbQueries] == (long)k * nbQueries);
+
+	long *expected = (long *) malloc(n * sizeof(long));
+	double *d = (double *) malloc(n * sizeof(double));
+	long nbRadius = 0;
+	for (int q = 0; q < nbQueries; q++)
+	{
+		int nbExpected = 0;
+		for (int p = 0; p < n; p++)
+		{
+			double dx = px[p] - qx[q], dy = py[p] - qy[q];
+			d[p] = sqrt(dx*dx + dy*dy);
+			if (d[p] <= radius)
+				expected[nbExpected++] = p;
+		}
+
+		// the particles within radius, in the order of the cells
+		long o = radiusLists.offsets[q], m = radiusLists.offsets[q + 1] - o;
+		assert(m == nbExpected && memcmp(radiusLists.neighbours + o, expected, m * sizeof(long)) == 0);
+		assert(q >= n || m >= 1);
+		nbRadius += m;
+
+		// the k nearest, by increasing distance
+		o = knnLists.offsets[q];
+		for (int j = 0; j < k; j++)
+		{
+			long p = knnLists.neighbours[o + j];
+			assert(knnLists.distances[o + j] == d[p] && (j == 0 || d[p] >= knnLists.distances[o + j - 1]));
+		}
+		qsort(d, n, sizeof(double), cmpDouble);
+		assert(knnLists.distances[o + k - 1] == d[k - 1] && (q >= n || d[0] == 0));
+	}
+	printf("# %.1f neighbours per query within the radius, identical lists\n\n", (double)nbRadius / nbQueries);
+
+	freeNeighbourLists(&radiusLists);
+	freeNeighbourLists(&knnLists);
+	free(px);
+	free(qx);
+	free(expected);
+	free(d);
+	freeQuadtree(&qt);
+}
+
+// Check that the forces of the cells firstCell to lastCell-1 of qt are the ones of ref, bit for bit
+static void checkIdenticalForces(Quadtree *qt, Quadtree *ref, int firstCell, int lastCell)
+{
+	for (int i = firstCell; i < lastCell; i++)
+	{
+		Cell *c = qt->cells + i, *cRef = ref->cells + i;
+		assert(c->nbParticles == cRef->nbParticles);
+		assert(memcmp(c->fx, cRef->fx, c->nbParticles * sizeof(double)) == 0);
+		assert(memcmp(c->fy, cRef->fy, c->nbParticles * sizeof(double)) == 0);
+	}
+}
+
+// Share the quadtree of gen among the ranks of each node of nodeComm, and check its forces
+static void checkSharedForces(Generator *gen, MPI_Comm nodeComm, Quadtree *ref)
+{
+	int nodeRank;
+	MPI_Comm_rank(nodeComm, &nodeRank);
+	Quadtree qt;
+	SharedQuadtree sq;
+	if (nodeRank == 0)
+		initQuadtreeGenerator(&qt, HILBERT_CURVE, 5, 20000, gen);
+	shareQuadtree(&qt, &sq, nodeComm);
+	assert((sq.leadersComm != MPI_COMM_NULL) == (nodeRank == 0) && sq.nbParticles == 20000);
+	computeMultipolesShared(&qt, &sq);
+	computeForcesShared(&qt, &sq, FAR_FIELD_LIMIT);
+	checkIdenticalForces(&qt, ref, 0, ref->nbCells);
+	freeSharedQuadtree(&qt, &sq);
+}
+
+void testDistributed()
+{
+	int rank, size;
+	MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+	MPI_Comm_size(MPI_COMM_WORLD, &size);
+	if (rank == 0)
+		printf("Regression test 26, distributed force passes on %d ranks VS computeForces, "
+			   "Plummer particles (20k particles) on 16x16 grids:\n"
+			   "# Encoding of the halo, cells received, median relative error of the forces\n", size);
+
+	Quadtree ref;
+	Generator gen;
+	initGenerator(&gen, PLUMMER_DISTRIBUTION, 42, 1e30, 1e32, 0, 1e17, 0, 1e17);
+	initQuadtreeGenerator(&ref, HILBERT_CURVE, 5, 20000, &gen);
+	computeMultipoles(&ref);
+	computeForces(&ref, FAR_FIELD_LIMIT);
+
+	// the cells of the node, the last one keeping the remainder
+	int firstCell, lastCell, nbCells;
+	distributedCells(&ref, rank, size, &firstCell, &lastCell);
+	nbCells = lastCell - firstCell;
+	MPI_Allreduce(MPI_IN_PLACE, &nbCells, 1, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+	assert(nbCells == ref.nbCells && distributedOwner(&ref, lastCell - 1, size) == rank);
+
+	// quadtree shared by the ranks of the shared memory nodes, then one node per rank
+	MPI_Comm nodeComm;
+	MPI_Comm_split_type(MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, 0, MPI_INFO_NULL, &nodeComm);
+	checkSharedForces(&gen, nodeComm, &ref);
+	MPI_Comm_free(&nodeComm);
+	checkSharedForces(&gen, MPI_COMM_SELF, &ref);
+
+	// halo exchange: the cells received as doubles are the ones of the other nodes
+	Cell cMerged;
+	mergeCell(&cMerged, lastCell - firstCell, ref.cells + firstCell);
+	for (int encoding = HALO_DOUBLE; encoding <= HALO_QUANTIZED_16; encoding++)
+	{
+		Quadtree qt;
+		HaloStats stats;
+		initQuadtreeGenerator(&qt, HILBERT_CURVE, 5, 20000, &gen);
+		computeMultipoles(&qt);
+		computeForcesDistributedHalo(&qt, FAR_FIELD_LIMIT, encoding, &stats);
+
+		double minRE, maxRE, firstQRE, medianRE, thirdQRE;
+		computeRelativeErrors(&cMerged, lastCell - firstCell, qt.cells + firstCell, &minRE, &maxRE, 
+							  &firstQRE, &medianRE, &thirdQRE);
+		long nbReceived = stats.nbCells;
+		MPI_Allreduce(MPI_IN_PLACE, &nbReceived, 1, MPI_LONG, MPI_SUM, MPI_COMM_WORLD);
+		MPI_Allreduce(MPI_IN_PLACE, &medianRE, 1, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+		if (rank == 0)
+			printf("%d %ld %e\n", encoding, nbReceived, medianRE);
+
+		assert((size == 1) ? nbReceived == 0 : nbReceived > 0);
+		if (encoding == HALO_DOUBLE)
+			checkIdenticalForces(&qt, &ref, firstCell, lastCell);
+		else
+			assert(medianRE < 1e-4);
+		freeQuadtree(&qt);
+	}
+	freeCell(&cMerged);
+
+	// in-situ analysis, the summaries being reduced on the rank 0 and reset on the others
+	Analysis a, aRef;
+	initAnalysis(&a, &ref, 8, 20, 5e16, 5e16, 5e16, 30, 1e20, 1e30);
+	initAnalysis(&aRef, &ref, 8, 20, 5e16, 5e16, 5e16, 30, 1e20, 1e30);
+	analyzeDistributed(&a, &ref);
+	analyzeQuadtree(&aRef, &ref);
+	if (rank == 0)
+	{
+		assert(a.nbParticles == 20000 && fabs(a.mass - aRef.mass) <= 1e-12 * aRef.mass);
+		for (int p = 0; p < 8 * 8; p++)
+			assert(fabs(a.density[p] - aRef.density[p]) <= 1e-12 * aRef.density[p]);
+		for (int r = 0; r < 20; r++)
+			assert(fabs(a.radialMass[r] - aRef.radialMass[r]) <= 1e-12 * aRef.radialMass[r]);
+		assert(memcmp(a.radialCounts, aRef.radialCounts, 20 * sizeof(long)) == 0);
+		assert(memcmp(a.forceCounts, aRef.forceCounts, 30 * sizeof(long)) == 0);
+	}
+	else
+		assert(a.nbParticles == 0 && a.mass == 0);
+	freeAnalysis(&a);
+	freeAnalysis(&aRef);
+
+	freeQuadtree(&ref);
+	if (rank == 0)
+		printf("# Identical forces and summaries\n\n");
+}
+
+void testBackends()
+{
+	printf("Regression test 5, every kernel backend vs the _ref kernels (2k particles):\n"
+		   "# Backend, max relative errors of ponP, P2P_in, P2P_ext, M2P\n");
+
+	WorkingVecs wv;
+	initWorkingVecs(&wv);
+
+	for (int b = 0; b < getNbBackends(); b++)
+	{
+		const Backend *backend = getBackendNo(b);
+		if (!backend->supported())
+		{
+			printf("%s not supported by this CPU, skipped\n", backend->name);
+			continue;
+		}
+		int status = setBackend(backend->name);
+		assert(status == 0 && getBackend() == backend);
+
+		Cell c1, c2, c3;
+		Multipole m3;
+		double minRE, maxRE[4], firstQRE, medianRE, thirdQRE;
+
+		srand(42);
+		initCell(&c1, 2000, 2000, 1e30, 1e32, 0, 1e17, 0, 1e17);
+		srand(42);
+		initCell(&c2, 2000, 2000, 1e30, 1e32, 0, 1e17, 0, 1e17);
+		initCell(&c3, 1001, 1001, 1e30, 1e32, 2e17, 3e17, 0, 1e17);
+		P2M(&m3, &c3);
+
+		ponP_ref(1e31, 0.5e17, 0.5e17, c1.nbParticles, c1.m, c1.x, c1.y, c1.fx, c1.fy); 
+		ponP(1e31, 0.5e17, 0.5e17, c2.nbParticles, c2.m, c2.x, c2.y, c2.fx, c2.fy, &wv);
+		computeRelativeErrors(&c1, 1, &c2, &minRE, maxRE, &firstQRE, &medianRE, &thirdQRE);
+
+		P2P_inRef(&c1);
+		P2P_in(&c2, &wv);
+		computeRelativeErrors(&c1, 1, &c2, &minRE, maxRE + 1, &firstQRE, &medianRE, &thirdQRE);
+
+		P2P_extRef(&c3, &c1);
+		P2P_ext(&c3, &c2, &wv);
+		computeRelativeErrors(&c1, 1, &c2, &minRE, maxRE + 2, &firstQRE, &medianRE, &thirdQRE);
+
+		ponP_ref(m3.m, m3.x, m3.y, c1.nbParticles, c1.m, c1.x, c1.y, c1.fx, c1.fy);
+		M2P(&m3, &c2, &wv);
+		computeRelativeErrors(&c1, 1, &c2, &minRE, maxRE + 3, &firstQRE, &medianRE, &thirdQRE);
+
+		printf("%s %e %e %e %e\n", backend->name, maxRE[0], maxRE[1], maxRE[2], maxRE[3]);
+		for (int i = 0; i < 4; i++)
+			assert(maxRE[i] < 1e-10);
+
+		// fused potential and virial
+		Cell p1, p2;
+		srand(42);
+		initCell(&p1, 2000, 2000, 1e30, 1e32, 0, 1e17, 0, 1e17);
+		srand(42);
+		initCell(&p2, 2000, 2000, 1e30, 1e32, 0, 1e17, 0, 1e17);
+		initPotential(&p1);
+		initPotential(&p2);
+		P2P_inRef(&p1);
+		P2P_in(&p2, &wv);
+		P2P_extRef(&c3, &p1);
+		P2P_ext(&c3, &p2, &wv);
+		ponPpot_ref(m3.m, m3.x, m3.y, p1.nbParticles, p1.m, p1.x, p1.y, p1.fx, p1.fy, p1.pot, p1.vir);
+		M2P(&m3, &p2, &wv);
+		computeRelativeErrors(&p1, 1, &p2, &minRE, maxRE, &firstQRE, &medianRE, &thirdQRE);
+		assert(maxRE[0] < 1e-10);
+		for (int i = 0; i < p1.nbParticles; i++)
+			assert(fabs(p2.pot[i] - p1.pot[i]) < 1e-12 * fabs(p1.pot[i]));
+		for (int k = 0; k < 3; k++)
+			assert(fabs(p2.vir[k] - p1.vir[k]) < 1e-10 * fabs(p1.vir[0]));
+		freeCell(&p1);
+		freeCell(&p2);
+
+		for (uint32_t x = 0; x < 1024; x += 7)
+			for (uint32_t y = 0; y < 1024; y += 13)
+				assert(xy_to_morton(x, y) == xy_to_morton_generic(x, y));
+
+		freeCell(&c1);
+		freeCell(&c2);
+		freeCell(&c3);
+	}
+	printf("\n");
+
+	setBackend(NULL);
+	freeWorkingVecs(&wv);
+}
+
 
 int main(int argc, char const *argv[])
 {
+	MPI_Init(NULL, NULL);
+
+	// with several ranks, mpirun -np 3 ./tests, only the distributed force passes are tested
+	int size;
+	MPI_Comm_size(MPI_COMM_WORLD, &size);
+	if (size > 1)
+	{
+		testDistributed();
+		MPI_Finalize();
+		return EXIT_SUCCESS;
+	}
+
 	testP2M();
 	testInitQuadtree();
 	testDistance();
+	testMorton();
+	testHilbert();
 
 	testPonP();
 	testP2Pin();
 	testP2Pext();
 	testBarnesHut();
+	testBackends();
+	testDirectSum();
+	testSampledErrors();
+	testEnergy();
+	testTreePM();
+	testPeriodic();
+	testBlockTimesteps();
+	testField();
+	testGroupWalk();
+	testSparseCells();
+	testMAC();
+	testGenerator();
+	testPlacement();
+	testEnsemble();
+	testService();
+	testArrays();
+	testOutOfCore();
+	testHaloEncoding();
+	testSnapshots();
+	testAnalysis();
+	testNeighbours();
+	testDistributed();
 
+	MPI_Finalize();
 	return EXIT_SUCCESS;
 }
\ No newline at end of file
@@ -1,7 +1,10 @@
+#include "sys/time.h"
 #include <stdlib.h>
 
 #include "Cell.h"
+#include "Direct.h"
 #include "Multipole.h"
+#include "Quadtree.h"
 #include "utils.h"
 #include "WorkingVecs.h"
 
@@ -61,9 +64,119 @@ void tuneM2P()
 	freeWorkingVecs(&wv);
 }
 
+void tuneCosts()
+{
+	printf("# Calibrating the cost model of the walk (see Quadtree.h).\n\n");
+
+	Cell c;
+	WorkingVecs wv;
+	struct timeval start, stop;
+	srand(42);
+	initCell(&c, 4096, 4096, 1.0, 100.0, 0, 1e17, 0, 1e17);
+	initWorkingVecs(&wv);
+
+	// time of a call of nbParticles interactions: the cost of a call is the intercept, 
+	// in interactions of the large calls
+	printf("# Kernel calls: nb of particles, time per call, time per interaction (seconds)\n");
+	double interaction = 0, call = 0;
+	for (int n = 1; n <= 4096; n *= 4)
+	{
+		int nbCalls = 20000000 / (n + 8);
+		gettimeofday(&start, NULL);
+		for (int i = 0; i < nbCalls; i++)
+			ponP(1.0, 2e17 + i, 2e17, n, c.m, c.x, c.y, c.fx, c.fy, &wv);
+		gettimeofday(&stop, NULL);
+		double t = (stop.tv_sec - start.tv_sec + 0.000001 * (stop.tv_usec - start.tv_usec)) / nbCalls;
+		printf("%d %e %e\n", n, t, t / n);
+
+		if (n == 1)
+			call = t;
+		interaction = t / n;
+	}
+	call = call / interaction - 1;
+	printf("# costCall (interactions)\n%f\n\n", call);
+
+	// the cost of a visit is the one of the fastest walk, on sparse and dense trees
+	printf("# Walk: nb of particles, tree height, costVisit, interaction computation time (seconds)\n");
+	int nbParticles[3] = {20000, 80000, 400000}, heights[3] = {8, 8, 9};
+	double visits[5] = {1, 4, 16, 64, 256}, times[5] = {0};
+	for (int t = 0; t < 3; t++)
+	{
+		Quadtree qt;
+		srand(42);
+		initQuadtree(&qt, heights[t], nbParticles[t], nbParticles[t], 1e30, 1e32, 0, 1e17, 0, 1e17);
+		computeMultipoles(&qt);
+		qt.costCall = call;
+
+		for (int v = 0; v < 5; v++)
+		{
+			qt.costVisit = visits[v];
+			gettimeofday(&start, NULL);
+			computeForces(&qt, 0.707);
+			gettimeofday(&stop, NULL);
+			double seconds = stop.tv_sec - start.tv_sec + 0.000001 * (stop.tv_usec - start.tv_usec);
+			printf("%d %d %f %e\n", nbParticles[t], heights[t], visits[v], seconds);
+			times[v] += seconds;
+		}
+		freeQuadtree(&qt);
+	}
+
+	// the fastest over the three trees
+	int best = 0;
+	for (int v = 1; v < 5; v++)
+		if (times[v] < times[best])
+			best = v;
+	printf("# Calibrated cost model, for Quadtree.h\n"
+		   "#define COST_CALL %.1f\n#define COST_VISIT %.1f\n\n", call, visits[best]);
+
+	freeCell(&c);
+	freeWorkingVecs(&wv);
+}
+
+void tuneMAC()
+{
+	printf("# Tuning the MAC of the walk (see Quadtree.h). 100k particles on a 32x32 grid, "
+		   "sampled relative errors (1k samples) VS time.\n\n"
+		   "# MAC, farFieldLimit, macTolerance, interaction computation time (seconds), "
+		   "1st quartile, median, 3rd quartile\n");
+
+	struct { MultipoleAcceptance mac; double farFieldLimit; double tolerance; } runs[] = 
+	{
+		{GEOMETRIC_MAC, 0.35, 0}, {GEOMETRIC_MAC, 0.5, 0}, {GEOMETRIC_MAC, 0.707, 0},
+		{BMAX_MAC, 0.5, 0}, {BMAX_MAC, 0.707, 0}, {BMAX_MAC, 1, 0},
+		{ERROR_MAC, 1, 1e-9}, {ERROR_MAC, 1, 1e-10}, {ERROR_MAC, 1, 1e-11}
+	};
+	const char *names[] = {"geometric", "bmax", "error"};
+
+	for (int r = 0; r < sizeof(runs) / sizeof(runs[0]); r++)
+	{
+		Quadtree qt;
+		struct timeval start, stop;
+		srand(42);
+		initQuadtree(&qt, 6, 100000, 100000, 1e30, 1e32, 0, 1e17, 0, 1e17);
+		qt.mac = runs[r].mac;
+		qt.macTolerance = runs[r].tolerance;
+		computeMultipoles(&qt);
+
+		gettimeofday(&start, NULL);
+		computeForces(&qt, runs[r].farFieldLimit);
+		gettimeofday(&stop, NULL);
+
+		ErrorEstimate est;
+		sampleRelativeErrors(qt.nbCells, qt.cells, 1000, 42, &est);
+		printf("%s %f %e %e %e %e %e\n", names[runs[r].mac], runs[r].farFieldLimit, runs[r].tolerance,
+			   stop.tv_sec - start.tv_sec + 0.000001 * (stop.tv_usec - start.tv_usec),
+			   est.quantiles[1], est.quantiles[2], est.quantiles[3]);
+		freeQuadtree(&qt);
+	}
+	printf("\n");
+}
+
 int main(int argc, char const *argv[])
 {
 	tuneM2P();
+	tuneCosts();
+	tuneMAC();
 
 	return EXIT_SUCCESS;
 }
\ No newline at end of file